@@ -48,6 +48,13 @@ namespace Common {
             {"allow_sram_saving", gameboy.emulation.allow_sram_saving},
             {"use_rpc", gameboy.emulation.use_rpc},
             {"sram_save_interval", gameboy.emulation.sram_save_interval},
+            {"run_ahead_frames", gameboy.emulation.run_ahead_frames},
+            {"cached_interpreter", gameboy.emulation.cached_interpreter},
+            {"recompiler", gameboy.emulation.recompiler},
+            {"skip_idle_loops", gameboy.emulation.skip_idle_loops},
+            {"speed", gameboy.emulation.speed},
+            {"fast_forward_speed", gameboy.emulation.fast_forward_speed},
+            {"fast_forward_key", gameboy.emulation.fast_forward_key},
             {"frame_blending", gameboy.video.frame_blending},
             {"smooth_scaling", gameboy.video.smooth_scaling},
             {"screen_filter", gameboy.video.screen_filter},
@@ -56,6 +63,10 @@ namespace Common {
             {"square2", gameboy.audio.square2},
             {"wave", gameboy.audio.wave},
             {"noise", gameboy.audio.noise},
+            {"rewind_enabled", gameboy.rewind.enabled},
+            {"rewind_buffer_size_mb", gameboy.rewind.buffer_size_mb},
+            {"rewind_frames_per_snapshot", gameboy.rewind.frames_per_snapshot},
+            {"rewind_key", gameboy.rewind.key},
         };
 
         std::vector<toml::value> devices;
@@ -128,6 +139,19 @@ namespace Common {
         gameboy.emulation.use_rpc = toml::find_or(gb, "use_rpc", gameboy.emulation.use_rpc);
         gameboy.emulation.sram_save_interval =
             toml::find_or(gb, "sram_save_interval", gameboy.emulation.sram_save_interval);
+        gameboy.emulation.run_ahead_frames =
+            toml::find_or(gb, "run_ahead_frames", gameboy.emulation.run_ahead_frames);
+        gameboy.emulation.cached_interpreter =
+            toml::find_or(gb, "cached_interpreter", gameboy.emulation.cached_interpreter);
+        gameboy.emulation.recompiler =
+            toml::find_or(gb, "recompiler", gameboy.emulation.recompiler);
+        gameboy.emulation.skip_idle_loops =
+            toml::find_or(gb, "skip_idle_loops", gameboy.emulation.skip_idle_loops);
+        gameboy.emulation.speed = toml::find_or(gb, "speed", gameboy.emulation.speed);
+        gameboy.emulation.fast_forward_speed =
+            toml::find_or(gb, "fast_forward_speed", gameboy.emulation.fast_forward_speed);
+        gameboy.emulation.fast_forward_key =
+            toml::find_or(gb, "fast_forward_key", gameboy.emulation.fast_forward_key);
 
         gameboy.video.frame_blending =
             toml::find_or(gb, "frame_blending", gameboy.video.frame_blending);
@@ -142,6 +166,13 @@ namespace Common {
         gameboy.audio.wave = toml::find_or(gb, "wave", gameboy.audio.wave);
         gameboy.audio.noise = toml::find_or(gb, "noise", gameboy.audio.noise);
 
+        gameboy.rewind.enabled = toml::find_or(gb, "rewind_enabled", gameboy.rewind.enabled);
+        gameboy.rewind.buffer_size_mb =
+            toml::find_or(gb, "rewind_buffer_size_mb", gameboy.rewind.buffer_size_mb);
+        gameboy.rewind.frames_per_snapshot =
+            toml::find_or(gb, "rewind_frames_per_snapshot", gameboy.rewind.frames_per_snapshot);
+        gameboy.rewind.key = toml::find_or(gb, "rewind_key", gameboy.rewind.key);
+
         if (gb["devices"].is_array()) {
             auto gb_devices = gb["devices"].as_array();
 
@@ -46,6 +46,15 @@ namespace Common {
             bool allow_sram_saving = true;
             bool use_rpc = true;
             int32_t sram_save_interval = 30;
+            int32_t run_ahead_frames = 0;
+            bool cached_interpreter = false;
+            bool recompiler = false;
+            bool skip_idle_loops = false;
+
+            // Percent of full speed, 0 runs as fast as possible.
+            int32_t speed = 100;
+            int32_t fast_forward_speed = 0;
+            int32_t fast_forward_key = 0x01000001; // Qt::Key_Tab
         } emulation;
 
         struct AudioData {
@@ -56,6 +65,13 @@ namespace Common {
             int32_t noise = 100;
         } audio;
 
+        struct RewindData {
+            bool enabled = true;
+            int32_t buffer_size_mb = 64;
+            int32_t frames_per_snapshot = 1;
+            int32_t key = 0x01000003; // Qt::Key_Backspace
+        } rewind;
+
         std::array<GBGamepadConfig, 2> input_mappings{
             GBGamepadConfig{.device_name = "Keyboard"},
             GBGamepadConfig{.device_name = "Keyboard"},
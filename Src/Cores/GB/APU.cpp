@@ -17,9 +17,17 @@
 */
 
 #include "APU.hpp"
+#include "Constants.hpp"
+#include "StateArchive.hpp"
+#include <algorithm>
 #include <array>
 
 namespace GB {
+    constexpr float VOLUME_SCALE = 255.0f;
+
+    // Enough for a frame resampled to 4x the host rate, which is what 25% speed asks for.
+    constexpr int32_t BUFFERED_FRAMES = 8;
+
     // Fixes Final Fantasy Adventure because it mutes channels by setting the frequency to max
     constexpr int HIGH_FREQUENCY_CUTOFF = 0x7FF;
 
@@ -95,37 +103,19 @@ namespace GB {
         }
     }
 
-    void PulseChannel::step_frequency() {
-        if (!channel_on) {
-            return;
-        }
-
-        if (period_counter == 0) {
-            period_counter = (0x800 - get_combined_period()) * 4;
-            duty_position = (duty_position + 1) & 0x7;
-        } else {
-            period_counter--;
-        }
+    void PulseChannel::clock() {
+        period_counter = (0x800 - get_combined_period()) * 4;
+        duty_position = (duty_position + 1) & 0x7;
     }
 
-    uint8_t PulseChannel::sample(uint8_t side) {
-        uint8_t volume = (DUTY_TABLE[wave_duty][duty_position] * volume_output);
+    bool PulseChannel::is_running() const { return channel_on; }
 
-        if (frequency_too_high) {
-            volume = 0;
-        }
-
-        if (!channel_on) {
+    uint8_t PulseChannel::output() const {
+        if (!channel_on || frequency_too_high) {
             return 0;
         }
 
-        if (side == 0 && left_out_enabled) {
-            return volume;
-        } else if (side == 1 && right_out_enabled) {
-            return volume;
-        }
-
-        return 0;
+        return DUTY_TABLE[wave_duty][duty_position] * volume_output;
     }
 
     void PulseChannel::trigger(uint8_t frame_sequencer_counter) {
@@ -293,41 +283,25 @@ namespace GB {
         return new_period;
     }
 
-    void WaveChannel::step(const std::array<uint8_t, 16> &wave_table) {
-        if (channel_on && dac_enabled) {
-            if (period_counter <= 0) {
-                period_counter = (0x800 - get_combined_period()) * 2;
+    void WaveChannel::clock(const std::array<uint8_t, 16> &wave_table) {
+        period_counter = (0x800 - get_combined_period()) * 2;
 
-                position_counter = (position_counter + 1) % 32;
-                buffer = wave_table[position_counter / 2];
+        position_counter = (position_counter + 1) % 32;
+        buffer = wave_table[position_counter / 2];
 
-                if ((position_counter & 1) == 0) {
-                    buffer >>= 4;
-                }
-            } else {
-                period_counter--;
-            }
+        if ((position_counter & 1) == 0) {
+            buffer >>= 4;
         }
     }
 
-    uint8_t WaveChannel::sample(uint8_t side) {
-        if (!channel_on || !dac_enabled) {
-            return 0;
-        }
-
-        uint8_t volume = (buffer & 0xF) >> WAVE_VOLUME[output_level];
-
-        if (frequency_too_high) {
-            volume = 0;
-        }
+    bool WaveChannel::is_running() const { return channel_on && dac_enabled; }
 
-        if (side == 0 && left_out_enabled) {
-            return volume;
-        } else if (side == 1 && right_out_enabled) {
-            return volume;
+    uint8_t WaveChannel::output() const {
+        if (!channel_on || !dac_enabled || frequency_too_high) {
+            return 0;
         }
 
-        return 0;
+        return (buffer & 0xF) >> WAVE_VOLUME[output_level];
     }
 
     void WaveChannel::trigger(uint8_t frame_sequencer_counter) {
@@ -397,41 +371,27 @@ namespace GB {
 
     uint16_t WaveChannel::get_combined_period() const { return (period_high << 8) | period_low; }
 
-    void NoiseChannel::step() {
-        if (!channel_on) {
-            return;
-        }
-
-        if (period_counter == 0) {
-            period_counter = (NOISE_DIV[clock_divider] << clock_shift) * 4;
+    void NoiseChannel::clock() {
+        period_counter = (NOISE_DIV[clock_divider] << clock_shift) * 4;
 
-            uint16_t _xor = ((LFSR & 1) ^ ((LFSR & 2) >> 1));
-            LFSR |= _xor << 15;
+        uint16_t _xor = ((LFSR & 1) ^ ((LFSR & 2) >> 1));
+        LFSR |= _xor << 15;
 
-            if (LFSR_width == 1) {
-                LFSR &= ~(0x80);
-                LFSR |= _xor << 7;
-            }
-            LFSR >>= 1;
-        } else {
-            period_counter--;
+        if (LFSR_width == 1) {
+            LFSR &= ~(0x80);
+            LFSR |= _xor << 7;
         }
+        LFSR >>= 1;
     }
 
-    uint8_t NoiseChannel::sample(uint8_t side) {
+    bool NoiseChannel::is_running() const { return channel_on; }
+
+    uint8_t NoiseChannel::output() const {
         if (!channel_on) {
             return 0;
         }
 
-        uint8_t volume = (LFSR & 1) * volume_output;
-
-        if (side == 0 && left_out_enabled) {
-            return volume;
-        } else if (side == 1 && right_out_enabled) {
-            return volume;
-        }
-
-        return 0;
+        return (LFSR & 1) * volume_output;
     }
 
     void NoiseChannel::trigger(uint8_t frame_sequencer_counter) {
@@ -530,8 +490,15 @@ namespace GB {
         stereo_right_volume = 7;
         mix_vin_left = false;
         mix_vin_right = false;
-        sample_counter = sample_rate = 0;
+        output_enabled = true;
+        sample_rate = 0;
+        sync_timestamp = 0;
+        frame_timestamp = 0;
         frame_sequencer_counter = 0;
+
+        for (auto &outputs : channel_outputs) {
+            outputs.fill(0.0f);
+        }
         power = true;
 
         pulse_1 = PulseChannel(true);
@@ -541,10 +508,69 @@ namespace GB {
         wave_table.fill(0);
     }
 
-    void APU::set_samples_callback(int32_t rate, std::function<void(SampleResult result)> cb) {
-        samples_ready_func = cb;
+    void APU::set_channel_volume(AudioChannel channel, float volume) {
+        channel_volumes[static_cast<size_t>(channel)] = volume;
+        update_outputs();
+    }
+
+    void APU::set_sample_rate(int32_t rate) {
         sample_rate = rate;
-        sample_counter = 0;
+
+        if (sample_rate > 0) {
+            for (auto &buffer : output_buffers) {
+                buffer.set_rates(CPU_CLOCK_RATE, sample_rate, CYCLES_PER_FRAME * BUFFERED_FRAMES);
+            }
+        }
+
+        frame_timestamp = sync_timestamp;
+
+        for (auto &outputs : channel_outputs) {
+            outputs.fill(0.0f);
+        }
+
+        update_outputs();
+    }
+
+    void APU::set_output_enabled(bool enabled) {
+        output_enabled = enabled;
+        update_outputs();
+    }
+
+    size_t APU::samples_available() const {
+        return sample_rate ? output_buffers[0].samples_available() : 0;
+    }
+
+    void APU::set_resample_ratio(double ratio) {
+        if (!sample_rate) {
+            return;
+        }
+
+        for (auto &buffer : output_buffers) {
+            buffer.set_rate_ratio(ratio);
+        }
+    }
+
+    size_t APU::read_samples(std::span<float> out) {
+        if (!sample_rate) {
+            return 0;
+        }
+
+        size_t count = output_buffers[0].read_samples(out.data(), out.size() / 2, 2);
+        output_buffers[1].read_samples(out.data() + 1, count, 2);
+
+        return count;
+    }
+
+    size_t APU::read_samples(std::span<int16_t> out) {
+        conversion_buffer.resize(out.size() - (out.size() & 1));
+
+        size_t count = read_samples(std::span<float>(conversion_buffer));
+
+        for (size_t i = 0; i < count * 2; ++i) {
+            out[i] = static_cast<int16_t>(std::clamp(conversion_buffer[i], -1.0f, 1.0f) * 32767.0f);
+        }
+
+        return count;
     }
 
     uint8_t APU::read_register(uint8_t address) {
@@ -639,101 +665,101 @@ namespace GB {
             switch (address) {
             case 0x10: {
                 pulse_1.write_nr10(value);
-                return;
+                break;
             }
             case 0x11: {
                 pulse_1.write_nrX1(power, value);
-                return;
+                break;
             }
             case 0x12: {
                 pulse_1.write_nrX2(value);
-                return;
+                break;
             }
             case 0x13: {
                 pulse_1.write_nrX3(value);
-                return;
+                break;
             }
             case 0x14: {
                 pulse_1.write_nrX4(value, frame_sequencer_counter);
-                return;
+                break;
             }
 
             case 0x15: {
-                return;
+                break;
             }
             case 0x16: {
                 pulse_2.write_nrX1(power, value);
-                return;
+                break;
             }
             case 0x17: {
                 pulse_2.write_nrX2(value);
-                return;
+                break;
             }
             case 0x18: {
                 pulse_2.write_nrX3(value);
-                return;
+                break;
             }
             case 0x19: {
                 pulse_2.write_nrX4(value, frame_sequencer_counter);
-                return;
+                break;
             }
 
             case 0x1A: {
                 wave.write_nr30(value);
-                return;
+                break;
             }
             case 0x1B: {
                 wave.write_nr31(value);
-                return;
+                break;
             }
             case 0x1C: {
                 wave.write_nr32(value);
-                return;
+                break;
             }
             case 0x1D: {
                 wave.write_nr33(value);
-                return;
+                break;
             }
             case 0x1E: {
                 wave.write_nr34(value, frame_sequencer_counter);
-                return;
+                break;
             }
 
             case 0x1F: {
-                return;
+                break;
             }
 
             case 0x20: {
                 noise.write_nr41(value);
-                return;
+                break;
             }
             case 0x21: {
                 noise.write_nr42(value);
-                return;
+                break;
             }
             case 0x22: {
                 noise.write_nr43(value);
-                return;
+                break;
             }
             case 0x23: {
                 noise.write_nr44(value, frame_sequencer_counter);
-                return;
+                break;
             }
 
             case 0x24: {
                 write_nr50(value);
-                return;
+                break;
             }
             case 0x25: {
                 write_nr51(value);
-                return;
+                break;
             }
             case 0x26: {
                 write_nr52(value);
-                return;
+                break;
             }
             case 0x27: {
-                return;
+                break;
             }
             }
         } else {
@@ -741,26 +767,28 @@ namespace GB {
             switch (address) {
             case 0x11: {
                 pulse_1.write_nrX1(power, value);
-                return;
+                break;
             }
             case 0x16: {
                 pulse_2.write_nrX1(power, value);
-                return;
+                break;
             }
             case 0x1B: {
                 wave.write_nr31(value);
-                return;
+                break;
             }
             case 0x20: {
                 noise.write_nr41(value);
-                return;
+                break;
             }
             case 0x26: {
                 write_nr52(value);
-                return;
+                break;
             }
             }
         }
+
+        update_outputs();
     }
 
     uint8_t APU::read_wave_ram(uint8_t address) { return wave_table[address]; }
@@ -839,33 +867,6 @@ namespace GB {
         return nr51;
     }
 
-    void APU::step(int32_t cycles) {
-        for (int i = 0; i < cycles; ++i) {
-            pulse_1.step_frequency();
-            pulse_2.step_frequency();
-            wave.step(wave_table);
-            noise.step();
-            sample_counter++;
-
-            if (sample_counter % sample_rate == 0) {
-                if (samples_ready_func) {
-                    SampleResult result;
-                    result.left_channel.master_volume = stereo_left_volume;
-                    result.left_channel.pulse_1 = pulse_1.sample(0);
-                    result.left_channel.pulse_2 = pulse_2.sample(0);
-                    result.left_channel.wave = wave.sample(0);
-                    result.left_channel.noise = noise.sample(0);
-
-                    result.right_channel.master_volume = stereo_right_volume;
-                    result.right_channel.pulse_1 = pulse_1.sample(1);
-                    result.right_channel.pulse_2 = pulse_2.sample(1);
-                    result.right_channel.wave = wave.sample(1);
-                    result.right_channel.noise = noise.sample(1);
-                    samples_ready_func(result);
-                }
-            }
-        }
-    }
     void APU::step_frame_sequencer() {
         switch (frame_sequencer_counter) {
         case 0:
@@ -906,6 +907,114 @@ namespace GB {
         }
 
         frame_sequencer_counter = ++frame_sequencer_counter & 7;
+
+        update_outputs();
+    }
+
+    void APU::sync(uint64_t timestamp) {
+        while (timestamp > sync_timestamp) {
+            // Band-limited frames are bounded so they always fit in the output buffers.
+            uint64_t end = std::min(timestamp, sync_timestamp + CYCLES_PER_FRAME);
+
+            if (sample_rate && output_enabled) {
+                for (auto &buffer : output_buffers) {
+                    buffer.make_room(end - frame_timestamp);
+                }
+            }
+
+            advance(end);
+            end_frame();
+        }
     }
 
-}
\ No newline at end of file
+    template <typename Channel, typename Clock>
+    void APU::run_channel(Channel &channel, AudioChannel id, uint64_t from, uint64_t to,
+                          Clock &&clock) {
+        if (!channel.is_running()) {
+            return;
+        }
+
+        /*
+            The period counter reloads on the cycle after it reaches zero, so the output can only
+            change every period_counter + 1 cycles. Everything in between is skipped.
+        */
+        uint64_t timestamp = from;
+
+        while (to - timestamp > channel.period_counter) {
+            timestamp += channel.period_counter + 1;
+            clock();
+            update_output(id, channel.output(), channel.left_out_enabled,
+                          channel.right_out_enabled, timestamp);
+        }
+
+        channel.period_counter -= static_cast<uint16_t>(to - timestamp);
+    }
+
+    void APU::advance(uint64_t timestamp) {
+        run_channel(pulse_1, AudioChannel::Pulse1, sync_timestamp, timestamp,
+                    [this] { pulse_1.clock(); });
+        run_channel(pulse_2, AudioChannel::Pulse2, sync_timestamp, timestamp,
+                    [this] { pulse_2.clock(); });
+        run_channel(wave, AudioChannel::Wave, sync_timestamp, timestamp,
+                    [this] { wave.clock(wave_table); });
+        run_channel(noise, AudioChannel::Noise, sync_timestamp, timestamp,
+                    [this] { noise.clock(); });
+
+        sync_timestamp = timestamp;
+    }
+
+    void APU::update_output(AudioChannel id, uint8_t level, bool left, bool right,
+                            uint64_t timestamp) {
+        if (!sample_rate || !output_enabled) {
+            return;
+        }
+
+        auto index = static_cast<size_t>(id);
+        float amplitude = static_cast<float>(level) * channel_volumes[index] / VOLUME_SCALE;
+        std::array<float, 2> outputs{
+            left ? amplitude * static_cast<float>(stereo_left_volume) / 7.0f : 0.0f,
+            right ? amplitude * static_cast<float>(stereo_right_volume) / 7.0f : 0.0f,
+        };
+
+        for (size_t side = 0; side < outputs.size(); ++side) {
+            float delta = outputs[side] - channel_outputs[index][side];
+
+            if (delta != 0.0f) {
+                output_buffers[side].add_delta(timestamp - frame_timestamp, delta);
+                channel_outputs[index][side] = outputs[side];
+            }
+        }
+    }
+
+    void APU::update_outputs() {
+        update_output(AudioChannel::Pulse1, pulse_1.output(), pulse_1.left_out_enabled,
+                      pulse_1.right_out_enabled, sync_timestamp);
+        update_output(AudioChannel::Pulse2, pulse_2.output(), pulse_2.left_out_enabled,
+                      pulse_2.right_out_enabled, sync_timestamp);
+        update_output(AudioChannel::Wave, wave.output(), wave.left_out_enabled,
+                      wave.right_out_enabled, sync_timestamp);
+        update_output(AudioChannel::Noise, noise.output(), noise.left_out_enabled,
+                      noise.right_out_enabled, sync_timestamp);
+    }
+
+    void APU::end_frame() {
+        if (sample_rate && output_enabled) {
+            for (auto &buffer : output_buffers) {
+                buffer.end_frame(sync_timestamp - frame_timestamp);
+            }
+        }
+
+        frame_timestamp = sync_timestamp;
+    }
+
+    void APU::serialize(StateArchive &archive) {
+        archive(mix_vin_left, mix_vin_right, power, stereo_left_volume, stereo_right_volume,
+                frame_sequencer_counter, wave_table, pulse_1, pulse_2, wave, noise, sync_timestamp);
+
+        if (archive.loading()) {
+            // Host output continues from whatever the channels were producing before the load.
+            frame_timestamp = sync_timestamp;
+            update_outputs();
+        }
+    }
+}
@@ -17,11 +17,15 @@
 */
 
 #pragma once
+#include "BandLimitedBuffer.hpp"
 #include <array>
 #include <cinttypes>
-#include <functional>
+#include <span>
+#include <vector>
 
 namespace GB {
+    class StateArchive;
+
     class LengthCounter {
     public:
         void step_length(bool &channel_on);
@@ -56,8 +60,9 @@ namespace GB {
         PulseChannel(bool has_sweep) : has_sweep(has_sweep) {}
 
         void step_frequency_sweep();
-        void step_frequency();
-        uint8_t sample(uint8_t side);
+        void clock();
+        bool is_running() const;
+        uint8_t output() const;
         void trigger(uint8_t frame_sequencer_counter);
 
         void write_nr10(uint8_t nr10);
@@ -104,8 +109,9 @@ namespace GB {
 
     class WaveChannel {
     public:
-        void step(const std::array<uint8_t, 16> &wave_table);
-        uint8_t sample(uint8_t side);
+        void clock(const std::array<uint8_t, 16> &wave_table);
+        bool is_running() const;
+        uint8_t output() const;
         void trigger(uint8_t frame_sequencer_counter);
         void write_nr30(uint8_t nr30);
         void write_nr31(uint8_t nr31);
@@ -140,8 +146,9 @@ namespace GB {
 
     class NoiseChannel {
     public:
-        void step();
-        uint8_t sample(uint8_t side);
+        void clock();
+        bool is_running() const;
+        uint8_t output() const;
         void trigger(uint8_t frame_sequencer_counter);
         void write_nr41(uint8_t nr41);
         void write_nr42(uint8_t nr42);
@@ -171,23 +178,38 @@ namespace GB {
         friend class APU;
     };
 
-    struct SampleResult {
-        struct {
-            uint8_t master_volume = 0, vin = 0;
-            uint8_t pulse_1 = 0, pulse_2 = 0;
-            uint8_t wave = 0, noise = 0;
-        } left_channel;
-        struct {
-            uint8_t master_volume = 0, vin = 0;
-            uint8_t pulse_1 = 0, pulse_2 = 0;
-            uint8_t wave = 0, noise = 0;
-        } right_channel;
+    enum class AudioChannel : uint8_t {
+        Pulse1,
+        Pulse2,
+        Wave,
+        Noise,
     };
 
     class APU {
     public:
         void reset();
-        void set_samples_callback(int32_t rate, std::function<void(SampleResult result)> cb);
+        void set_channel_volume(AudioChannel channel, float volume);
+
+        /*
+            Output is buffered as mixed stereo at the host sample rate, up to a few frames worth,
+            and has to be drained by the caller. A rate of 0 is a null sink, channels are still
+            emulated but no samples are generated.
+        */
+        void set_sample_rate(int32_t rate);
+        size_t samples_available() const;
+
+        // Nudges the effective sample rate, used to keep a consumer's buffer from draining.
+        void set_resample_ratio(double ratio);
+
+        /*
+            While output is disabled the channels keep running but time does not advance in the
+            output buffers, speculative frames leave no trace in the audio stream.
+        */
+        void set_output_enabled(bool enabled);
+
+        // Both write interleaved stereo frames and return the number of frames written.
+        size_t read_samples(std::span<float> out);
+        size_t read_samples(std::span<int16_t> out);
 
         uint8_t read_register(uint8_t address);
         void write_register(uint8_t address, uint8_t value);
@@ -204,10 +226,20 @@ namespace GB {
         uint8_t read_nr50() const;
         uint8_t read_nr51() const;
 
-        void step(int32_t cycles);
         void step_frame_sequencer();
+        void sync(uint64_t timestamp);
+        void serialize(StateArchive &archive);
 
     private:
+        template <typename Channel, typename Clock>
+        void run_channel(Channel &channel, AudioChannel id, uint64_t from, uint64_t to,
+                         Clock &&clock);
+        void advance(uint64_t timestamp);
+        void update_output(AudioChannel id, uint8_t level, bool left, bool right,
+                           uint64_t timestamp);
+        void update_outputs();
+        void end_frame();
+
         bool mix_vin_left = false;
         bool mix_vin_right = false;
         bool power = false;
@@ -223,8 +255,14 @@ namespace GB {
         WaveChannel wave;
         NoiseChannel noise;
 
-        std::function<void(SampleResult result)> samples_ready_func = nullptr;
-        int32_t sample_counter = 0;
+        std::array<float, 4> channel_volumes{1.0f, 1.0f, 1.0f, 1.0f};
+        std::array<std::array<float, 2>, 4> channel_outputs{};
+        std::array<BandLimitedBuffer, 2> output_buffers{};
+        std::vector<float> conversion_buffer{};
+
+        bool output_enabled = true;
         int32_t sample_rate = 0;
+        uint64_t sync_timestamp = 0;
+        uint64_t frame_timestamp = 0;
     };
 }
\ No newline at end of file
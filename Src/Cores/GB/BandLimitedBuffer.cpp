@@ -0,0 +1,154 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "BandLimitedBuffer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace GB {
+    // Cutoff relative to the output sample rate, slightly below Nyquist so the transition band
+    // of the short kernel does not fold back.
+    constexpr double CUTOFF = 0.45;
+
+    // Charge factor of the output capacitor on DMG units, applied per 4 MiHz clock.
+    constexpr double CAPACITOR_CHARGE_FACTOR = 0.999958;
+
+    using Kernel =
+        std::array<std::array<float, BandLimitedBuffer::KERNEL_WIDTH>, BandLimitedBuffer::PHASES>;
+
+    static const Kernel &step_kernel() {
+        static const Kernel kernel = [] {
+            constexpr double half_width = BandLimitedBuffer::KERNEL_WIDTH / 2.0;
+            Kernel result{};
+
+            for (size_t phase = 0; phase < BandLimitedBuffer::PHASES; ++phase) {
+                double fraction = static_cast<double>(phase) / BandLimitedBuffer::PHASES;
+                double sum = 0.0;
+                std::array<double, BandLimitedBuffer::KERNEL_WIDTH> taps{};
+
+                for (size_t i = 0; i < taps.size(); ++i) {
+                    double x = static_cast<double>(i) - half_width - fraction + 1.0;
+                    double sinc = x == 0.0 ? 1.0
+                                           : std::sin(std::numbers::pi * 2.0 * CUTOFF * x) /
+                                                 (std::numbers::pi * 2.0 * CUTOFF * x);
+                    double w = (x + half_width) / (half_width * 2.0);
+                    double blackman = 0.42 - 0.5 * std::cos(2.0 * std::numbers::pi * w) +
+                                      0.08 * std::cos(4.0 * std::numbers::pi * w);
+
+                    taps[i] = sinc * blackman;
+                    sum += taps[i];
+                }
+
+                // Each phase has to add up to exactly one or steps would leave a DC error behind.
+                for (size_t i = 0; i < taps.size(); ++i) {
+                    result[phase][i] = static_cast<float>(taps[i] / sum);
+                }
+            }
+
+            return result;
+        }();
+
+        return kernel;
+    }
+
+    void BandLimitedBuffer::set_rates(uint32_t clock_rate, uint32_t sample_rate,
+                                      uint32_t buffer_length) {
+        base_factor = (static_cast<uint64_t>(sample_rate) << FRACTION_BITS) / clock_rate;
+        factor = base_factor;
+        high_pass = 1.0f - static_cast<float>(std::pow(
+                               CAPACITOR_CHARGE_FACTOR, static_cast<double>(clock_rate) /
+                                                            static_cast<double>(sample_rate)));
+
+        size_t max_samples = (static_cast<uint64_t>(buffer_length) * factor >> FRACTION_BITS) + 1;
+
+        buffer.assign(max_samples + KERNEL_WIDTH, 0.0f);
+        step_kernel();
+        clear();
+    }
+
+    void BandLimitedBuffer::clear() {
+        offset = 0;
+        integrator = 0.0f;
+        std::fill(buffer.begin(), buffer.end(), 0.0f);
+    }
+
+    void BandLimitedBuffer::set_rate_ratio(double ratio) {
+        factor = static_cast<uint64_t>(static_cast<double>(base_factor) * ratio);
+    }
+
+    void BandLimitedBuffer::add_delta(uint64_t time, float delta) {
+        uint64_t position = offset + time * factor;
+        size_t index = position >> FRACTION_BITS;
+        size_t phase = (position >> (FRACTION_BITS - PHASE_BITS)) & (PHASES - 1);
+
+        const auto &taps = step_kernel()[phase];
+        float *out = &buffer[index];
+
+        for (size_t i = 0; i < KERNEL_WIDTH; ++i) {
+            out[i] += taps[i] * delta;
+        }
+    }
+
+    void BandLimitedBuffer::end_frame(uint64_t length) { offset += length * factor; }
+
+    void BandLimitedBuffer::make_room(uint64_t length) {
+        size_t needed = ((offset + length * factor) >> FRACTION_BITS) + 1;
+        size_t capacity = buffer.size() - KERNEL_WIDTH;
+
+        if (needed > capacity) {
+            remove_samples(needed - capacity);
+        }
+    }
+
+    size_t BandLimitedBuffer::samples_available() const { return offset >> FRACTION_BITS; }
+
+    size_t BandLimitedBuffer::read_samples(float *out, size_t count, size_t stride) {
+        return integrate(out, count, stride);
+    }
+
+    void BandLimitedBuffer::remove_samples(size_t count) { integrate(nullptr, count, 0); }
+
+    size_t BandLimitedBuffer::integrate(float *out, size_t count, size_t stride) {
+        count = std::min(count, samples_available());
+
+        float sum = integrator;
+
+        for (size_t i = 0; i < count; ++i) {
+            sum += buffer[i];
+
+            if (out) {
+                out[i * stride] = sum;
+            }
+
+            sum -= sum * high_pass;
+        }
+
+        integrator = sum;
+
+        // Keep the tail of the steps that were added past the samples that were read.
+        size_t remaining = samples_available() - count + KERNEL_WIDTH;
+
+        std::copy(buffer.begin() + count, buffer.begin() + count + remaining, buffer.begin());
+        std::fill(buffer.begin() + remaining, buffer.begin() + remaining + count, 0.0f);
+
+        offset -= static_cast<uint64_t>(count) << FRACTION_BITS;
+
+        return count;
+    }
+}
@@ -0,0 +1,67 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace GB {
+    /*
+        Turns amplitude changes at clock rate into samples at the host rate. Every delta is added
+        as a band-limited step (a windowed sinc split into a number of sub-sample phases) instead
+        of being point sampled, so square waves well above the host Nyquist frequency do not
+        alias. The buffer holds the differences between samples, they are integrated when read.
+    */
+    class BandLimitedBuffer {
+    public:
+        static constexpr size_t PHASE_BITS = 5;
+        static constexpr size_t PHASES = 1 << PHASE_BITS;
+        static constexpr size_t KERNEL_WIDTH = 16;
+
+        void set_rates(uint32_t clock_rate, uint32_t sample_rate, uint32_t buffer_length);
+        void clear();
+
+        // Scales the sample rate without clearing what is already buffered.
+        void set_rate_ratio(double ratio);
+
+        // Time is measured in clocks since the start of the current frame.
+        void add_delta(uint64_t time, float delta);
+        void end_frame(uint64_t length);
+
+        // Drops the oldest samples if a frame of the given length would not fit.
+        void make_room(uint64_t length);
+
+        size_t samples_available() const;
+        size_t read_samples(float *out, size_t count, size_t stride = 1);
+        void remove_samples(size_t count);
+
+    private:
+        static constexpr size_t FRACTION_BITS = 32;
+
+        size_t integrate(float *out, size_t count, size_t stride);
+
+        uint64_t base_factor = 0;
+        uint64_t factor = 0;
+        uint64_t offset = 0;
+        float integrator = 0.0f;
+        float high_pass = 0.0f;
+        std::vector<float> buffer{};
+    };
+}
@@ -0,0 +1,205 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "BlockCache.hpp"
+#include "Cartridge.hpp"
+#include "SM83.hpp"
+#include <algorithm>
+
+namespace GB {
+    constexpr size_t MAX_BLOCK_INSTRUCTIONS = 64;
+
+    // Illegal opcodes lock up the CPU, they are given a length of 1 and end their block.
+    static constexpr std::array<uint8_t, 256> INSTRUCTION_LENGTHS = {
+        1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1, // 0x00
+        2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 0x10
+        2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 0x20
+        2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1, // 0x30
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x40
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x50
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x60
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x70
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x80
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x90
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0xA0
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0xB0
+        1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1, // 0xC0
+        1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1, // 0xD0
+        2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1, // 0xE0
+        2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1, // 0xF0
+    };
+
+    static constexpr bool ends_block(uint8_t opcode) {
+        switch (opcode) {
+        // STOP, HALT
+        case 0x10:
+        case 0x76:
+        // JR
+        case 0x18:
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38:
+        // JP
+        case 0xC2:
+        case 0xC3:
+        case 0xCA:
+        case 0xD2:
+        case 0xDA:
+        case 0xE9:
+        // CALL
+        case 0xC4:
+        case 0xCC:
+        case 0xCD:
+        case 0xD4:
+        case 0xDC:
+        // RET, RETI
+        case 0xC0:
+        case 0xC8:
+        case 0xC9:
+        case 0xD0:
+        case 0xD8:
+        case 0xD9:
+        // EI, interrupts can be taken after the next instruction
+        case 0xFB:
+        // Illegal
+        case 0xD3:
+        case 0xDB:
+        case 0xDD:
+        case 0xE3:
+        case 0xE4:
+        case 0xEB:
+        case 0xEC:
+        case 0xED:
+        case 0xF4:
+        case 0xFC:
+        case 0xFD:
+            return true;
+        default:
+            // RST
+            return (opcode & 0xC7) == 0xC7;
+        }
+    }
+
+    static constexpr bool is_relative_jump(uint8_t opcode) {
+        return opcode == 0x18 || ((opcode & 0xE7) == 0x20);
+    }
+
+    void BlockCache::clear() {
+        blocks.clear();
+        block_numbers.clear();
+        std::fill(mapped_blocks.begin(), mapped_blocks.end(), MappedBlock{});
+        generation = 1;
+        cursor = block_end = nullptr;
+    }
+
+    size_t BlockCache::block_count() const { return blocks.size(); }
+
+    void BlockCache::reset_cursor() {
+        cursor = block_end = nullptr;
+
+        if (++generation == 0) {
+            std::fill(mapped_blocks.begin(), mapped_blocks.end(), MappedBlock{});
+            generation = 1;
+        }
+    }
+
+    const MicroOp *BlockCache::enter(const CodeBlock *block, uint16_t address) {
+        if (!block) {
+            cursor = block_end = nullptr;
+            return nullptr;
+        }
+
+        const auto *instruction = block->instructions.data();
+        cursor = instruction + 1;
+        block_end = instruction + block->instructions.size();
+        next_address = address + instruction->length;
+
+        return instruction;
+    }
+
+    CodeBlock *BlockCache::lookup(Cartridge &cart, uint16_t address) {
+        uint32_t offset = cart.rom_offset(address);
+        size_t bank = offset >> 14;
+
+        if (bank >= block_numbers.size()) {
+            block_numbers.resize(bank + 1);
+        }
+
+        auto &numbers = block_numbers[bank];
+
+        if (!numbers) {
+            numbers = std::make_unique<std::array<int32_t, 0x4000>>();
+        }
+
+        auto &number = (*numbers)[offset & 0x3FFF];
+
+        if (number == 0) {
+            auto decoded = decode(cart, address);
+
+            if (decoded.instructions.empty()) {
+                number = -1;
+            } else {
+                blocks.push_back(std::move(decoded));
+                number = static_cast<int32_t>(blocks.size());
+            }
+        }
+
+        return number < 0 ? nullptr : &blocks[number - 1];
+    }
+
+    CodeBlock BlockCache::decode(Cartridge &cart, uint16_t address) {
+        // Each 16 KiB region can map a different bank, so neither blocks nor instructions may
+        // cross into the next one.
+        uint32_t region_end = (address & 0xC000) + 0x4000;
+        CodeBlock block;
+
+        while (block.instructions.size() < MAX_BLOCK_INSTRUCTIONS) {
+            MicroOp op{};
+            op.opcode = cart.read(address);
+            op.length = INSTRUCTION_LENGTHS[op.opcode];
+
+            if (address + op.length > region_end) {
+                break;
+            }
+
+            op.next_pc = address + op.length;
+
+            if (op.length == 2) {
+                op.operand = cart.read(address + 1);
+            } else if (op.length == 3) {
+                op.operand = cart.read(address + 1) | (cart.read(address + 2) << 8);
+            }
+
+            if (is_relative_jump(op.opcode)) {
+                op.operand = op.next_pc + static_cast<int8_t>(op.operand);
+            }
+
+            SM83::decode_micro_op(op);
+            block.instructions.push_back(op);
+            address = op.next_pc;
+
+            if (ends_block(op.opcode) || address == region_end) {
+                break;
+            }
+        }
+
+        return block;
+    }
+}
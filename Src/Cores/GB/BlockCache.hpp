@@ -0,0 +1,125 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace GB {
+    class Cartridge;
+    class SM83;
+    struct MicroOp;
+
+    using MicroOpHandler = void (*)(SM83 &cpu, const MicroOp &op);
+
+    /*
+        A decoded instruction. The handler is chosen once when the block is decoded and does every
+        memory access and tick of the instruction at the same position as the interpreter, the
+        opcode and operand fetches included.
+
+        Operands are resolved ahead of time: operand holds the 8 or 16-bit immediate, or the target
+        of a relative jump, and target/source are byte offsets into the CPU registers.
+    */
+    struct MicroOp {
+        MicroOpHandler handler = nullptr;
+        uint16_t operand = 0;
+        uint16_t next_pc = 0;
+        uint8_t opcode = 0;
+        uint8_t length = 0;
+        uint8_t target = 0;
+        uint8_t source = 0;
+    };
+
+    struct CodeBlock {
+        std::vector<MicroOp> instructions;
+
+        // Used by Recompiler, native code is only generated once a block has run a few times.
+        uint32_t executions = 0;
+        const uint8_t *code = nullptr;
+    };
+
+    /*
+        Decodes code running from ROM into blocks of micro-ops, so the interpreter neither reads
+        the opcode and operands through the bus nor dispatches on the opcode again. Blocks are
+        keyed by their offset in the ROM image, which stays valid across bank switches, and end at
+        the first instruction that can change the flow of execution.
+
+        Handlers tick for every byte the interpreter would have fetched, so memory timing is
+        exactly the same with or without the cache. Code running from RAM is always interpreted.
+    */
+    class BlockCache {
+    public:
+        void clear();
+        size_t block_count() const;
+
+        // Returns nullptr when the instruction at address can't be cached.
+        const MicroOp *find(Cartridge &cart, uint16_t address) {
+            if (address == next_address && cursor != block_end) {
+                next_address += cursor->length;
+                return cursor++;
+            }
+
+            return enter(find_block(cart, address), address);
+        }
+
+        // Returns the block starting at address, nullptr when it can't be cached.
+        CodeBlock *find_block(Cartridge &cart, uint16_t address) {
+            auto &mapped = mapped_blocks[address];
+
+            if (mapped.generation != generation) {
+                mapped.block = lookup(cart, address);
+                mapped.generation = generation;
+            }
+
+            return mapped.block;
+        }
+
+        // Has to be called when the ROM mapping may have changed, every address is looked up by
+        // its ROM offset again afterwards.
+        void reset_cursor();
+
+    private:
+        struct MappedBlock {
+            uint32_t generation = 0;
+            CodeBlock *block = nullptr;
+        };
+
+        const MicroOp *enter(const CodeBlock *block, uint16_t address);
+        CodeBlock *lookup(Cartridge &cart, uint16_t address);
+        static CodeBlock decode(Cartridge &cart, uint16_t address);
+
+        std::deque<CodeBlock> blocks;
+
+        // One entry per byte of every 16 KiB bank that has been executed, 0 means not decoded yet,
+        // -1 that nothing can be cached there and anything else is the block number + 1.
+        std::vector<std::unique_ptr<std::array<int32_t, 0x4000>>> block_numbers;
+
+        // Blocks by CPU address, only valid while the generation is current so a bank switch
+        // doesn't have to clear it. A null block means the address can't be cached.
+        std::vector<MappedBlock> mapped_blocks = std::vector<MappedBlock>(0x8000);
+        uint32_t generation = 1;
+
+        const MicroOp *cursor = nullptr;
+        const MicroOp *block_end = nullptr;
+        uint16_t next_address = 0;
+    };
+}
@@ -18,6 +18,7 @@
 
 #include "Bus.hpp"
 #include "Core.hpp"
+#include "StateArchive.hpp"
 #include <stdexcept>
 
 namespace GB {
@@ -25,9 +26,10 @@ namespace GB {
         if (!core) {
             throw std::invalid_argument("Core cannot be null.");
         }
-    }
 
-    bool MainBus::bootstrap_mapped() const { return bootstrap_mapped_; }
+        map_io();
+        io_registers = io_handlers;
+    }
 
     bool MainBus::is_compatibility_mode() const { return (KEY0 & DISABLE_CGB_FUNCTIONS); }
 
@@ -36,10 +38,199 @@ namespace GB {
         bootstrap_mapped_ = true;
         wram.fill(0);
         hram.fill(0);
+        cart_timestamp = 0;
         cart = new_cart;
+        map_pages();
+    }
+
+    void MainBus::map_pages() {
+        read_pages.fill(nullptr);
+        write_pages.fill(nullptr);
+
+        if (cart) {
+            // While the bootstrap is mapped read_slow() decides between it and the cartridge.
+            if (!bootstrap_mapped_) {
+                for (size_t page = 0x0; page < 0x8; page += 0x4) {
+                    if (auto bank = cart->rom_bank(static_cast<uint16_t>(page << 12))) {
+                        for (size_t i = 0; i < 0x4; ++i) {
+                            read_pages[page + i] = bank + (i * 0x1000);
+                        }
+                    }
+                }
+            }
+
+            if (auto bank = cart->ram_bank()) {
+                write_pages[0xA] = bank;
+                write_pages[0xB] = bank + 0x1000;
+            }
+        }
+
+        write_pages[0xC] = &wram[0];
+        write_pages[0xD] = &wram[wram_bank_num * 0x1000];
+        write_pages[0xE] = &wram[0];
+
+        for (size_t page = 0xA; page < 0xF; ++page) {
+            read_pages[page] = write_pages[page];
+        }
+    }
+
+    void MainBus::map_io() {
+        const auto map = [this](uint8_t first, uint8_t last, IORegister handler) {
+            for (size_t address = first; address <= last; ++address) {
+                io_handlers[address] = handler;
+            }
+        };
+
+        // Unused addresses read back as 0xFF and ignore writes.
+        map(0x00, 0xFF, {[](Core *, uint8_t) -> uint8_t { return 0xFF; },
+                         [](Core *, uint8_t, uint8_t) {}});
+
+        // Input
+        map(0x00, 0x00,
+            {[](Core *core, uint8_t) { return core->pad.read_p1(core->scheduler.now()); },
+             [](Core *core, uint8_t, uint8_t value) { core->pad.select_button_mode(value); }});
+
+        // Timer
+        map(0x04, 0x07, {[](Core *core, uint8_t address) {
+                             return core->timer.read_register(address);
+                         },
+                         [](Core *core, uint8_t address, uint8_t value) {
+                             core->timer.write_register(address, value);
+                         }});
+
+        map(0x0F, 0x0F, {[](Core *core, uint8_t) { return core->cpu.interrupt_flag; },
+                         [](Core *core, uint8_t, uint8_t value) {
+                             core->cpu.interrupt_flag = value;
+                         }});
+
+        // APU
+        map(0x10, 0x27, {[](Core *core, uint8_t address) {
+                             core->apu.sync(core->scheduler.now());
+                             return core->apu.read_register(address);
+                         },
+                         [](Core *core, uint8_t address, uint8_t value) {
+                             core->apu.sync(core->scheduler.now());
+                             core->apu.write_register(address, value);
+                         }});
+
+        // APU Wave RAM
+        map(0x30, 0x3F, {[](Core *core, uint8_t address) {
+                             core->apu.sync(core->scheduler.now());
+                             return core->apu.read_wave_ram(address - 0x30);
+                         },
+                         [](Core *core, uint8_t address, uint8_t value) {
+                             core->apu.sync(core->scheduler.now());
+                             core->apu.write_wave_ram(address - 0x30, value);
+                         }});
+
+        // PPU Registers
+        IORegister ppu_register{[](Core *core, uint8_t address) {
+                                    core->ppu.sync();
+                                    return core->ppu.read_register(address);
+                                },
+                                [](Core *core, uint8_t address, uint8_t value) {
+                                    core->ppu.sync();
+                                    core->ppu.write_register(address, value);
+                                }};
+
+        map(0x40, 0x4B, ppu_register);
+        map(0x4F, 0x4F, ppu_register);
+        map(0x68, 0x6C, ppu_register);
+
+        // LY is read only.
+        io_handlers[0x44].write = [](Core *, uint8_t, uint8_t) {};
+
+        map(0x4C, 0x4C, {[](Core *core, uint8_t) { return core->bus.KEY0; },
+                         [](Core *core, uint8_t, uint8_t value) {
+                             if (core->bus.bootstrap_mapped_) {
+                                 core->bus.KEY0 = value;
+                             }
+                         }});
+
+        map(0x4D, 0x4D, {[](Core *core, uint8_t) -> uint8_t {
+                             return core->bus.is_compatibility_mode() ? 0xFF : core->cpu.KEY1;
+                         },
+                         [](Core *core, uint8_t, uint8_t value) {
+                             core->cpu.KEY1 &= ~0x1;
+                             core->cpu.KEY1 |= value & 0x1;
+                         }});
+
+        map(0x50, 0x50, {[](Core *core, uint8_t) -> uint8_t {
+                             return core->bus.bootstrap_mapped_;
+                         },
+                         [](Core *core, uint8_t, uint8_t) {
+                             core->bus.bootstrap_mapped_ = false;
+                             core->bus.map_pages();
+                         }});
+
+        // HDMA
+        io_handlers[0x51].write = [](Core *core, uint8_t, uint8_t value) {
+            core->dma.set_hdma1(value);
+        };
+        io_handlers[0x52].write = [](Core *core, uint8_t, uint8_t value) {
+            core->dma.set_hdma2(value);
+        };
+        io_handlers[0x53].write = [](Core *core, uint8_t, uint8_t value) {
+            core->dma.set_hdma3(value);
+        };
+        io_handlers[0x54].write = [](Core *core, uint8_t, uint8_t value) {
+            core->dma.set_hdma4(value);
+        };
+
+        map(0x55, 0x55, {[](Core *core, uint8_t) { return core->dma.get_dma_status(); },
+                         [](Core *core, uint8_t, uint8_t value) {
+                             core->dma.set_dma_control(value);
+                         }});
+
+        map(0x70, 0x70, {[](Core *core, uint8_t) { return core->bus.wram_bank_num; },
+                         [](Core *core, uint8_t, uint8_t value) {
+                             value &= 0x7;
+                             core->bus.wram_bank_num = value ? value : 1;
+                             core->bus.map_pages();
+                         }});
+
+        // High Ram
+        map(0x80, 0xFE, {[](Core *core, uint8_t address) { return core->bus.hram[address - 0x80]; },
+                         [](Core *core, uint8_t address, uint8_t value) {
+                             core->bus.hram[address - 0x80] = value;
+                         }});
+
+        map(0xFF, 0xFF, {[](Core *core, uint8_t) { return core->cpu.interrupt_enable; },
+                         [](Core *core, uint8_t, uint8_t value) {
+                             core->cpu.interrupt_enable = value;
+                         }});
+    }
+
+    void MainBus::set_io_counting(bool enabled) {
+        if (!enabled) {
+            io_registers = io_handlers;
+            return;
+        }
+
+        io_counts = {};
+        io_registers.fill({[](Core *core, uint8_t address) {
+                               auto &bus = core->bus;
+                               bus.io_counts.reads[address]++;
+                               return bus.io_handlers[address].read(core, address);
+                           },
+                           [](Core *core, uint8_t address, uint8_t value) {
+                               auto &bus = core->bus;
+                               bus.io_counts.writes[address]++;
+                               bus.io_handlers[address].write(core, address, value);
+                           }});
+    }
+
+    void MainBus::sync_cartridge() {
+        uint64_t now = core->scheduler.now();
+
+        if (cart) {
+            cart->tick(static_cast<int32_t>(now - cart_timestamp));
+        }
+
+        cart_timestamp = now;
     }
 
-    uint8_t MainBus::read(uint16_t address) {
+    uint8_t MainBus::read_slow(uint16_t address) {
         auto page = address >> 12;
 
         switch (page) {
@@ -72,6 +263,7 @@ namespace GB {
         case 0xA:
         case 0xB: {
             if (cart) {
+                sync_cartridge();
                 return cart->read_ram(address & 0x1FFF);
             }
             return 0xFF;
@@ -96,126 +288,9 @@ namespace GB {
                 return core->ppu.read_oam(address & 0xFF);
             }
             case 0xFF: {
-                auto io_address = address & 0xFF;
-
-                switch (io_address) {
-                // Input
-                case 0x00: {
-                    return core->pad.get_pad_state();
-                }
-
-                // Serial Port
-                case 0x01:
-                case 0x02: {
-                    return 0xFF;
-                }
-
-                // Timer
-                case 0x04:
-                case 0x05:
-                case 0x06:
-                case 0x07: {
-                    return core->timer.read_register(io_address);
-                }
-
-                case 0x0F: {
-                    return core->cpu.interrupt_flag;
-                }
-
-                // APU
-                case 0x10:
-                case 0x11:
-                case 0x12:
-                case 0x13:
-                case 0x14:
-                case 0x15:
-                case 0x16:
-                case 0x17:
-                case 0x18:
-                case 0x19:
-                case 0x1A:
-                case 0x1B:
-                case 0x1C:
-                case 0x1D:
-                case 0x1E:
-                case 0x1F:
-                case 0x20:
-                case 0x21:
-                case 0x22:
-                case 0x23:
-                case 0x24:
-                case 0x25:
-                case 0x26:
-                case 0x27: {
-                    return core->apu.read_register(io_address);
-                }
-
-                // APU Wave RAM
-                case 0x30:
-                case 0x31:
-                case 0x32:
-                case 0x33:
-                case 0x34:
-                case 0x35:
-                case 0x36:
-                case 0x37:
-                case 0x38:
-                case 0x39:
-                case 0x3A:
-                case 0x3B:
-                case 0x3C:
-                case 0x3D:
-                case 0x3E:
-                case 0x3F: {
-                    return core->apu.read_wave_ram(io_address - 0x30);
-                }
+                auto io_address = static_cast<uint8_t>(address & 0xFF);
 
-                // PPU Registers
-                case 0x40:
-                case 0x41:
-                case 0x42:
-                case 0x43:
-                case 0x44:
-                case 0x45:
-                case 0x46:
-                case 0x47:
-                case 0x48:
-                case 0x49:
-                case 0x4A:
-                case 0x4B:
-                case 0x4F:
-                case 0x68:
-                case 0x69:
-                case 0x6A:
-                case 0x6B:
-                case 0x6C: {
-                    return core->ppu.read_register(io_address);
-                }
-
-                case 0x4C: {
-                    return KEY0;
-                }
-                case 0x4D: {
-                    return is_compatibility_mode() ? 0xFF : core->cpu.KEY1;
-                }
-                case 0x50: {
-                    return bootstrap_mapped_;
-                }
-                case 0x55: {
-                    return core->dma.get_dma_status();
-                }
-                case 0x70: {
-                    return wram_bank_num;
-                }
-                }
-
-                if ((address >= 0xFF80) && (address <= 0xFFFE)) {
-                    return hram[address - 0xFF80]; // High Ram
-                } else if (address == 0xFFFF) {
-                    return core->cpu.interrupt_enable;
-                }
-
-                return 0xFF; // IO Registers
+                return io_registers[io_address].read(core, io_address);
             }
             }
 
@@ -226,7 +301,7 @@ namespace GB {
         return 0;
     }
 
-    void MainBus::write(uint16_t address, uint8_t value) {
+    void MainBus::write_slow(uint16_t address, uint8_t value) {
         auto page = address >> 12;
 
         switch (page) {
@@ -242,19 +317,23 @@ namespace GB {
                 if ((address < 0x100) || (address > 0x1FF)) {
                     return;
                 } else if (cart) {
+                    sync_cartridge();
                     cart->write(address, value);
                 }
             } else {
                 if (cart) {
+                    sync_cartridge();
                     cart->write(address, value);
                 }
             }
 
+            map_pages();
             return;
         }
 
         case 0x8:
         case 0x9: {
+            core->ppu.sync();
             core->ppu.write_vram(address & 0x1FFF, value);
             return;
         }
@@ -262,6 +341,7 @@ namespace GB {
         case 0xA:
         case 0xB: {
             if (cart) {
+                sync_cartridge();
                 cart->write_ram(address & 0x1FFF, value);
             }
             return;
@@ -289,162 +369,28 @@ namespace GB {
                 return;
             }
             case 0xFE: {
+                core->ppu.sync();
                 core->ppu.write_oam(address & 0xFF, value);
                 return;
             }
             case 0xFF: {
-                auto io_address = address & 0xFF;
-
-                switch (io_address) {
-                // Input
-                case 0x00: {
-                    core->pad.select_button_mode(value);
-                    return;
-                }
-
-                // Timer
-                case 0x04:
-                case 0x05:
-                case 0x06:
-                case 0x07: {
-                    core->timer.write_register(io_address, value);
-                    return;
-                }
-
-                case 0x0F: {
-                    core->cpu.interrupt_flag = value;
-                    return;
-                }
-
-                // APU
-                case 0x10:
-                case 0x11:
-                case 0x12:
-                case 0x13:
-                case 0x14:
-                case 0x15:
-                case 0x16:
-                case 0x17:
-                case 0x18:
-                case 0x19:
-                case 0x1A:
-                case 0x1B:
-                case 0x1C:
-                case 0x1D:
-                case 0x1E:
-                case 0x1F:
-                case 0x20:
-                case 0x21:
-                case 0x22:
-                case 0x23:
-                case 0x24:
-                case 0x25:
-                case 0x26:
-                case 0x27: {
-                    core->apu.write_register(io_address, value);
-                    return;
-                }
-
-                // APU Wave RAM
-                case 0x30:
-                case 0x31:
-                case 0x32:
-                case 0x33:
-                case 0x34:
-                case 0x35:
-                case 0x36:
-                case 0x37:
-                case 0x38:
-                case 0x39:
-                case 0x3A:
-                case 0x3B:
-                case 0x3C:
-                case 0x3D:
-                case 0x3E:
-                case 0x3F: {
-                    core->apu.write_wave_ram(io_address - 0x30, value);
-                    return;
-                }
-
-                // PPU Registers
-                case 0x40:
-                case 0x41:
-                case 0x42:
-                case 0x43:
-                case 0x45:
-                case 0x46:
-                case 0x47:
-                case 0x48:
-                case 0x49:
-                case 0x4A:
-                case 0x4B:
-                case 0x4F:
-                case 0x68:
-                case 0x69:
-                case 0x6A:
-                case 0x6B:
-                case 0x6C: {
-                    core->ppu.write_register(io_address, value);
-                    return;
-                }
-
-                case 0x4C: {
-                    if (bootstrap_mapped_) {
-                        KEY0 = value;
-                    }
-                    return;
-                }
-
-                case 0x4D: {
-                    core->cpu.KEY1 &= ~0x1;
-                    core->cpu.KEY1 |= value & 0x1;
-                    return;
-                }
-
-                case 0x50: {
-                    bootstrap_mapped_ = false;
-                    return;
-                }
-                case 0x51: {
-                    core->dma.set_hdma1(value);
-                    return;
-                }
-                case 0x52: {
-                    core->dma.set_hdma2(value);
-                    return;
-                }
-                case 0x53: {
-                    core->dma.set_hdma3(value);
-                    return;
-                }
-                case 0x54: {
-                    core->dma.set_hdma4(value);
-                    return;
-                }
-                case 0x55: {
-                    core->dma.set_dma_control(value);
-                    return;
-                }
-
-                case 0x70: {
-                    value &= 0x7;
-                    wram_bank_num = value ? value : 1;
-                    return;
-                }
-                }
-
-                if ((address >= 0xFF80) && (address <= 0xFFFE)) {
-                    hram[address - 0xFF80] = value; // High Ram
-                    return;
-                } else if (address == 0xFFFF) {
-                    core->cpu.interrupt_enable = value;
-                    return;
-                }
+                auto io_address = static_cast<uint8_t>(address & 0xFF);
 
+                io_registers[io_address].write(core, io_address, value);
                 return;
             }
             }
         }
         }
     }
-}
\ No newline at end of file
+
+    void MainBus::serialize(StateArchive &archive) {
+        archive(bootstrap_mapped_, wram_bank_num, KEY0, wram, hram, cart_timestamp);
+
+        if (cart) {
+            cart->serialize(archive);
+        }
+
+        map_pages();
+    }
+}
@@ -23,20 +23,65 @@
 namespace GB {
     class Cartridge;
     class Core;
+    class StateArchive;
+
+    /*
+        Handlers for a single address in 0xFF00-0xFFFF, the address passed to them is the low byte.
+    */
+    struct IORegister {
+        uint8_t (*read)(Core *core, uint8_t address);
+        void (*write)(Core *core, uint8_t address, uint8_t value);
+    };
+
+    struct IOAccessCounts {
+        std::array<uint64_t, 256> reads{};
+        std::array<uint64_t, 256> writes{};
+    };
 
     class MainBus {
     public:
         MainBus(Core *core);
 
-        bool bootstrap_mapped() const;
+        bool bootstrap_mapped() const { return bootstrap_mapped_; }
         bool is_compatibility_mode() const;
+        Cartridge *cartridge() const { return cart; }
 
         void reset(Cartridge *new_cart);
 
-        uint8_t read(uint16_t address);
-        void write(uint16_t address, uint8_t value);
+        uint8_t read(uint16_t address) {
+            if (auto page = read_pages[address >> 12]) {
+                return page[address & 0xFFF];
+            }
+
+            return read_slow(address);
+        }
+
+        void write(uint16_t address, uint8_t value) {
+            if (auto page = write_pages[address >> 12]) {
+                page[address & 0xFFF] = value;
+                return;
+            }
+
+            write_slow(address, value);
+        }
+
+        /*
+            Swaps the IO table for one that counts every access before calling the real handler, so
+            the dispatch in read_slow/write_slow stays the same whether counting or not. Enabling
+            clears the previous counts.
+        */
+        void set_io_counting(bool enabled);
+        const IOAccessCounts &io_access_counts() const { return io_counts; }
+
+        void serialize(StateArchive &archive);
 
     private:
+        uint8_t read_slow(uint16_t address);
+        void write_slow(uint16_t address, uint8_t value);
+        void map_pages();
+        void map_io();
+        void sync_cartridge();
+
         bool bootstrap_mapped_ = true;
         uint8_t wram_bank_num = 1;
         uint8_t KEY0 = 0x0;
@@ -44,6 +89,23 @@ namespace GB {
         std::array<uint8_t, 32768> wram{};
         std::array<uint8_t, 127> hram{};
 
+        /*
+            Pointers to the memory behind each 4 KiB page, nullptr for pages that need the slow
+            path (VRAM, OAM, IO, RTC and anything the cartridge can't map directly). Rebuilt by
+            map_pages() whenever the WRAM bank, the bootstrap or a cartridge bank register changes.
+        */
+        std::array<const uint8_t *, 16> read_pages{};
+        std::array<uint8_t *, 16> write_pages{};
+
+        /*
+            io_handlers is built once by map_io(), io_registers is the table the bus dispatches
+            through and holds either a copy of it or the counting handlers.
+        */
+        std::array<IORegister, 256> io_handlers{};
+        std::array<IORegister, 256> io_registers{};
+        IOAccessCounts io_counts{};
+
+        uint64_t cart_timestamp = 0;
         Cartridge *cart = nullptr;
         Core *core;
 
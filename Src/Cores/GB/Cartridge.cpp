@@ -18,12 +18,19 @@
 
 #include "Cartridge.hpp"
 #include "Constants.hpp"
+#include "StateArchive.hpp"
 #include <fstream>
 
 namespace GB {
-    Cartridge::Cartridge(CartHeader &&header) : header_(std::move(header)) {}
+    Mapper::Mapper(CartHeader &&header) : header_(std::move(header)) {}
 
-    const CartHeader &Cartridge::header() const { return header_; }
+    const uint8_t *Mapper::bank_at(const std::vector<uint8_t> &rom, uint32_t offset) {
+        if (offset + 0x4000 > rom.size()) {
+            return nullptr;
+        }
+
+        return &rom[offset];
+    }
 
     std::unique_ptr<Cartridge> Cartridge::from_file(std::filesystem::path rom_path) {
         return std::unique_ptr<Cartridge>(from_file_raw_ptr(std::move(rom_path)));
@@ -69,20 +76,20 @@ namespace GB {
             switch (header.mbc_type) {
             case 0x00: // ROM ONLY
             {
-                mbc = new ROM(std::move(header));
+                mbc = new Cartridge(std::in_place_type<ROM>, std::move(header));
                 break;
             }
             case 0x01: // MBC1
             case 0x02: // MBC1+RAM
             case 0x03: // MBC1+RAM+BATTERY
             {
-                mbc = new MBC1(std::move(header));
+                mbc = new Cartridge(std::in_place_type<MBC1>, std::move(header));
                 break;
             }
             case 0x05: // MBC2
             case 0x06: // MBC2+BATTERY
             {
-                mbc = new MBC2(std::move(header));
+                mbc = new Cartridge(std::in_place_type<MBC2>, std::move(header));
                 break;
             }
 
@@ -92,7 +99,7 @@ namespace GB {
             case 0x12: // MBC3+RAM
             case 0x13: // MBC3+RAM+BATTERY
             {
-                mbc = new MBC3(std::move(header));
+                mbc = new Cartridge(std::in_place_type<MBC3>, std::move(header));
                 break;
             }
 
@@ -103,7 +110,7 @@ namespace GB {
             case 0x1D: // MBC5+RUMBLE+RAM
             case 0x1E: // MBC5+RUMBLE+RAM+BATTERY
             {
-                mbc = new MBC5(std::move(header));
+                mbc = new Cartridge(std::in_place_type<MBC5>, std::move(header));
                 break;
             }
             }
@@ -119,7 +126,73 @@ namespace GB {
         return nullptr;
     }
 
-    ROM::ROM(CartHeader &&header) : Cartridge(std::move(header)), rom() {}
+    const CartHeader &Cartridge::header() const {
+        return std::visit([](auto &mbc) -> const CartHeader & { return mbc.header(); }, mapper);
+    }
+
+    bool Cartridge::has_battery() const {
+        return std::visit([](auto &mbc) { return mbc.has_battery(); }, mapper);
+    }
+
+    bool Cartridge::has_rtc() const {
+        auto mbc = std::get_if<MBC3>(&mapper);
+
+        return mbc && mbc->has_rtc();
+    }
+
+    void Cartridge::reset() {
+        std::visit([](auto &mbc) { mbc.reset(); }, mapper);
+    }
+
+    void Cartridge::init_banks(std::ifstream &rom_stream) {
+        std::visit([&](auto &mbc) { mbc.init_banks(rom_stream); }, mapper);
+    }
+
+    uint8_t Cartridge::read(uint16_t address) {
+        return std::visit([address](auto &mbc) { return mbc.read(address); }, mapper);
+    }
+
+    uint32_t Cartridge::rom_offset(uint16_t address) const {
+        return std::visit([address](auto &mbc) { return mbc.rom_offset(address); }, mapper);
+    }
+
+    void Cartridge::write(uint16_t address, uint8_t value) {
+        std::visit([address, value](auto &mbc) { mbc.write(address, value); }, mapper);
+    }
+
+    uint8_t Cartridge::read_ram(uint16_t address) {
+        return std::visit([address](auto &mbc) { return mbc.read_ram(address); }, mapper);
+    }
+
+    void Cartridge::write_ram(uint16_t address, uint8_t value) {
+        std::visit([address, value](auto &mbc) { mbc.write_ram(address, value); }, mapper);
+    }
+
+    const uint8_t *Cartridge::rom_bank(uint16_t address) const {
+        return std::visit([address](auto &mbc) { return mbc.rom_bank(address); }, mapper);
+    }
+
+    uint8_t *Cartridge::ram_bank() {
+        return std::visit([](auto &mbc) { return mbc.ram_bank(); }, mapper);
+    }
+
+    void Cartridge::save_sram_to_file() {
+        std::visit([](auto &mbc) { mbc.save_sram_to_file(); }, mapper);
+    }
+
+    void Cartridge::load_sram_from_file() {
+        std::visit([](auto &mbc) { mbc.load_sram_from_file(); }, mapper);
+    }
+
+    void Cartridge::tick(int32_t cycles) {
+        std::visit([cycles](auto &mbc) { mbc.tick(cycles); }, mapper);
+    }
+
+    void Cartridge::serialize(StateArchive &archive) {
+        std::visit([&](auto &mbc) { mbc.serialize(archive); }, mapper);
+    }
+
+    ROM::ROM(CartHeader &&header) : Mapper(std::move(header)), rom() {}
 
     void ROM::reset() {}
 
@@ -135,19 +208,29 @@ namespace GB {
 
     uint8_t ROM::read(uint16_t address) { return rom[address]; }
 
+    uint32_t ROM::rom_offset(uint16_t address) const { return address; }
+
     void ROM::write(uint16_t address, uint8_t value) {}
 
     uint8_t ROM::read_ram(uint16_t address) { return 0xFF; }
 
     void ROM::write_ram(uint16_t address, uint8_t value) {}
 
+    const uint8_t *ROM::rom_bank(uint16_t address) const {
+        return bank_at(rom, rom_offset(address & 0xC000));
+    }
+
+    uint8_t *ROM::ram_bank() { return nullptr; }
+
     void ROM::save_sram_to_file() {}
 
     void ROM::load_sram_from_file() {}
 
     void ROM::tick(int32_t cycles) {}
 
-    MBC1::MBC1(CartHeader &&header) : Cartridge(std::move(header)), eram() { eram.fill(0); }
+    void ROM::serialize(StateArchive &) {}
+
+    MBC1::MBC1(CartHeader &&header) : Mapper(std::move(header)), eram() { eram.fill(0); }
 
     bool MBC1::has_battery() const { return header_.mbc_type == 3; }
 
@@ -183,6 +266,20 @@ namespace GB {
         return rom[(bank_num * 0x4000) + (address & 0x3FFF)];
     }
 
+    uint32_t MBC1::rom_offset(uint16_t address) const {
+        int32_t bank_num = (bank_upper_bits << 5);
+
+        if (address < 0x4000) {
+            bank_num = bank_num % static_cast<int32_t>(rom.size() / 0x4000);
+            return (mode ? (bank_num * 0x4000) : 0) + address;
+        }
+
+        bank_num |= rom_bank_num;
+        bank_num = bank_num % static_cast<int32_t>(rom.size() / 0x4000);
+
+        return (bank_num * 0x4000) + (address & 0x3FFF);
+    }
+
     void MBC1::write(uint16_t address, uint8_t value) {
         switch (address >> 12) {
         case 0x0:
@@ -235,6 +332,18 @@ namespace GB {
         }
     }
 
+    const uint8_t *MBC1::rom_bank(uint16_t address) const {
+        return bank_at(rom, rom_offset(address & 0xC000));
+    }
+
+    uint8_t *MBC1::ram_bank() {
+        if (ram_enabled) {
+            return &eram[mode ? (bank_upper_bits * 0x2000) : 0];
+        }
+
+        return nullptr;
+    }
+
     void MBC1::save_sram_to_file() {
         if (!has_battery()) {
             return;
@@ -272,7 +381,11 @@ namespace GB {
 
     void MBC1::tick(int32_t cycles) {}
 
-    MBC2::MBC2(CartHeader &&header) : Cartridge(std::move(header)) {}
+    void MBC1::serialize(StateArchive &archive) {
+        archive(mode, rom_bank_num, bank_upper_bits, ram_enabled, eram);
+    }
+
+    MBC2::MBC2(CartHeader &&header) : Mapper(std::move(header)) {}
 
     bool MBC2::has_battery() const { return header_.mbc_type == 6; }
 
@@ -302,6 +415,16 @@ namespace GB {
         return rom[(bank * 0x4000) + (address & 0x3FFF)];
     }
 
+    uint32_t MBC2::rom_offset(uint16_t address) const {
+        if (address < 0x4000) {
+            return address;
+        }
+
+        auto bank = rom_bank_num % (rom.size() / 0x4000);
+
+        return static_cast<uint32_t>((bank * 0x4000) + (address & 0x3FFF));
+    }
+
     void MBC2::write(uint16_t address, uint8_t value) {
         if (address < 0x4000) {
             if (address & 0x100) {
@@ -332,6 +455,13 @@ namespace GB {
         }
     }
 
+    const uint8_t *MBC2::rom_bank(uint16_t address) const {
+        return bank_at(rom, rom_offset(address & 0xC000));
+    }
+
+    // Only the low nibble of each byte is stored, reads have to fill in the upper one.
+    uint8_t *MBC2::ram_bank() { return nullptr; }
+
     void MBC2::save_sram_to_file() {
         if (!has_battery()) {
             return;
@@ -369,6 +499,8 @@ namespace GB {
 
     void MBC2::tick(int32_t cycles) {}
 
+    void MBC2::serialize(StateArchive &archive) { archive(rom_bank_num, ram_enabled, ram); }
+
     RTCCounter::RTCCounter(uint8_t bit_mask) : mask(bit_mask) {}
 
     uint8_t RTCCounter::get() const { return counter; }
@@ -383,7 +515,7 @@ namespace GB {
         counter &= mask;
     }
 
-    MBC3::MBC3(CartHeader &&header) : Cartridge(std::move(header)) {}
+    MBC3::MBC3(CartHeader &&header) : Mapper(std::move(header)) {}
 
     bool MBC3::has_rtc() const {
         switch (header_.mbc_type) {
@@ -437,6 +569,14 @@ namespace GB {
         return rom[(rom_bank_num * 0x4000) + (address & 0x3FFF)];
     }
 
+    uint32_t MBC3::rom_offset(uint16_t address) const {
+        if (address < 0x4000) {
+            return address;
+        }
+
+        return (rom_bank_num * 0x4000) + (address & 0x3FFF);
+    }
+
     void MBC3::write(uint16_t address, uint8_t value) {
         switch (address >> 12) {
         case 0x0:
@@ -552,6 +692,19 @@ namespace GB {
         }
     }
 
+    const uint8_t *MBC3::rom_bank(uint16_t address) const {
+        return bank_at(rom, rom_offset(address & 0xC000));
+    }
+
+    uint8_t *MBC3::ram_bank() {
+        // RTC registers are selected through the same register as the RAM banks.
+        if (ram_rtc_enabled && ram_rtc_select < 0x8) {
+            return &eram[ram_rtc_select * 0x2000];
+        }
+
+        return nullptr;
+    }
+
     void MBC3::save_sram_to_file() {
         if (!has_battery()) {
             return;
@@ -591,8 +744,8 @@ namespace GB {
         if (has_rtc() && !(rtc_ctrl & 64)) {
             rtc_cycles += cycles;
 
-            if (rtc_cycles == CPU_CLOCK_RATE) {
-                rtc_cycles = 0;
+            while (rtc_cycles >= CPU_CLOCK_RATE) {
+                rtc_cycles -= CPU_CLOCK_RATE;
                 rtc.seconds.increment();
 
                 if (rtc.seconds.get() == 60) {
@@ -618,7 +771,12 @@ namespace GB {
         }
     }
 
-    MBC5::MBC5(CartHeader &&header) : Cartridge(std::move(header)) {}
+    void MBC3::serialize(StateArchive &archive) {
+        archive(rom_bank_num, ram_rtc_select, ram_rtc_enabled, eram, latch_byte, rtc_cycles, rtc,
+                shadow_rtc, rtc_ctrl);
+    }
+
+    MBC5::MBC5(CartHeader &&header) : Mapper(std::move(header)) {}
 
     bool MBC5::has_battery() const {
         switch (header_.mbc_type) {
@@ -661,6 +819,18 @@ namespace GB {
         return rom[(bank_num * 0x4000) + (address & 0x3FFF)];
     }
 
+    uint32_t MBC5::rom_offset(uint16_t address) const {
+        int32_t bank_num = rom_bank_num | bank_upper_bits;
+
+        if (address < 0x4000) {
+            return address;
+        }
+
+        bank_num = bank_num % static_cast<int32_t>(rom.size() / 0x4000);
+
+        return (bank_num * 0x4000) + (address & 0x3FFF);
+    }
+
     void MBC5::write(uint16_t address, uint8_t value) {
         switch (address >> 12) {
         case 0x0:
@@ -699,6 +869,18 @@ namespace GB {
         }
     }
 
+    const uint8_t *MBC5::rom_bank(uint16_t address) const {
+        return bank_at(rom, rom_offset(address & 0xC000));
+    }
+
+    uint8_t *MBC5::ram_bank() {
+        if (ram_enabled) {
+            return &eram[ram_bank_num * 0x2000];
+        }
+
+        return nullptr;
+    }
+
     void MBC5::save_sram_to_file() {
         if (!has_battery()) {
             return;
@@ -735,4 +917,8 @@ namespace GB {
     }
 
     void MBC5::tick(int32_t cycles) {}
+
+    void MBC5::serialize(StateArchive &archive) {
+        archive(rom_bank_num, bank_upper_bits, ram_bank_num, ram_enabled, eram);
+    }
 }
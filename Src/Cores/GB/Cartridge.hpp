@@ -22,9 +22,13 @@
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <utility>
+#include <variant>
 #include <vector>
 
 namespace GB {
+    class StateArchive;
+
     enum class RomSize {
         Rom32KB = 0,
         Rom64KB = 1,
@@ -67,39 +71,23 @@ namespace GB {
         RamSize ram_size = RamSize::NoRam;
     };
 
-    class Cartridge {
+    /*
+        State shared by the memory bank controllers below. They are only used through the
+        Cartridge that holds one of them.
+    */
+    class Mapper {
     public:
-        explicit Cartridge(CartHeader &&header);
-        virtual ~Cartridge() = default;
-        Cartridge(const Cartridge &) = delete;
-        Cartridge(Cartridge &&) = delete;
-        Cartridge &operator=(const Cartridge &) = delete;
-        Cartridge &operator=(Cartridge &&) = delete;
-
-        const CartHeader &header() const;
-        virtual bool has_battery() const = 0;
-
-        virtual void reset() = 0;
-
-        virtual void init_banks(std::ifstream &rom_stream) = 0;
+        explicit Mapper(CartHeader &&header);
 
-        virtual uint8_t read(uint16_t address) = 0;
-        virtual void write(uint16_t address, uint8_t value) = 0;
-        virtual uint8_t read_ram(uint16_t address) = 0;
-        virtual void write_ram(uint16_t address, uint8_t value) = 0;
-
-        virtual void save_sram_to_file() = 0;
-        virtual void load_sram_from_file() = 0;
-        virtual void tick(int32_t cycles) = 0;
-
-        static std::unique_ptr<Cartridge> from_file(std::filesystem::path rom_path);
-        static Cartridge *from_file_raw_ptr(std::filesystem::path rom_path);
+        const CartHeader &header() const { return header_; }
 
     protected:
+        static const uint8_t *bank_at(const std::vector<uint8_t> &rom, uint32_t offset);
+
         CartHeader header_;
     };
 
-    class ROM : public Cartridge {
+    class ROM : public Mapper {
     public:
         explicit ROM(CartHeader &&header);
         ~ROM() = default;
@@ -108,25 +96,29 @@ namespace GB {
         ROM &operator=(const ROM &) = delete;
         ROM &operator=(ROM &&) = delete;
 
-        bool has_battery() const override { return false; }
+        bool has_battery() const { return false; }
 
-        void reset() override;
-        void init_banks(std::ifstream &rom_stream) override;
+        void reset();
+        void init_banks(std::ifstream &rom_stream);
 
-        uint8_t read(uint16_t address) override;
-        void write(uint16_t address, uint8_t value) override;
-        uint8_t read_ram(uint16_t address) override;
-        void write_ram(uint16_t address, uint8_t value) override;
+        uint8_t read(uint16_t address);
+        uint32_t rom_offset(uint16_t address) const;
+        void write(uint16_t address, uint8_t value);
+        uint8_t read_ram(uint16_t address);
+        void write_ram(uint16_t address, uint8_t value);
+        const uint8_t *rom_bank(uint16_t address) const;
+        uint8_t *ram_bank();
 
-        void save_sram_to_file() override;
-        void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
+        void save_sram_to_file();
+        void load_sram_from_file();
+        void tick(int32_t cycles);
+        void serialize(StateArchive &archive);
 
     private:
         std::vector<uint8_t> rom;
     };
 
-    class MBC1 : public Cartridge {
+    class MBC1 : public Mapper {
     public:
         explicit MBC1(CartHeader &&header);
         ~MBC1() = default;
@@ -135,19 +127,23 @@ namespace GB {
         MBC1 &operator=(const MBC1 &) = delete;
         MBC1 &operator=(MBC1 &&) = delete;
 
-        bool has_battery() const override;
+        bool has_battery() const;
 
-        void reset() override;
-        void init_banks(std::ifstream &rom_stream) override;
+        void reset();
+        void init_banks(std::ifstream &rom_stream);
 
-        uint8_t read(uint16_t addr) override;
-        void write(uint16_t addr, uint8_t value) override;
-        uint8_t read_ram(uint16_t addr) override;
-        void write_ram(uint16_t addr, uint8_t value) override;
+        uint8_t read(uint16_t addr);
+        uint32_t rom_offset(uint16_t addr) const;
+        void write(uint16_t addr, uint8_t value);
+        uint8_t read_ram(uint16_t addr);
+        void write_ram(uint16_t addr, uint8_t value);
+        const uint8_t *rom_bank(uint16_t addr) const;
+        uint8_t *ram_bank();
 
-        void save_sram_to_file() override;
-        void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
+        void save_sram_to_file();
+        void load_sram_from_file();
+        void tick(int32_t cycles);
+        void serialize(StateArchive &archive);
 
     private:
         bool mode = 0;
@@ -159,7 +155,7 @@ namespace GB {
         std::vector<uint8_t> rom{};
     };
 
-    class MBC2 : public Cartridge {
+    class MBC2 : public Mapper {
     public:
         explicit MBC2(CartHeader &&header);
         ~MBC2() = default;
@@ -168,19 +164,23 @@ namespace GB {
         MBC2 &operator=(const MBC2 &) = delete;
         MBC2 &operator=(MBC2 &&) = delete;
 
-        bool has_battery() const override;
+        bool has_battery() const;
 
-        void reset() override;
-        void init_banks(std::ifstream &rom_stream) override;
+        void reset();
+        void init_banks(std::ifstream &rom_stream);
 
-        uint8_t read(uint16_t address) override;
-        void write(uint16_t address, uint8_t value) override;
-        uint8_t read_ram(uint16_t address) override;
-        void write_ram(uint16_t address, uint8_t value) override;
+        uint8_t read(uint16_t address);
+        uint32_t rom_offset(uint16_t address) const;
+        void write(uint16_t address, uint8_t value);
+        uint8_t read_ram(uint16_t address);
+        void write_ram(uint16_t address, uint8_t value);
+        const uint8_t *rom_bank(uint16_t address) const;
+        uint8_t *ram_bank();
 
-        void save_sram_to_file() override;
-        void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
+        void save_sram_to_file();
+        void load_sram_from_file();
+        void tick(int32_t cycles);
+        void serialize(StateArchive &archive);
 
     private:
         uint16_t rom_bank_num = 1;
@@ -210,7 +210,7 @@ namespace GB {
         uint16_t days = 0;
     };
 
-    class MBC3 : public Cartridge {
+    class MBC3 : public Mapper {
     public:
         explicit MBC3(CartHeader &&header);
         ~MBC3() = default;
@@ -220,19 +220,23 @@ namespace GB {
         MBC3 &operator=(MBC3 &&) = delete;
 
         bool has_rtc() const;
-        bool has_battery() const override;
+        bool has_battery() const;
 
-        void reset() override;
-        void init_banks(std::ifstream &rom_stream) override;
+        void reset();
+        void init_banks(std::ifstream &rom_stream);
 
-        uint8_t read(uint16_t addr) override;
-        void write(uint16_t addr, uint8_t value) override;
-        uint8_t read_ram(uint16_t addr) override;
-        void write_ram(uint16_t addr, uint8_t value) override;
+        uint8_t read(uint16_t addr);
+        uint32_t rom_offset(uint16_t addr) const;
+        void write(uint16_t addr, uint8_t value);
+        uint8_t read_ram(uint16_t addr);
+        void write_ram(uint16_t addr, uint8_t value);
+        const uint8_t *rom_bank(uint16_t addr) const;
+        uint8_t *ram_bank();
 
-        void save_sram_to_file() override;
-        void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
+        void save_sram_to_file();
+        void load_sram_from_file();
+        void tick(int32_t cycles);
+        void serialize(StateArchive &archive);
 
     private:
         int32_t rom_bank_num = 1;
@@ -249,7 +253,7 @@ namespace GB {
         uint16_t rtc_ctrl = 0;
     };
 
-    class MBC5 : public Cartridge {
+    class MBC5 : public Mapper {
     public:
         MBC5(CartHeader &&header);
         ~MBC5() = default;
@@ -258,19 +262,23 @@ namespace GB {
         MBC5 &operator=(const MBC5 &) = delete;
         MBC5 &operator=(MBC5 &&) = delete;
 
-        bool has_battery() const override;
+        bool has_battery() const;
 
-        void reset() override;
-        void init_banks(std::ifstream &rom_stream) override;
+        void reset();
+        void init_banks(std::ifstream &rom_stream);
 
-        uint8_t read(uint16_t addr) override;
-        void write(uint16_t addr, uint8_t value) override;
-        uint8_t read_ram(uint16_t addr) override;
-        void write_ram(uint16_t addr, uint8_t value) override;
+        uint8_t read(uint16_t addr);
+        uint32_t rom_offset(uint16_t addr) const;
+        void write(uint16_t addr, uint8_t value);
+        uint8_t read_ram(uint16_t addr);
+        void write_ram(uint16_t addr, uint8_t value);
+        const uint8_t *rom_bank(uint16_t addr) const;
+        uint8_t *ram_bank();
 
-        void save_sram_to_file() override;
-        void load_sram_from_file() override;
-        void tick(int32_t cycles) override;
+        void save_sram_to_file();
+        void load_sram_from_file();
+        void tick(int32_t cycles);
+        void serialize(StateArchive &archive);
 
     private:
         int32_t rom_bank_num = 1;
@@ -281,4 +289,54 @@ namespace GB {
         std::array<uint8_t, 131072> eram{};
         std::vector<uint8_t> rom{};
     };
+
+    /*
+        The mapper is picked when the ROM is loaded and stored by value, every access dispatches on
+        the variant index so the mapper's functions can be inlined instead of called virtually.
+    */
+    class Cartridge {
+    public:
+        template <typename T>
+        Cartridge(std::in_place_type_t<T> type, CartHeader &&header)
+            : mapper(type, std::move(header)) {}
+        Cartridge(const Cartridge &) = delete;
+        Cartridge(Cartridge &&) = delete;
+        Cartridge &operator=(const Cartridge &) = delete;
+        Cartridge &operator=(Cartridge &&) = delete;
+
+        const CartHeader &header() const;
+        bool has_battery() const;
+        bool has_rtc() const;
+
+        void reset();
+
+        void init_banks(std::ifstream &rom_stream);
+
+        uint8_t read(uint16_t address);
+
+        // Offset into the ROM image that a read from address would return, address < 0x8000.
+        uint32_t rom_offset(uint16_t address) const;
+        void write(uint16_t address, uint8_t value);
+        uint8_t read_ram(uint16_t address);
+        void write_ram(uint16_t address, uint8_t value);
+
+        /*
+            Memory backing the 16 KiB ROM bank that contains address and the 8 KiB RAM bank at
+            A000, or nullptr when it has to go through read() or read_ram() and write_ram(). The
+            pointers stay valid until the next write().
+        */
+        const uint8_t *rom_bank(uint16_t address) const;
+        uint8_t *ram_bank();
+
+        void save_sram_to_file();
+        void load_sram_from_file();
+        void tick(int32_t cycles);
+        void serialize(StateArchive &archive);
+
+        static std::unique_ptr<Cartridge> from_file(std::filesystem::path rom_path);
+        static Cartridge *from_file_raw_ptr(std::filesystem::path rom_path);
+
+    private:
+        std::variant<ROM, MBC1, MBC2, MBC3, MBC5> mapper;
+    };
 }
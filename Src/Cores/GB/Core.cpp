@@ -19,9 +19,21 @@
 #include "Core.hpp"
 #include "Constants.hpp"
 #include "PPU.hpp"
+#include "StateArchive.hpp"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 
 namespace GB {
+    struct StateHeader {
+        uint32_t magic = SAVE_STATE_MAGIC;
+        uint32_t version = SAVE_STATE_VERSION;
+        uint32_t size = 0;
+        uint16_t rom_checksum = 0;
+        uint8_t mbc_type = 0;
+        uint8_t bootstrap_mapped = 0;
+    };
+
     Core::Core() : bus(this), ppu(this), timer(this), cpu(this), dma(this) {}
 
     void Core::initialize(Cartridge *cart) {
@@ -32,6 +44,8 @@ namespace GB {
 
         cart->reset();
         bootstrap.clear();
+        state_size = 0;
+        scheduler.reset();
         apu.reset();
         ppu.reset();
         timer.reset();
@@ -54,9 +68,11 @@ namespace GB {
             }
 
             bus.bootstrap_mapped_ = false;
+            bus.map_pages();
 
             cpu.reset(0x0100);
             ppu.set_post_boot_state();
+            schedule_initial_events();
         }
     }
 
@@ -70,6 +86,8 @@ namespace GB {
 
         cart->reset();
         bootstrap.clear();
+        state_size = 0;
+        scheduler.reset();
         apu.reset();
         ppu.reset();
         timer.reset();
@@ -90,33 +108,40 @@ namespace GB {
             }
 
             cpu.reset(0x0);
+            schedule_initial_events();
         }
     }
 
     void Core::run_for_frames(int32_t frames) {
         while (frames-- && ready_to_run) {
-            while (cycle_count < CYCLES_PER_FRAME && !cpu.stopped()) {
-                dma.tick();
-                cpu.step();
-            }
-
-            if (cycle_count >= CYCLES_PER_FRAME) {
-                cycle_count -= CYCLES_PER_FRAME;
-            }
+            run_until_vblank();
         }
     }
 
-    void Core::tick_subcomponents(int32_t cycles) {
-        int32_t adjusted_cycles = cpu.double_speed() ? 2 : 4;
+    void Core::run_for_cycles(uint64_t cycles) {
+        // The predicate is constant so the check is compiled out of the loop.
+        run(cycles, true, [] { return false; });
+    }
 
-        while (cycles > 0) {
-            timer.update(4);
-            ppu.step(adjusted_cycles);
-            apu.step(adjusted_cycles);
-            bus.cart->tick(adjusted_cycles);
-            cycle_count += adjusted_cycles;
-            cycles -= 4;
-        }
+    void Core::run_single_block(uint64_t max_cycles) {
+        run(max_cycles, true, [] { return true; });
+    }
+
+    bool Core::run_until_vblank() {
+        auto vblank = ppu.vblank_count();
+
+        return run(CYCLES_PER_FRAME, true, [&] { return ppu.vblank_count() != vblank; });
+    }
+
+    void Core::skip_to_next_event() {
+        // Skips whole M-cycles up to the one in which the next event is due or the run ends,
+        // that one is left to the caller so it is processed exactly like any other access.
+        uint64_t dots = cpu.double_speed() ? 2 : 4;
+        uint64_t until_event = (scheduler.next_deadline() - scheduler.now() - 1) / dots;
+        uint64_t until_run_end = (run_end - scheduler.now() - 1) / dots;
+        uint64_t skipped = std::min(until_event, until_run_end) * dots;
+
+        scheduler.advance(skipped);
     }
 
     void Core::load_bootstrap(std::filesystem::path path) {
@@ -139,4 +164,112 @@ namespace GB {
     }
 
     uint8_t Core::read_bootstrap(uint16_t address) { return bootstrap[address]; }
-}
\ No newline at end of file
+
+    uint64_t Core::elapsed_cycles() const { return scheduler.now(); }
+
+    void Core::save_state(std::vector<uint8_t> &state) {
+        StateHeader header{};
+
+        if (bus.cart) {
+            header.rom_checksum = bus.cart->header().checksum;
+            header.mbc_type = bus.cart->header().mbc_type;
+        }
+
+        header.bootstrap_mapped = bus.bootstrap_mapped();
+
+        // The size only depends on the cartridge type, so it is measured once per cartridge and
+        // the state is written straight into a buffer of that size.
+        if (!state_size) {
+            StateArchive measure;
+            measure(header);
+            serialize(measure);
+
+            state_size = measure.position();
+        }
+
+        state.resize(state_size);
+
+        StateArchive archive(state);
+        archive(header);
+        serialize(archive);
+
+        state.resize(archive.position());
+        header.size = static_cast<uint32_t>(state.size());
+        std::memcpy(state.data(), &header, sizeof(header));
+    }
+
+    bool Core::load_state(std::span<const uint8_t> state) {
+        StateHeader header{};
+
+        if (state.size() < sizeof(header)) {
+            return false;
+        }
+
+        std::memcpy(&header, state.data(), sizeof(header));
+
+        if (header.magic != SAVE_STATE_MAGIC || header.version != SAVE_STATE_VERSION ||
+            header.size != state.size()) {
+            return false;
+        }
+
+        if (!bus.cart || header.rom_checksum != bus.cart->header().checksum ||
+            header.mbc_type != bus.cart->header().mbc_type) {
+            return false;
+        }
+
+        if (header.bootstrap_mapped && bootstrap.empty()) {
+            return false;
+        }
+
+        StateArchive archive(state);
+        archive(header);
+        serialize(archive);
+
+        return archive.good();
+    }
+
+    void Core::schedule_initial_events() {
+        ppu.sync();
+        timer.schedule_events();
+
+        if (bus.cart->has_rtc()) {
+            scheduler.schedule(EventType::RTC, CPU_CLOCK_RATE);
+        }
+    }
+
+    void Core::run_events() {
+        for (auto event = scheduler.pop_due_event(); event != EventType::Count;
+             event = scheduler.pop_due_event()) {
+            switch (event) {
+            case EventType::PPU: {
+                ppu.sync();
+                break;
+            }
+            case EventType::TimerOverflow:
+            case EventType::FrameSequencer: {
+                timer.sync();
+                timer.schedule_events();
+                break;
+            }
+            case EventType::RTC: {
+                bus.sync_cartridge();
+                scheduler.schedule(EventType::RTC, scheduler.now() + CPU_CLOCK_RATE);
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+
+    void Core::serialize(StateArchive &archive) {
+        scheduler.serialize(archive);
+        pad.serialize(archive);
+        bus.serialize(archive);
+        ppu.serialize(archive);
+        apu.serialize(archive);
+        timer.serialize(archive);
+        cpu.serialize(archive);
+        dma.serialize(archive);
+    }
+}
@@ -20,18 +20,22 @@
 #include "APU.hpp"
 #include "Bus.hpp"
 #include "Cartridge.hpp"
+#include "Constants.hpp"
 #include "DMA.hpp"
 #include "PPU.hpp"
 #include "Pad.hpp"
 #include "SM83.hpp"
+#include "Scheduler.hpp"
 #include "Timer.hpp"
 #include <cinttypes>
 #include <filesystem>
+#include <span>
 #include <vector>
 
 namespace GB {
     class Core {
     public:
+        Scheduler scheduler;
         Gamepad pad;
         MainBus bus;
         PPU ppu;
@@ -44,15 +48,110 @@ namespace GB {
         void initialize(Cartridge *cart);
         void initialize_with_bootstrap(Cartridge *cart, ConsoleType console,
                                        std::filesystem::path bootstrap_path);
+
+        /*
+            Runs stop at the end of the instruction in which their condition is met, so they can
+            overshoot by a few cycles. Cycles are counted in dots, the same as elapsed_cycles.
+
+            A frame ends when the PPU enters VBlank, or after CYCLES_PER_FRAME while the LCD is off.
+            run_until checks its predicate after every instruction and returns whether it fired
+            before max_cycles ran out, for example:
+
+                core.run_until([&] { return core.cpu.program_counter() == 0x150; });
+
+            The other runs can execute a whole block at once with the cached interpreter or the
+            recompiler, blocks stop after any instruction that raises an interrupt, which includes
+            VBlank, so these runs still end on the same instruction. They also skip idle loops
+            when enabled, which never goes past an event or the end of the run.
+        */
         void run_for_frames(int32_t frames);
+        void run_for_cycles(uint64_t cycles);
+        bool run_until_vblank();
+        template <typename Predicate>
+        bool run_until(Predicate &&predicate, uint64_t max_cycles = CYCLES_PER_FRAME);
+
+        // Runs one block, skipped idle loop or instruction the way the runs above do, with the run
+        // ending max_cycles from now. Lets them be checked against the interpreter block by block.
+        void run_single_block(uint64_t max_cycles);
+
         void tick_subcomponents(int32_t cycles);
+        void skip_to_next_event();
         void load_bootstrap(std::filesystem::path path);
 
         uint8_t read_bootstrap(uint16_t address);
+        uint64_t elapsed_cycles() const;
+
+        /*
+            A state can only be loaded into a core running the same cartridge, load_state returns
+            false and leaves the core untouched otherwise.
+        */
+        void save_state(std::vector<uint8_t> &state);
+        bool load_state(std::span<const uint8_t> state);
 
     private:
+        template <typename Predicate>
+        bool run(uint64_t cycles, bool allow_compiled, Predicate &&predicate);
+
+        void schedule_initial_events();
+        void run_events();
+        void serialize(StateArchive &archive);
+
         bool ready_to_run = false;
-        int32_t cycle_count = 0;
+        uint64_t run_end = 0;
+        size_t state_size = 0;
         std::vector<uint8_t> bootstrap{};
     };
+
+    // Called on every memory access, so it is kept inline with the instruction handlers.
+    inline void Core::tick_subcomponents(int32_t cycles) {
+        int32_t dots = cpu.double_speed() ? cycles / 2 : cycles;
+
+        scheduler.advance(dots);
+
+        if (scheduler.has_due_events()) {
+            run_events();
+        }
+    }
+
+    template <typename Predicate>
+    bool Core::run_until(Predicate &&predicate, uint64_t max_cycles) {
+        return run(max_cycles, false, predicate);
+    }
+
+    template <typename Predicate>
+    bool Core::run(uint64_t cycles, bool allow_compiled, Predicate &&predicate) {
+        if (!ready_to_run) {
+            return false;
+        }
+
+        // STOP halts the whole system until a button on the selected line is pressed.
+        if (cpu.stopped() && (pad.get_pad_state() & 0xF) != 0xF) {
+            cpu.exit_stop_mode();
+        }
+
+        bool triggered = false;
+        run_end = scheduler.now() + cycles;
+
+        while (scheduler.now() < run_end && !cpu.stopped()) {
+            dma.tick();
+
+            if (allow_compiled) {
+                cpu.skip_idle_loop(run_end);
+            }
+
+            if (!allow_compiled || !cpu.run_block(run_end)) {
+                cpu.step();
+            }
+
+            if (predicate()) {
+                triggered = true;
+                break;
+            }
+        }
+
+        ppu.sync();
+        apu.sync(scheduler.now());
+
+        return triggered;
+    }
 }
\ No newline at end of file
@@ -19,6 +19,7 @@
 #include "DMA.hpp"
 #include "Core.hpp"
 #include "PPU.hpp"
+#include "StateArchive.hpp"
 #include <stdexcept>
 
 namespace GB {
@@ -38,7 +39,7 @@ namespace GB {
 
     void DMAController::reset() {
         active = false;
-        is_mode0 = false;
+        boundary_timestamp = 0;
         src_address = 0;
         dst_address = 0;
         current_length = 0x7F;
@@ -81,8 +82,14 @@ namespace GB {
         return stat | (current_length & 0x7F);
     }
 
+    bool DMAController::is_active() const { return active; }
+
+    void DMAController::set_instruction_boundary(uint64_t timestamp) {
+        boundary_timestamp = timestamp;
+    }
+
     void DMAController::tick() {
-        bool mode0_now = (core->ppu.read_register(0x41) & 0x3) == HBLANK;
+        uint64_t now = core->scheduler.now();
 
         if (active) {
             switch (type) {
@@ -96,7 +103,11 @@ namespace GB {
                 break;
             }
             case DMAType::HDMA: {
-                if (!is_mode0 && mode0_now) {
+                // A block is copied once per HBlank, at the first instruction boundary after it
+                // started.
+                core->ppu.sync();
+
+                if (core->ppu.hblank_started_after(boundary_timestamp)) {
                     transfer_block();
 
                     if (current_length) {
@@ -111,7 +122,7 @@ namespace GB {
             }
         }
 
-        is_mode0 = mode0_now;
+        boundary_timestamp = now;
     }
 
     void DMAController::transfer_block() {
@@ -128,6 +139,7 @@ namespace GB {
                 core->tick_subcomponents(4);
             }
 
+            core->ppu.sync();
             core->ppu.write_vram(dst_address & 0x1FFF, data);
 
             src_address++;
@@ -135,4 +147,7 @@ namespace GB {
         }
     }
 
-}
\ No newline at end of file
+    void DMAController::serialize(StateArchive &archive) {
+        archive(active, current_length, src_address, dst_address, boundary_timestamp, type);
+    }
+}
@@ -21,6 +21,7 @@
 
 namespace GB {
     class Core;
+    class StateArchive;
 
     enum class DMAType { GDMA, HDMA };
 
@@ -41,14 +42,21 @@ namespace GB {
         void set_hdma3(uint8_t high);
         void set_hdma4(uint8_t low);
 
+        bool is_active() const;
         void tick();
 
+        // Moves the last instruction boundary for instructions that ran without tick(), which is
+        // only possible while no transfer is active.
+        void set_instruction_boundary(uint64_t timestamp);
+        void serialize(StateArchive &archive);
+
     private:
         void transfer_block();
 
-        bool active = false, is_mode0 = false;
+        bool active = false;
         uint8_t current_length = 0x7F;
         uint16_t src_address = 0, dst_address = 0;
+        uint64_t boundary_timestamp = 0;
         DMAType type = DMAType::GDMA;
 
         Core *core;
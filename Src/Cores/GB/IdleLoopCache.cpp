@@ -0,0 +1,348 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "IdleLoopCache.hpp"
+#include "Cartridge.hpp"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+namespace GB {
+    constexpr size_t MAX_IDLE_LOOP_INSTRUCTIONS = 16;
+
+    // Bits of the registers written by a loop, in the same order as Register.
+    constexpr uint8_t REGISTER_B = 1;
+    constexpr uint8_t REGISTER_C = 2;
+    constexpr uint8_t REGISTER_D = 4;
+    constexpr uint8_t REGISTER_E = 8;
+    constexpr uint8_t REGISTER_H = 16;
+    constexpr uint8_t REGISTER_L = 32;
+    constexpr uint8_t REGISTER_A = 128;
+
+    struct IdleLoopCacheHeader {
+        uint32_t magic = IDLE_LOOP_CACHE_MAGIC;
+        uint32_t version = IDLE_LOOP_CACHE_VERSION;
+        uint32_t rom_checksum = 0;
+        uint32_t loop_count = 0;
+    };
+
+    template <typename T> static void write_value(std::ofstream &file, const T &value) {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T> static void read_value(std::ifstream &file, T &value) {
+        file.read(reinterpret_cast<char *>(&value), sizeof(T));
+    }
+
+    void IdleLoopCache::clear() { loops.clear(); }
+
+    size_t IdleLoopCache::loop_count() const {
+        return std::count_if(loops.begin(), loops.end(),
+                             [](const auto &entry) { return entry.second.instructions != 0; });
+    }
+
+    const IdleLoop *IdleLoopCache::find(Cartridge &cart, uint16_t address) {
+        uint32_t offset = cart.rom_offset(address);
+        auto entry = loops.find(offset);
+
+        if (entry == loops.end()) {
+            entry = loops.emplace(offset, analyze(cart, address)).first;
+        }
+
+        return entry->second.instructions ? &entry->second : nullptr;
+    }
+
+    bool IdleLoopCache::load(const std::filesystem::path &path, uint16_t rom_checksum) {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            return false;
+        }
+
+        IdleLoopCacheHeader header{};
+        read_value(file, header);
+
+        if (!file || header.magic != IDLE_LOOP_CACHE_MAGIC ||
+            header.version != IDLE_LOOP_CACHE_VERSION || header.rom_checksum != rom_checksum) {
+            return false;
+        }
+
+        std::vector<std::pair<uint32_t, IdleLoop>> loaded(header.loop_count);
+
+        for (auto &[offset, loop] : loaded) {
+            read_value(file, offset);
+            read_value(file, loop.instructions);
+            read_value(file, loop.read_count);
+
+            for (auto &read : loop.reads) {
+                read_value(file, read.source);
+                read_value(file, read.address);
+            }
+
+            if (!loop.instructions || loop.read_count > MAX_IDLE_LOOP_READS) {
+                return false;
+            }
+        }
+
+        if (!file) {
+            return false;
+        }
+
+        loops.insert(loaded.begin(), loaded.end());
+
+        return true;
+    }
+
+    bool IdleLoopCache::save(const std::filesystem::path &path, uint16_t rom_checksum) const {
+        std::ofstream file(path, std::ios::binary);
+
+        if (!file) {
+            return false;
+        }
+
+        IdleLoopCacheHeader header{
+            .rom_checksum = rom_checksum,
+            .loop_count = static_cast<uint32_t>(loop_count()),
+        };
+
+        write_value(file, header);
+
+        for (const auto &[offset, loop] : loops) {
+            if (!loop.instructions) {
+                continue;
+            }
+
+            write_value(file, offset);
+            write_value(file, loop.instructions);
+            write_value(file, loop.read_count);
+
+            for (const auto &read : loop.reads) {
+                write_value(file, read.source);
+                write_value(file, read.address);
+            }
+        }
+
+        return static_cast<bool>(file);
+    }
+
+    IdleLoop IdleLoopCache::analyze(Cartridge &cart, uint16_t address) {
+        // The loop can't cross into the next 16 KiB region, which may map a different bank.
+        uint32_t region_end = (address & 0xC000) + 0x4000;
+        uint16_t start = address;
+        uint8_t written = 0;
+        IdleLoop loop{};
+
+        const auto add_read = [&loop](IdleLoopSource source, uint16_t read_address = 0) {
+            if (loop.read_count == MAX_IDLE_LOOP_READS) {
+                return false;
+            }
+
+            loop.reads[loop.read_count++] = {source, read_address};
+            return true;
+        };
+
+        for (uint8_t count = 1; count <= MAX_IDLE_LOOP_INSTRUCTIONS; ++count) {
+            if (static_cast<uint32_t>(address) + 3 > region_end) {
+                return {};
+            }
+
+            uint8_t opcode = cart.read(address);
+            uint8_t operand = cart.read(address + 1);
+            uint16_t operand16 = operand | (cart.read(address + 2) << 8);
+            uint8_t length = 1;
+            int32_t target = -1;
+
+            if (opcode >= 0x40 && opcode < 0x80) {
+                // LD r, r', stores to (HL) and HALT end the search.
+                uint8_t destination = (opcode >> 3) & 0x7;
+
+                if (destination == 0x6 || ((opcode & 0x7) == 0x6 && !add_read(IdleLoopSource::HL))) {
+                    return {};
+                }
+
+                written |= 1 << destination;
+            } else if (opcode >= 0x80 && opcode < 0xC0) {
+                // ALU A, r, CP only sets the flags.
+                if ((opcode & 0x7) == 0x6 && !add_read(IdleLoopSource::HL)) {
+                    return {};
+                }
+
+                if ((opcode & 0xF8) != 0xB8) {
+                    written |= REGISTER_A;
+                }
+            } else {
+                switch (opcode) {
+                case 0x00:   // NOP
+                case 0x37:   // SCF
+                case 0x3F: { // CCF
+                    break;
+                }
+                case 0x2F: { // CPL
+                    written |= REGISTER_A;
+                    break;
+                }
+                case 0x06:
+                case 0x0E:
+                case 0x16:
+                case 0x1E:
+                case 0x26:
+                case 0x2E:
+                case 0x3E: { // LD r, u8
+                    written |= 1 << ((opcode >> 3) & 0x7);
+                    length = 2;
+                    break;
+                }
+                case 0x01:
+                case 0x11:
+                case 0x21: { // LD rr, u16
+                    written |= 0x3 << ((opcode >> 4) * 2);
+                    length = 3;
+                    break;
+                }
+                case 0x0A:
+                case 0x1A: { // LD A, (BC), LD A, (DE)
+                    if (!add_read(opcode == 0x0A ? IdleLoopSource::BC : IdleLoopSource::DE)) {
+                        return {};
+                    }
+
+                    written |= REGISTER_A;
+                    break;
+                }
+                case 0xF0: { // LD A, (FF00 + u8)
+                    if (!add_read(IdleLoopSource::Address, 0xFF00 + operand)) {
+                        return {};
+                    }
+
+                    written |= REGISTER_A;
+                    length = 2;
+                    break;
+                }
+                case 0xF2: { // LD A, (FF00 + C)
+                    if (!add_read(IdleLoopSource::HighC)) {
+                        return {};
+                    }
+
+                    written |= REGISTER_A;
+                    break;
+                }
+                case 0xFA: { // LD A, (u16)
+                    if (!add_read(IdleLoopSource::Address, operand16)) {
+                        return {};
+                    }
+
+                    written |= REGISTER_A;
+                    length = 3;
+                    break;
+                }
+                case 0xC6:
+                case 0xCE:
+                case 0xD6:
+                case 0xDE:
+                case 0xE6:
+                case 0xEE:
+                case 0xF6: { // ALU A, u8
+                    written |= REGISTER_A;
+                    length = 2;
+                    break;
+                }
+                case 0xFE: { // CP u8
+                    length = 2;
+                    break;
+                }
+                case 0xCB: { // BIT b, r
+                    if (operand < 0x40 || operand >= 0x80 ||
+                        ((operand & 0x7) == 0x6 && !add_read(IdleLoopSource::HL))) {
+                        return {};
+                    }
+
+                    length = 2;
+                    break;
+                }
+                case 0x18:
+                case 0x20:
+                case 0x28:
+                case 0x30:
+                case 0x38: { // JR (cc), i8
+                    target = address + 2 + static_cast<int8_t>(operand);
+                    break;
+                }
+                case 0xC2:
+                case 0xC3:
+                case 0xCA:
+                case 0xD2:
+                case 0xDA: { // JP (cc), u16
+                    target = operand16;
+                    break;
+                }
+                default: {
+                    return {};
+                }
+                }
+            }
+
+            if (target >= 0) {
+                if (target != start) {
+                    return {};
+                }
+
+                loop.instructions = count;
+                break;
+            }
+
+            address += length;
+        }
+
+        if (!loop.instructions) {
+            return {};
+        }
+
+        // Addresses come from the registers at the start of the loop, so they have to stay put.
+        for (size_t i = 0; i < loop.read_count; ++i) {
+            uint8_t used = 0;
+
+            switch (loop.reads[i].source) {
+            case IdleLoopSource::Address: {
+                break;
+            }
+            case IdleLoopSource::BC: {
+                used = REGISTER_B | REGISTER_C;
+                break;
+            }
+            case IdleLoopSource::DE: {
+                used = REGISTER_D | REGISTER_E;
+                break;
+            }
+            case IdleLoopSource::HL: {
+                used = REGISTER_H | REGISTER_L;
+                break;
+            }
+            case IdleLoopSource::HighC: {
+                used = REGISTER_C;
+                break;
+            }
+            }
+
+            if (written & used) {
+                return {};
+            }
+        }
+
+        return loop;
+    }
+}
@@ -0,0 +1,82 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <filesystem>
+#include <unordered_map>
+
+namespace GB {
+    class Cartridge;
+
+    constexpr uint32_t IDLE_LOOP_CACHE_MAGIC = 0x49424342; // "BCBI"
+    constexpr uint32_t IDLE_LOOP_CACHE_VERSION = 1;
+    constexpr size_t MAX_IDLE_LOOP_READS = 4;
+
+    enum class IdleLoopSource : uint8_t {
+        Address,
+        BC,
+        DE,
+        HL,
+        HighC, // 0xFF00 + C
+    };
+
+    struct IdleLoopRead {
+        IdleLoopSource source = IdleLoopSource::Address;
+        uint16_t address = 0;
+    };
+
+    struct IdleLoop {
+        // Instructions in one iteration, 0 when the code isn't an idle loop.
+        uint8_t instructions = 0;
+        uint8_t read_count = 0;
+        std::array<IdleLoopRead, MAX_IDLE_LOOP_READS> reads{};
+    };
+
+    /*
+        An idle loop is a short run of straight line code in ROM that ends with a branch back to
+        its first instruction and doesn't write to memory, use the stack or touch IME, such as
+        waiting for LY or a flag in RAM. The registers used as addresses can't be changed inside
+        the loop, so the locations it reads are known from the registers at its start.
+
+        Only the shape of the code is checked here, SM83 decides at run time whether an iteration
+        changes anything and until when the locations it reads stay the same. Loops are keyed by
+        their ROM offset, the idle ones can be saved and loaded again the next time the same ROM
+        runs.
+    */
+    class IdleLoopCache {
+    public:
+        void clear();
+        size_t loop_count() const;
+
+        // Returns nullptr when the code at address isn't an idle loop.
+        const IdleLoop *find(Cartridge &cart, uint16_t address);
+
+        // Loading fails and leaves the cache untouched when the file belongs to another ROM.
+        bool load(const std::filesystem::path &path, uint16_t rom_checksum);
+        bool save(const std::filesystem::path &path, uint16_t rom_checksum) const;
+
+    private:
+        static IdleLoop analyze(Cartridge &cart, uint16_t address);
+
+        // Every analysed offset, including the ones that aren't idle loops.
+        std::unordered_map<uint32_t, IdleLoop> loops;
+    };
+}
@@ -0,0 +1,211 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Movie.hpp"
+#include "Core.hpp"
+#include <cstring>
+#include <fstream>
+
+namespace GB {
+    struct MovieHeader {
+        uint32_t magic = MOVIE_MAGIC;
+        uint32_t version = MOVIE_VERSION;
+        uint32_t frame_count = 0;
+        uint32_t state_size = 0;
+    };
+
+    template <typename T> static void write_value(std::ofstream &file, const T &value) {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T> static void read_value(std::ifstream &file, T &value) {
+        file.read(reinterpret_cast<char *>(&value), sizeof(T));
+    }
+
+    void Movie::start_recording(Core &core) {
+        core.save_state(start_state);
+        frames.clear();
+        position = 0;
+        desync.reset();
+        mode_ = MovieMode::Recording;
+    }
+
+    bool Movie::start_playback(Core &core) {
+        if (start_state.empty() || !core.load_state(start_state)) {
+            return false;
+        }
+
+        position = 0;
+        desync.reset();
+        mode_ = MovieMode::Playback;
+
+        return true;
+    }
+
+    void Movie::stop() { mode_ = MovieMode::Inactive; }
+
+    MovieMode Movie::mode() const { return mode_; }
+
+    size_t Movie::frame_count() const { return frames.size(); }
+
+    size_t Movie::current_frame() const { return position; }
+
+    bool Movie::finished() const {
+        return mode_ == MovieMode::Playback && position >= frames.size();
+    }
+
+    std::optional<size_t> Movie::desync_frame() const { return desync; }
+
+    void Movie::begin_frame(Core &core) {
+        if (mode_ == MovieMode::Inactive) {
+            return;
+        }
+
+        if (mode_ == MovieMode::Playback && position < frames.size()) {
+            core.pad.set_buttons(frames[position].buttons);
+        }
+
+        core.pad.clear_polls();
+    }
+
+    void Movie::end_frame(Core &core) {
+        switch (mode_) {
+        case MovieMode::Recording: {
+            frames.push_back(capture_frame(core));
+            position = frames.size();
+            break;
+        }
+        case MovieMode::Playback: {
+            if (position >= frames.size()) {
+                break;
+            }
+
+            if (!desync && capture_frame(core) != frames[position]) {
+                desync = position;
+            }
+
+            ++position;
+            break;
+        }
+        case MovieMode::Inactive: {
+            break;
+        }
+        }
+    }
+
+    bool Movie::save(const std::filesystem::path &path) const {
+        std::ofstream file(path, std::ios::binary);
+
+        if (!file) {
+            return false;
+        }
+
+        MovieHeader header{
+            .frame_count = static_cast<uint32_t>(frames.size()),
+            .state_size = static_cast<uint32_t>(start_state.size()),
+        };
+
+        write_value(file, header);
+        file.write(reinterpret_cast<const char *>(start_state.data()),
+                   static_cast<std::streamsize>(start_state.size()));
+
+        for (const auto &frame : frames) {
+            write_value(file, frame.buttons);
+            write_value(file, frame.poll_count);
+            write_value(file, frame.first_poll_timestamp);
+            write_value(file, frame.state_hash);
+        }
+
+        return static_cast<bool>(file);
+    }
+
+    bool Movie::load(const std::filesystem::path &path) {
+        std::ifstream file(path, std::ios::binary);
+
+        if (!file) {
+            return false;
+        }
+
+        MovieHeader header{};
+        read_value(file, header);
+
+        if (!file || header.magic != MOVIE_MAGIC || header.version != MOVIE_VERSION) {
+            return false;
+        }
+
+        std::vector<uint8_t> state(header.state_size);
+        file.read(reinterpret_cast<char *>(state.data()),
+                  static_cast<std::streamsize>(state.size()));
+
+        std::vector<MovieFrame> loaded_frames(header.frame_count);
+
+        for (auto &frame : loaded_frames) {
+            read_value(file, frame.buttons);
+            read_value(file, frame.poll_count);
+            read_value(file, frame.first_poll_timestamp);
+            read_value(file, frame.state_hash);
+        }
+
+        if (!file) {
+            return false;
+        }
+
+        stop();
+        start_state = std::move(state);
+        frames = std::move(loaded_frames);
+        position = 0;
+        desync.reset();
+
+        return true;
+    }
+
+    MovieFrame Movie::capture_frame(Core &core) {
+        core.save_state(scratch);
+
+        return MovieFrame{
+            .buttons = core.pad.buttons(),
+            .poll_count = core.pad.poll_count(),
+            .first_poll_timestamp = core.pad.first_poll_timestamp(),
+            .state_hash = hash_state(scratch),
+        };
+    }
+
+    uint64_t hash_state(std::span<const uint8_t> state) {
+        // FNV-1a over whole words, folded after every step so high bits reach the low ones.
+        constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325;
+        constexpr uint64_t FNV_PRIME = 0x100000001B3;
+
+        uint64_t hash = FNV_OFFSET;
+        size_t i = 0;
+
+        for (; i + sizeof(uint64_t) <= state.size(); i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, state.data() + i, sizeof(uint64_t));
+
+            hash = (hash ^ word) * FNV_PRIME;
+            hash ^= hash >> 29;
+        }
+
+        for (; i < state.size(); ++i) {
+            hash = (hash ^ state[i]) * FNV_PRIME;
+        }
+
+        return hash;
+    }
+}
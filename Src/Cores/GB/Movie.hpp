@@ -0,0 +1,86 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <cinttypes>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace GB {
+    class Core;
+
+    constexpr uint32_t MOVIE_MAGIC = 0x4D424342; // "BCBM"
+    constexpr uint32_t MOVIE_VERSION = 2;
+
+    struct MovieFrame {
+        uint8_t buttons = 0;
+        uint32_t poll_count = 0;
+        uint64_t first_poll_timestamp = 0;
+        uint64_t state_hash = 0;
+
+        bool operator==(const MovieFrame &) const = default;
+    };
+
+    enum class MovieMode { Inactive, Recording, Playback };
+
+    /*
+        A movie starts from a save state and holds the buttons for every frame after it, input
+        only ever changes between frames so that is enough to replay a session exactly. Each
+        frame also keeps when the game first read P1 and a hash of the whole machine state at
+        the end of the frame, a playback that diverges is caught on the first frame it happens.
+
+        begin_frame and end_frame have to be called around every run_for_frames(1).
+    */
+    class Movie {
+    public:
+        void start_recording(Core &core);
+        bool start_playback(Core &core);
+        void stop();
+
+        MovieMode mode() const;
+        size_t frame_count() const;
+        size_t current_frame() const;
+        bool finished() const;
+
+        // The first frame whose polls or state hash did not match the recording.
+        std::optional<size_t> desync_frame() const;
+
+        void begin_frame(Core &core);
+        void end_frame(Core &core);
+
+        bool save(const std::filesystem::path &path) const;
+        bool load(const std::filesystem::path &path);
+
+    private:
+        MovieFrame capture_frame(Core &core);
+
+        MovieMode mode_ = MovieMode::Inactive;
+        size_t position = 0;
+        uint8_t frame_buttons = 0;
+        std::optional<size_t> desync{};
+
+        std::vector<uint8_t> start_state{};
+        std::vector<MovieFrame> frames{};
+        std::vector<uint8_t> scratch{};
+    };
+
+    uint64_t hash_state(std::span<const uint8_t> state);
+}
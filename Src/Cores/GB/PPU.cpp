@@ -19,7 +19,9 @@
 #include "PPU.hpp"
 #include "Constants.hpp"
 #include "Core.hpp"
+#include "StateArchive.hpp"
 #include <algorithm>
+#include <limits>
 #include <span>
 #include <stdexcept>
 
@@ -260,16 +262,26 @@ namespace GB {
         return framebuffer_complete;
     }
 
+    void PPU::set_output_enabled(bool enabled) { output_enabled = enabled; }
+
+    uint64_t PPU::vblank_count() const { return vblank_counter; }
+
+    uint64_t PPU::frame_count() const { return frame_counter; }
+
     void PPU::reset() {
         fetcher.reset();
         bg_fifo.clear();
 
         window_draw_flag = false;
         previously_disabled = false;
+        first_frame = false;
         num_obj_on_scanline = 0;
         line_x = 0;
         cycles = 0;
         extra_cycles = 0;
+        sync_timestamp = 0;
+        hblank_timestamp = 0;
+        output_enabled = true;
 
         lcd_control = 0;
         status = 0;
@@ -336,14 +348,45 @@ namespace GB {
         }
     }
 
+    void PPU::sync() {
+        uint64_t now = core->scheduler.now();
+
+        if (now > sync_timestamp) {
+            step(static_cast<int32_t>(now - sync_timestamp));
+        }
+
+        schedule_next_event();
+    }
+
+    bool PPU::hblank_started_after(uint64_t timestamp) const {
+        return ((status & MODE_MASK) == HBLANK) && (hblank_timestamp > timestamp);
+    }
+
+    uint64_t PPU::next_mode_change() const {
+        int32_t dots = dots_until_transition();
+
+        if (!(lcd_control & LCD_ENABLED_BIT) || dots == std::numeric_limits<int32_t>::max()) {
+            return NEVER;
+        }
+
+        return sync_timestamp + dots;
+    }
+
     void PPU::step(int32_t accumulated_cycles) {
+        sync_timestamp += accumulated_cycles;
+
         if (!(lcd_control & LCD_ENABLED_BIT)) {
+            if ((status & MODE_MASK) != HBLANK) {
+                hblank_timestamp = sync_timestamp - accumulated_cycles + 1;
+            }
+
             set_mode(HBLANK);
             previously_disabled = true;
             return;
         }
 
         if (previously_disabled) {
+            first_frame = true;
             window_draw_flag = false;
             num_obj_on_scanline = 0;
             cycles = 0;
@@ -375,6 +418,15 @@ namespace GB {
                     line_x = 0;
 
                     if (line_y == 144) {
+                        // The first frame after the LCD is turned on is never shown.
+                        if (output_enabled && !first_frame) {
+                            framebuffer_complete = internal_framebuffer;
+                            ++frame_counter;
+                        }
+
+                        first_frame = false;
+
+                        ++vblank_counter;
                         set_mode(VBLANK);
 
                         core->cpu.request_interrupt(INT_VBLANK_BIT);
@@ -401,7 +453,6 @@ namespace GB {
                     cycles = 0;
 
                     if (line_y > 153) {
-                        framebuffer_complete = internal_framebuffer;
                         set_mode(OAM_SEARCH);
 
                         if ((status & OAM_STAT_INT_BIT) && allow_interrupt) {
@@ -420,7 +471,11 @@ namespace GB {
 
             case OAM_SEARCH: {
                 if (cycles == 80) {
-                    scan_oam();
+                    // Objects don't affect the length of pixel transfer, they are only needed
+                    // when drawing.
+                    if (output_enabled) {
+                        scan_oam();
+                    }
                     cycles = 0;
                     extra_cycles = 0;
 
@@ -439,6 +494,8 @@ namespace GB {
                     cycles = 0;
 
                     set_mode(HBLANK);
+                    hblank_timestamp = sync_timestamp - accumulated_cycles + 1;
+
                     if (fetcher.get_mode() == FetchMode::Window) {
                         window_line_y++;
                     }
@@ -448,29 +505,108 @@ namespace GB {
                     }
 
                     continue;
-                } else {
+                }
+
+                // Pixel transfer is stepped per dot because its length depends on what is being
+                // drawn. STAT and LY=LYC can't change until it ends, so they are only checked once.
+                while (accumulated_cycles && cycles < 172 + extra_cycles) {
                     render_scanline();
+                    --accumulated_cycles;
+                    ++cycles;
                 }
-                break;
+
+                check_ly_lyc(allow_interrupt);
+                continue;
             }
             }
 
-            accumulated_cycles--;
-            cycles++;
+            // Nothing else changes until the next transition, so those dots can be consumed at
+            // once.
+            int32_t dots = std::min(dots_until_transition(), accumulated_cycles);
+
+            accumulated_cycles -= dots;
+            cycles += dots;
 
             check_ly_lyc(allow_interrupt);
         }
     }
 
+    int32_t PPU::dots_until_transition() const {
+        int32_t dots = 0;
+
+        switch (status & MODE_MASK) {
+        case HBLANK: {
+            dots = (204 - extra_cycles) - cycles;
+            break;
+        }
+        case VBLANK: {
+            dots = 456 - cycles;
+            break;
+        }
+        case OAM_SEARCH: {
+            dots = 80 - cycles;
+            break;
+        }
+        case PIXEL_TRANSFER: {
+            dots = (172 + extra_cycles) - cycles;
+            break;
+        }
+        }
+
+        return dots >= 0 ? dots : std::numeric_limits<int32_t>::max();
+    }
+
+    void PPU::schedule_next_event() {
+        if (!(lcd_control & LCD_ENABLED_BIT)) {
+            core->scheduler.cancel(EventType::PPU);
+            return;
+        }
+
+        if (previously_disabled) {
+            core->scheduler.schedule(EventType::PPU, sync_timestamp + 1);
+            return;
+        }
+
+        // The event is due one dot after the mode transition so the interrupt it may raise is
+        // visible to the CPU at the same point as when stepping every M-cycle. Pixel transfer
+        // can be extended while rendering, so its end is rescheduled until it is reached.
+        int32_t dots = 0;
+
+        switch (status & MODE_MASK) {
+        case OAM_SEARCH: {
+            dots = (80 - cycles) + 172;
+            break;
+        }
+        case PIXEL_TRANSFER: {
+            dots = (172 + extra_cycles) - cycles;
+            break;
+        }
+        default: {
+            dots = dots_until_transition();
+            break;
+        }
+        }
+
+        if (dots == std::numeric_limits<int32_t>::max()) {
+            core->scheduler.cancel(EventType::PPU);
+            return;
+        }
+
+        core->scheduler.schedule(EventType::PPU, sync_timestamp + dots + 1);
+    }
+
     void PPU::write_register(uint8_t reg, uint8_t value) {
         switch (reg) {
         case 0x40: {
             lcd_control = value;
+            core->scheduler.schedule(EventType::PPU, sync_timestamp + 1);
             return;
         }
         case 0x41: {
+            // Clears the coincidence flag, which can raise a STAT interrupt on the next dot.
             status &= 0x3;
             status |= value & 0xF8;
+            core->scheduler.schedule(EventType::PPU, sync_timestamp + 1);
             return;
         }
         case 0x42: {
@@ -483,6 +619,7 @@ namespace GB {
         }
         case 0x45: {
             line_y_compare = value;
+            core->scheduler.schedule(EventType::PPU, sync_timestamp + 1);
             return;
         }
         case 0x46: {
@@ -680,30 +817,12 @@ namespace GB {
         fetcher.clock(*this);
 
         if ((line_x < 160) && bg_fifo.pixels_left()) {
-            uint8_t final_pixel = 0, final_palette = bg_fifo.pixel_attribute() & 0x7;
-            uint8_t final_dmg_palette = background_palette;
-            uint8_t bg_pixel = bg_fifo.clock();
-
-            bool bg_enabled =
-                core->bus.is_compatibility_mode() ? (lcd_control & BG_ENABLED_BIT) : true;
-
-            if (!bg_enabled) {
-                final_pixel = 0;
-                final_palette = 0;
-                final_dmg_palette = 0;
-            } else {
-                final_pixel = bg_pixel;
-            }
-
-            bg_color_table[(line_y * LCD_WIDTH) + line_x] =
-                final_pixel | (static_cast<uint16_t>(bg_fifo.pixel_attribute()) << 8);
-
-            if (core->bus.is_compatibility_mode()) {
-                uint8_t cgb_pixel = (final_dmg_palette >> (int)(2 * final_pixel)) & 3;
-
-                plot_cgb_pixel(line_x, cgb_pixel, 0, false);
+            // Without output only the FIFO has to advance, which keeps the fetcher and mode 3
+            // length the same as when drawing.
+            if (output_enabled) {
+                draw_bg_pixel();
             } else {
-                plot_cgb_pixel(line_x, final_pixel, final_palette, false);
+                bg_fifo.clock();
             }
 
             line_x++;
@@ -718,8 +837,35 @@ namespace GB {
         }
     }
 
+    void PPU::draw_bg_pixel() {
+        uint8_t final_pixel = 0, final_palette = bg_fifo.pixel_attribute() & 0x7;
+        uint8_t final_dmg_palette = background_palette;
+        uint8_t bg_pixel = bg_fifo.clock();
+
+        bool bg_enabled = core->bus.is_compatibility_mode() ? (lcd_control & BG_ENABLED_BIT) : true;
+
+        if (!bg_enabled) {
+            final_pixel = 0;
+            final_palette = 0;
+            final_dmg_palette = 0;
+        } else {
+            final_pixel = bg_pixel;
+        }
+
+        bg_color_table[(line_y * LCD_WIDTH) + line_x] =
+            final_pixel | (static_cast<uint16_t>(bg_fifo.pixel_attribute()) << 8);
+
+        if (core->bus.is_compatibility_mode()) {
+            uint8_t cgb_pixel = (final_dmg_palette >> (int)(2 * final_pixel)) & 3;
+
+            plot_cgb_pixel(line_x, cgb_pixel, 0, false);
+        } else {
+            plot_cgb_pixel(line_x, final_pixel, final_palette, false);
+        }
+    }
+
     void PPU::render_objects() {
-        if (!(lcd_control & OBJECTS_ENABLED_BIT)) {
+        if (!output_enabled || !(lcd_control & OBJECTS_ENABLED_BIT)) {
             return;
         }
 
@@ -881,4 +1027,14 @@ namespace GB {
             }
         }
     }
-}
\ No newline at end of file
+
+    void PPU::serialize(StateArchive &archive) {
+        archive(fetcher, bg_fifo, window_draw_flag, previously_disabled, first_frame,
+                num_obj_on_scanline, line_x, lcd_control, status, screen_scroll_y, screen_scroll_x,
+                line_y, line_y_compare, window_y, window_x, window_line_y, background_palette,
+                object_palette_0, object_palette_1, vram_bank_select, bg_palette_select,
+                obj_palette_select, object_priority_mode, cycles, extra_cycles, sync_timestamp,
+                hblank_timestamp, obj_cram, bg_cram, vram, oam, objects_on_scanline, bg_color_table,
+                internal_framebuffer, framebuffer_complete);
+    }
+}
@@ -25,6 +25,7 @@
 namespace GB {
     class Core;
     class PPU;
+    class StateArchive;
 
     constexpr uint8_t HBLANK = 0x0;
     constexpr uint8_t VBLANK = 0x1;
@@ -130,7 +131,26 @@ namespace GB {
         void set_compatibility_palette(PaletteID palette_type,
                                        const std::span<const uint16_t> colors);
 
-        void step(int32_t accumulated_cycles);
+        void sync();
+        bool hblank_started_after(uint64_t timestamp) const;
+
+        // Last dot before the mode in STAT changes, which has no event between OAM search and
+        // pixel transfer. NEVER while the LCD is off.
+        uint64_t next_mode_change() const;
+
+        /*
+            Pixels are only plotted while output is enabled, timing and every register are still
+            emulated so speculative frames that are never shown can skip the work.
+        */
+        void set_output_enabled(bool enabled);
+
+        /*
+            Every entry into VBlank is counted, frames are only counted when they are published to
+            framebuffer(), which needs output enabled and doesn't happen right after the LCD is
+            turned on.
+        */
+        uint64_t vblank_count() const;
+        uint64_t frame_count() const;
 
         void write_register(uint8_t reg, uint8_t value);
         uint8_t read_register(uint8_t reg) const;
@@ -140,6 +160,8 @@ namespace GB {
         void write_oam(uint16_t address, uint8_t value);
         uint8_t read_oam(uint16_t address) const;
 
+        void serialize(StateArchive &archive);
+
     private:
         void write_bg_palette(uint8_t value);
         uint8_t read_bg_palette() const;
@@ -152,6 +174,7 @@ namespace GB {
         bool stat_any() const;
 
         void render_scanline();
+        void draw_bg_pixel();
         void render_objects();
         void plot_cgb_pixel(uint8_t x_pos, uint8_t final_pixel, uint8_t palette, bool is_obj);
 
@@ -159,11 +182,16 @@ namespace GB {
         void set_mode(uint8_t mode);
         void check_ly_lyc(bool allow_interrupts);
 
+        void step(int32_t accumulated_cycles);
+        int32_t dots_until_transition() const;
+        void schedule_next_event();
+
         BackgroundFetcher fetcher;
         BackgroundFIFO bg_fifo;
 
         bool window_draw_flag = false;
         bool previously_disabled = false;
+        bool first_frame = false;
 
         uint8_t num_obj_on_scanline = 0;
         uint8_t line_x = 0;
@@ -192,6 +220,9 @@ namespace GB {
         int32_t cycles = 0;
         int32_t extra_cycles = 0;
 
+        uint64_t sync_timestamp = 0;
+        uint64_t hblank_timestamp = 0;
+
         std::array<uint8_t, 64> obj_cram{};
         std::array<uint8_t, 64> bg_cram{};
 
@@ -204,6 +235,9 @@ namespace GB {
         std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT * 4> internal_framebuffer{};
         std::array<uint8_t, LCD_WIDTH * LCD_HEIGHT * 4> framebuffer_complete{};
 
+        bool output_enabled = true;
+        uint64_t vblank_counter = 0;
+        uint64_t frame_counter = 0;
         Core *core;
 
         friend class BackgroundFIFO;
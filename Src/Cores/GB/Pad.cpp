@@ -17,11 +17,17 @@
 */
 
 #include "Pad.hpp"
+#include "StateArchive.hpp"
+#include <array>
 
 namespace GB {
+    // Indexed by PadButton, the bit each button clears in its half of P1.
+    constexpr std::array<uint8_t, 8> BUTTON_BITS{0x2, 0x1, 0x4, 0x8, 0x1, 0x2, 0x4, 0x8};
+
     void Gamepad::reset() {
         dpad = action = 0xFF;
         mode = 0;
+        clear_polls();
     }
 
     void Gamepad::clear_buttons() { dpad = action = 0xFF; }
@@ -111,4 +117,45 @@ namespace GB {
             return dpad;
         }
     }
-}
\ No newline at end of file
+
+    void Gamepad::serialize(StateArchive &archive) { archive(dpad, action, mode); }
+
+    uint8_t Gamepad::buttons() const {
+        uint8_t buttons = 0;
+
+        for (int32_t i = 0; i < 8; ++i) {
+            auto button = static_cast<PadButton>(i);
+            bool is_dpad = button < PadButton::A;
+            uint8_t bits = is_dpad ? dpad : action;
+
+            if (!(bits & BUTTON_BITS[i])) {
+                buttons |= 1 << i;
+            }
+        }
+
+        return buttons;
+    }
+
+    void Gamepad::set_buttons(uint8_t buttons) {
+        for (int32_t i = 0; i < 8; ++i) {
+            set_pad_state(static_cast<PadButton>(i), buttons & (1 << i));
+        }
+    }
+
+    uint8_t Gamepad::read_p1(uint64_t timestamp) {
+        if (polls++ == 0) {
+            first_poll = timestamp;
+        }
+
+        return get_pad_state();
+    }
+
+    void Gamepad::clear_polls() {
+        polls = 0;
+        first_poll = 0;
+    }
+
+    uint32_t Gamepad::poll_count() const { return polls; }
+
+    uint64_t Gamepad::first_poll_timestamp() const { return first_poll; }
+}
@@ -20,6 +20,8 @@
 #include <cinttypes>
 
 namespace GB {
+    class StateArchive;
+
     enum class PadButton { Left, Right, Up, Down, A, B, Select, Start };
 
     class Gamepad {
@@ -29,8 +31,25 @@ namespace GB {
         void set_pad_state(PadButton btn, bool pressed);
         void select_button_mode(uint8_t value);
         uint8_t get_pad_state();
+        void serialize(StateArchive &archive);
+
+        // Bit n is set while PadButton n is held.
+        uint8_t buttons() const;
+        void set_buttons(uint8_t buttons);
+
+        /*
+            Reads of P1 by the game are counted along with the timestamp of the first one, so
+            recorded input can be checked against when the game actually looked at it.
+        */
+        uint8_t read_p1(uint64_t timestamp);
+        void clear_polls();
+        uint32_t poll_count() const;
+        uint64_t first_poll_timestamp() const;
 
     private:
         uint8_t dpad = 0xFF, action = 0xFF, mode = 0;
+
+        uint32_t polls = 0;
+        uint64_t first_poll = 0;
     };
 }
\ No newline at end of file
@@ -0,0 +1,320 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Profiler.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+namespace GB {
+    constexpr uint32_t ROOT_LOCATION = 0x0100;
+
+    static std::pair<uint16_t, uint16_t> bank_and_address(uint32_t location) {
+        if (location & PROFILE_RAM_LOCATION) {
+            return {0, static_cast<uint16_t>(location)};
+        }
+
+        uint16_t bank = static_cast<uint16_t>(location >> 14);
+        uint16_t address = static_cast<uint16_t>(location & 0x3FFF);
+
+        return {bank, bank ? (0x4000 | address) : address};
+    }
+
+    // Symbols only name code in the same 16 KiB of ROM or 4 KiB of RAM.
+    static uint16_t symbol_region(uint16_t address) {
+        return address < 0x8000 ? (address & 0xC000) : (address & 0xF000);
+    }
+
+    static std::string hex_location(uint16_t bank, uint16_t address) {
+        char text[16];
+        std::snprintf(text, sizeof(text), "%02X:%04X", bank, address);
+
+        return text;
+    }
+
+    bool SymbolTable::load(const std::filesystem::path &path) {
+        std::ifstream file(path);
+
+        if (!file) {
+            return false;
+        }
+
+        symbols.clear();
+
+        for (std::string line; std::getline(file, line);) {
+            auto colon = line.find(':');
+            auto space = line.find(' ', colon);
+
+            if (line.empty() || line[0] == ';' || colon == std::string::npos ||
+                space == std::string::npos) {
+                continue;
+            }
+
+            uint16_t bank = 0, address = 0;
+            auto bank_end = line.data() + colon;
+            auto address_end = line.data() + space;
+
+            if (std::from_chars(line.data(), bank_end, bank, 16).ptr != bank_end ||
+                std::from_chars(bank_end + 1, address_end, address, 16).ptr != address_end) {
+                continue;
+            }
+
+            auto name = line.substr(space + 1);
+            name.erase(name.find_last_not_of(" \t\r") + 1);
+
+            if (!name.empty()) {
+                symbols[(static_cast<uint32_t>(bank) << 16) | address] = std::move(name);
+            }
+        }
+
+        return true;
+    }
+
+    bool SymbolTable::empty() const { return symbols.empty(); }
+
+    std::string SymbolTable::name(uint16_t bank, uint16_t address) const {
+        auto symbol = symbols.upper_bound((static_cast<uint32_t>(bank) << 16) | address);
+
+        if (symbol != symbols.begin()) {
+            --symbol;
+
+            uint16_t symbol_bank = static_cast<uint16_t>(symbol->first >> 16);
+            uint16_t symbol_address = static_cast<uint16_t>(symbol->first);
+
+            if (symbol_bank == bank && symbol_region(symbol_address) == symbol_region(address)) {
+                if (symbol_address == address) {
+                    return symbol->second;
+                }
+
+                char offset[8];
+                std::snprintf(offset, sizeof(offset), "+%X", address - symbol_address);
+
+                return symbol->second + offset;
+            }
+        }
+
+        return hex_location(bank, address);
+    }
+
+    Profiler::Profiler() { clear(); }
+
+    void Profiler::clear() {
+        rom_counters.clear();
+        ram_counters.assign(0x10000, {});
+
+        nodes.clear();
+        nodes.emplace_back(ROOT_LOCATION, 0);
+        frames.clear();
+        current_node = 0;
+
+        instruction_counter = nullptr;
+        instruction_node = 0;
+        instruction_timestamp = 0;
+    }
+
+    bool Profiler::load_symbols(const std::filesystem::path &path) { return symbols.load(path); }
+
+    void Profiler::begin_instruction(uint32_t location, uint64_t timestamp) {
+        instruction_counter = &counter_at(location);
+        instruction_node = current_node;
+        instruction_timestamp = timestamp;
+    }
+
+    void Profiler::end_instruction(uint64_t timestamp, bool executed) {
+        uint64_t cycles = timestamp - instruction_timestamp;
+
+        instruction_counter->instructions += executed ? 1 : 0;
+        instruction_counter->cycles += cycles;
+        nodes[instruction_node].cycles += cycles;
+    }
+
+    void Profiler::call(uint32_t location, uint16_t sp) {
+        // Frames at or above the new return address were left without RET.
+        unwind(sp + 1);
+
+        uint32_t child = static_cast<uint32_t>(nodes.size());
+        auto [entry, inserted] = nodes[current_node].children.try_emplace(location, child);
+
+        if (inserted) {
+            nodes.emplace_back(location, current_node);
+        } else {
+            child = entry->second;
+        }
+
+        frames.push_back({child, sp});
+        current_node = child;
+    }
+
+    void Profiler::ret(uint16_t sp) { unwind(sp); }
+
+    void Profiler::unwind(uint32_t sp) {
+        while (!frames.empty() && frames.back().sp < sp) {
+            frames.pop_back();
+        }
+
+        current_node = frames.empty() ? 0 : frames.back().node;
+    }
+
+    ProfileCounter Profiler::total() const {
+        ProfileCounter total{};
+
+        for (const auto *counters : {&rom_counters, &ram_counters}) {
+            for (const auto &counter : *counters) {
+                total.instructions += counter.instructions;
+                total.cycles += counter.cycles;
+            }
+        }
+
+        return total;
+    }
+
+    ProfileCounter Profiler::counter(uint32_t location) const {
+        if (location & PROFILE_RAM_LOCATION) {
+            return ram_counters[location & 0xFFFF];
+        }
+
+        return location < rom_counters.size() ? rom_counters[location] : ProfileCounter{};
+    }
+
+    bool Profiler::write_report(const std::filesystem::path &path) const {
+        std::ofstream file(path);
+
+        if (!file) {
+            return false;
+        }
+
+        auto sum = total();
+        double percent_scale = sum.cycles ? 100.0 / static_cast<double>(sum.cycles) : 0.0;
+
+        std::vector<std::pair<uint32_t, ProfileCounter>> locations;
+        std::map<int32_t, ProfileCounter> banks;
+
+        for (uint32_t i = 0; i < rom_counters.size(); ++i) {
+            if (rom_counters[i].cycles) {
+                locations.emplace_back(i, rom_counters[i]);
+
+                auto &bank = banks[static_cast<int32_t>(i >> 14)];
+                bank.instructions += rom_counters[i].instructions;
+                bank.cycles += rom_counters[i].cycles;
+            }
+        }
+
+        for (uint32_t i = 0; i < ram_counters.size(); ++i) {
+            if (ram_counters[i].cycles) {
+                locations.emplace_back(PROFILE_RAM_LOCATION | i, ram_counters[i]);
+
+                auto &ram = banks[-1];
+                ram.instructions += ram_counters[i].instructions;
+                ram.cycles += ram_counters[i].cycles;
+            }
+        }
+
+        std::stable_sort(locations.begin(), locations.end(), [](const auto &a, const auto &b) {
+            return a.second.cycles > b.second.cycles;
+        });
+
+        char line[256];
+
+        std::snprintf(line, sizeof(line), "Instructions: %llu\nCycles:       %llu\n\n",
+                      static_cast<unsigned long long>(sum.instructions),
+                      static_cast<unsigned long long>(sum.cycles));
+        file << line;
+
+        std::snprintf(line, sizeof(line), "%-10s %14s %8s %14s\n", "Bank", "Cycles", "%",
+                      "Instructions");
+        file << line;
+
+        for (const auto &[bank, counter] : banks) {
+            char name[16];
+
+            if (bank < 0) {
+                std::snprintf(name, sizeof(name), "RAM");
+            } else {
+                std::snprintf(name, sizeof(name), "ROM %02X", bank);
+            }
+
+            std::snprintf(line, sizeof(line), "%-10s %14llu %7.2f%% %14llu\n", name,
+                          static_cast<unsigned long long>(counter.cycles),
+                          static_cast<double>(counter.cycles) * percent_scale,
+                          static_cast<unsigned long long>(counter.instructions));
+            file << line;
+        }
+
+        std::snprintf(line, sizeof(line), "\n%-10s %14s %8s %14s  %s\n", "Location", "Cycles", "%",
+                      "Instructions", "Symbol");
+        file << line;
+
+        for (const auto &[location, counter] : locations) {
+            auto [bank, address] = bank_and_address(location);
+
+            std::snprintf(line, sizeof(line), "%-10s %14llu %7.2f%% %14llu  ",
+                          hex_location(bank, address).c_str(),
+                          static_cast<unsigned long long>(counter.cycles),
+                          static_cast<double>(counter.cycles) * percent_scale,
+                          static_cast<unsigned long long>(counter.instructions));
+            file << line << symbols.name(bank, address) << '\n';
+        }
+
+        return static_cast<bool>(file);
+    }
+
+    bool Profiler::write_collapsed_stacks(const std::filesystem::path &path) const {
+        std::ofstream file(path);
+
+        if (!file) {
+            return false;
+        }
+
+        // Parents are always created before their children, so their paths are already known.
+        std::vector<std::string> stacks(nodes.size());
+
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const auto &node = nodes[i];
+
+            stacks[i] = i ? stacks[node.parent] + ';' + location_name(node.location)
+                          : location_name(node.location);
+
+            if (node.cycles) {
+                file << stacks[i] << ' ' << node.cycles << '\n';
+            }
+        }
+
+        return static_cast<bool>(file);
+    }
+
+    ProfileCounter &Profiler::counter_at(uint32_t location) {
+        if (location & PROFILE_RAM_LOCATION) {
+            return ram_counters[location & 0xFFFF];
+        }
+
+        if (location >= rom_counters.size()) {
+            rom_counters.resize((location | 0x3FFF) + 1);
+        }
+
+        return rom_counters[location];
+    }
+
+    std::string Profiler::location_name(uint32_t location) const {
+        auto [bank, address] = bank_and_address(location);
+
+        return symbols.name(bank, address);
+    }
+}
@@ -0,0 +1,117 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <cinttypes>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GB {
+    // Set on locations outside of the ROM, the low 16 bits are the CPU address.
+    constexpr uint32_t PROFILE_RAM_LOCATION = 0x80000000;
+
+    struct ProfileCounter {
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+    };
+
+    /*
+        Names code by the nearest symbol at or before it from an RGBDS .sym file, which has one
+        "bank:address name" per line. ROM0 and RAM symbols are in bank 0.
+    */
+    class SymbolTable {
+    public:
+        bool load(const std::filesystem::path &path);
+        bool empty() const;
+
+        // Returns "name", "name+offset" or "bank:address" when there is no symbol before it.
+        std::string name(uint16_t bank, uint16_t address) const;
+
+    private:
+        std::map<uint32_t, std::string> symbols;
+    };
+
+    /*
+        Counts the instructions and cycles (dots) spent at each location, where a location is the
+        offset in the ROM image for code in ROM, or the CPU address for anything else. Everything
+        between the start of an instruction and the next one is charged to it, which includes
+        interrupt dispatch for the first instruction of a handler and the time spent halted for
+        HALT.
+
+        Calls, RST and interrupts push a frame on a call tree and RET pops it again, frames are
+        matched by SP so code that drops its return address doesn't leave stale frames behind.
+        The tree is written out as collapsed stacks, one "caller;callee cycles" line per path,
+        which flame graph tools read directly.
+    */
+    class Profiler {
+    public:
+        Profiler();
+
+        void clear();
+        bool load_symbols(const std::filesystem::path &path);
+
+        // The call stack is captured at the start, so CALL and RET are charged to the caller.
+        void begin_instruction(uint32_t location, uint64_t timestamp);
+        void end_instruction(uint64_t timestamp, bool executed);
+
+        void call(uint32_t location, uint16_t sp);
+        void ret(uint16_t sp);
+
+        ProfileCounter total() const;
+        ProfileCounter counter(uint32_t location) const;
+
+        bool write_report(const std::filesystem::path &path) const;
+        bool write_collapsed_stacks(const std::filesystem::path &path) const;
+
+    private:
+        struct CallNode {
+            CallNode(uint32_t location, uint32_t parent) : location(location), parent(parent) {}
+
+            uint32_t location = 0;
+            uint32_t parent = 0;
+            uint64_t cycles = 0;
+            std::unordered_map<uint32_t, uint32_t> children;
+        };
+
+        struct CallFrame {
+            uint32_t node = 0;
+            uint16_t sp = 0;
+        };
+
+        void unwind(uint32_t sp);
+        ProfileCounter &counter_at(uint32_t location);
+        std::string location_name(uint32_t location) const;
+
+        std::vector<ProfileCounter> rom_counters;
+        std::vector<ProfileCounter> ram_counters;
+
+        std::vector<CallNode> nodes;
+        std::vector<CallFrame> frames;
+        uint32_t current_node = 0;
+
+        ProfileCounter *instruction_counter = nullptr;
+        uint32_t instruction_node = 0;
+        uint64_t instruction_timestamp = 0;
+
+        SymbolTable symbols;
+    };
+}
@@ -0,0 +1,573 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Recompiler.hpp"
+#include "Cartridge.hpp"
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define BCB_RECOMPILER_X64 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace GB {
+    constexpr size_t CODE_CACHE_SIZE = 4 * 1024 * 1024;
+    constexpr uint32_t HOT_BLOCK_EXECUTIONS = 8;
+
+    Recompiler::Recompiler(const RecompilerBindings &bindings) : bindings(bindings) {
+#ifdef BCB_RECOMPILER_X64
+        void *memory = mmap(nullptr, CODE_CACHE_SIZE, PROT_READ | PROT_EXEC,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (memory != MAP_FAILED) {
+            code_buffer = static_cast<uint8_t *>(memory);
+        }
+#endif
+    }
+
+    Recompiler::~Recompiler() {
+#ifdef BCB_RECOMPILER_X64
+        if (code_buffer) {
+            munmap(code_buffer, CODE_CACHE_SIZE);
+        }
+#endif
+    }
+
+    bool Recompiler::supported() {
+#ifdef BCB_RECOMPILER_X64
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void Recompiler::clear() {
+        blocks.clear();
+        code_used = 0;
+        compiled_blocks = 0;
+    }
+
+    size_t Recompiler::code_size() const { return code_used; }
+
+    size_t Recompiler::compiled_block_count() const { return compiled_blocks; }
+
+    CodeBlock *Recompiler::find(Cartridge &cart, uint16_t address) {
+        if (!code_buffer) {
+            return nullptr;
+        }
+
+        auto block = blocks.find_block(cart, address);
+
+        if (block && !block->code && ++block->executions >= HOT_BLOCK_EXECUTIONS) {
+            block->code = compile(*block);
+
+            // The buffer is full, the blocks are decoded again as they are reached.
+            if (!block->code) {
+                clear();
+                return nullptr;
+            }
+        }
+
+        return block;
+    }
+
+    void Recompiler::reset_mapping() { blocks.reset_cursor(); }
+
+#ifdef BCB_RECOMPILER_X64
+    // Register numbers in ModRM encoding, only the ones that can be used without a REX prefix.
+    enum X64Register : uint8_t {
+        EAX = 0,
+        ECX = 1,
+        EDX = 2,
+        ESI = 6,
+    };
+
+    // Condition codes for Jcc.
+    enum X64Condition : uint8_t {
+        JE = 0x84,
+        JNE = 0x85,
+        JAE = 0x83,
+    };
+
+    class CodeEmitter {
+    public:
+        explicit CodeEmitter(std::vector<uint8_t> &out) : out(out) { out.clear(); }
+
+        void bytes(std::initializer_list<uint8_t> values) { out.insert(out.end(), values); }
+
+        template <typename T> void value(T data) {
+            size_t position = out.size();
+            out.resize(position + sizeof(T));
+            std::memcpy(out.data() + position, &data, sizeof(T));
+        }
+
+        // opcode reg, [rbx + displacement]
+        void memory(std::initializer_list<uint8_t> opcode, uint8_t reg, int32_t displacement) {
+            bytes(opcode);
+            bytes({static_cast<uint8_t>(0x80 | (reg << 3) | 3)});
+            value(displacement);
+        }
+
+        // Emits a jump and returns where its offset has to be patched.
+        size_t jump(X64Condition condition) {
+            bytes({0x0F, condition});
+            value<int32_t>(0);
+            return out.size() - 4;
+        }
+
+        size_t jump() {
+            bytes({0xE9});
+            value<int32_t>(0);
+            return out.size() - 4;
+        }
+
+        void patch(size_t at, size_t target) {
+            int32_t offset = static_cast<int32_t>(target - (at + 4));
+            std::memcpy(out.data() + at, &offset, sizeof(offset));
+        }
+
+        size_t size() const { return out.size(); }
+
+    private:
+        std::vector<uint8_t> &out;
+    };
+
+    /*
+        rbx holds the CPU and r13 the dots per M-cycle for the whole block. Registers and flags are
+        read from and written back to the CPU on every instruction, so the calls into the CPU and
+        the scheduler always see the current state. STOP ends its block, so the CPU speed can't
+        change in the middle of one.
+    */
+    class BlockCompiler {
+    public:
+        BlockCompiler(const RecompilerBindings &bindings, std::vector<uint8_t> &out)
+            : bind(bindings), emit(out) {}
+
+        void compile(const CodeBlock &block) {
+            // push rbx; push r12; push r13; mov rbx, rdi
+            emit.bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x48, 0x89, 0xFB});
+
+            // r13d = double_speed ? 2 : 4
+            emit.memory({0x0F, 0xB6}, EAX, bind.double_speed);
+            emit.bytes({0x01, 0xC0, 0x41, 0xBD, 0x04, 0x00, 0x00, 0x00, 0x41, 0x29, 0xC5});
+
+            for (size_t i = 0; i < block.instructions.size(); ++i) {
+                const auto &op = block.instructions[i];
+                bool last = i + 1 == block.instructions.size();
+
+                // instruction_timestamp = timestamp; ++instructions_executed
+                emit.memory({0x48, 0x8B}, EAX, bind.timestamp);
+                emit.memory({0x48, 0x89}, EAX, bind.instruction_timestamp);
+                emit.memory({0x48, 0xFF}, 0, bind.instructions);
+
+                if (!instruction(op)) {
+                    call_handler(op);
+                } else if (last && !is_branch(op.opcode)) {
+                    set_pc(op.next_pc);
+                }
+
+                if (!last) {
+                    // Stop after an interrupt request, a write to anything but RAM or the deadline.
+                    emit.memory({0x80}, 7, bind.block_exit);
+                    emit.value<uint8_t>(0);
+                    exits.push_back({emit.jump(JNE), op.next_pc});
+                    emit.memory({0x48, 0x8B}, EAX, bind.timestamp);
+                    emit.memory({0x48, 0x3B}, EAX, bind.block_deadline);
+                    exits.push_back({emit.jump(JAE), op.next_pc});
+                }
+            }
+
+            size_t epilogue = emit.size();
+
+            // pop r13; pop r12; pop rbx; ret
+            emit.bytes({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});
+
+            for (auto [at, next_pc] : exits) {
+                emit.patch(at, emit.size());
+                set_pc(next_pc);
+                emit.patch(emit.jump(), epilogue);
+            }
+
+            for (auto [at, resume] : events) {
+                emit.patch(at, emit.size());
+                call(bind.run_events);
+                emit.patch(emit.jump(), resume);
+            }
+        }
+
+    private:
+        static bool is_branch(uint8_t opcode) {
+            return opcode == 0x18 || (opcode & 0xE7) == 0x20 || opcode == 0xC3 ||
+                   (opcode & 0xE7) == 0xC2;
+        }
+
+        int32_t reg(uint8_t offset) const { return bind.registers + offset; }
+
+        int32_t pair(uint8_t opcode) const {
+            switch (opcode >> 4) {
+            case 0:
+                return bind.bc;
+            case 1:
+                return bind.de;
+            case 2:
+                return bind.hl;
+            default:
+                return bind.sp;
+            }
+        }
+
+        // Returns false for instructions that are left to their micro-op handler.
+        bool instruction(const MicroOp &op) {
+            uint8_t y = (op.opcode >> 3) & 0x7;
+            uint8_t z = op.opcode & 0x7;
+
+            if (op.opcode >= 0x40 && op.opcode < 0x80 && op.opcode != 0x76) {
+                tick();
+
+                if (y == 6) {
+                    emit.memory({0x0F, 0xB6}, EDX, reg(op.source));
+                    write_hl();
+                } else if (z == 6) {
+                    read_hl();
+                    emit.memory({0x88}, EAX, reg(op.target));
+                } else {
+                    emit.memory({0x0F, 0xB6}, EAX, reg(op.source));
+                    emit.memory({0x88}, EAX, reg(op.target));
+                }
+                return true;
+            }
+
+            if (op.opcode >= 0x80 && op.opcode < 0xC0) {
+                tick();
+
+                if (z == 6) {
+                    read_hl();
+                    emit.bytes({0x0F, 0xB6, 0xC8}); // movzx ecx, al
+                } else {
+                    emit.memory({0x0F, 0xB6}, ECX, reg(op.source));
+                }
+
+                alu(y);
+                return true;
+            }
+
+            if (op.opcode >= 0xC0 && z == 6) {
+                tick();
+                tick();
+                emit.bytes({0xB9}); // mov ecx, imm32
+                emit.value<uint32_t>(op.operand & 0xFF);
+                alu(y);
+                return true;
+            }
+
+            if (op.opcode < 0x40 && (z == 4 || z == 5) && y != 6) {
+                tick();
+                inc_dec(op.target, z == 5);
+                return true;
+            }
+
+            if (op.opcode < 0x40 && z == 6) {
+                tick();
+                tick();
+
+                if (y == 6) {
+                    emit.bytes({0xBA}); // mov edx, imm32
+                    emit.value<uint32_t>(op.operand & 0xFF);
+                    write_hl();
+                } else {
+                    emit.memory({0xC6}, 0, reg(op.target));
+                    emit.value<uint8_t>(op.operand & 0xFF);
+                }
+                return true;
+            }
+
+            switch (op.opcode) {
+            case 0x00: {
+                tick();
+                return true;
+            }
+            case 0x01:
+            case 0x11:
+            case 0x21:
+            case 0x31: {
+                tick();
+                tick();
+                tick();
+                emit.memory({0x66, 0xC7}, 0, pair(op.opcode));
+                emit.value<uint16_t>(op.operand);
+                return true;
+            }
+            case 0x03:
+            case 0x13:
+            case 0x23:
+            case 0x33:
+            case 0x0B:
+            case 0x1B:
+            case 0x2B:
+            case 0x3B: {
+                // add/sub word [pair], 1
+                tick();
+                emit.memory({0x66, 0x83}, (op.opcode & 0x08) ? 5 : 0, pair(op.opcode));
+                emit.value<uint8_t>(1);
+                tick();
+                return true;
+            }
+            case 0x18: {
+                tick();
+                tick();
+                tick();
+                set_pc(op.operand);
+                return true;
+            }
+            case 0x20:
+            case 0x28:
+            case 0x30:
+            case 0x38: {
+                tick();
+                size_t not_taken = condition(op.opcode, false);
+                tick();
+                tick();
+                set_pc(op.operand);
+                size_t done = emit.jump();
+                emit.patch(not_taken, emit.size());
+                tick();
+                set_pc(op.next_pc);
+                emit.patch(done, emit.size());
+                return true;
+            }
+            case 0xC3: {
+                tick();
+                tick();
+                tick();
+                tick();
+                set_pc(op.operand);
+                return true;
+            }
+            case 0xC2:
+            case 0xCA:
+            case 0xD2:
+            case 0xDA: {
+                tick();
+                size_t not_taken = condition(op.opcode, false);
+                tick();
+                tick();
+                tick();
+                set_pc(op.operand);
+                size_t done = emit.jump();
+                emit.patch(not_taken, emit.size());
+                tick(2);
+                set_pc(op.next_pc);
+                emit.patch(done, emit.size());
+                return true;
+            }
+            default: {
+                return false;
+            }
+            }
+        }
+
+        // Jumps when the condition of a jr/jp cc opcode is taken, or when it isn't.
+        size_t condition(uint8_t opcode, bool taken) {
+            bool carry = opcode & 0x10;
+            bool flag_set = opcode & 0x08;
+
+            if (carry) {
+                // test byte [flag_result + 1], 1
+                emit.memory({0xF6}, 0, bind.flag_result + 1);
+                emit.value<uint8_t>(1);
+            } else {
+                // cmp byte [flag_result], 0
+                emit.memory({0x80}, 7, bind.flag_result);
+                emit.value<uint8_t>(0);
+            }
+
+            // ZF ends up set when Z is set or C is clear.
+            bool zf_when_taken = carry ? !flag_set : flag_set;
+            return emit.jump(zf_when_taken == taken ? JE : JNE);
+        }
+
+        // Advances the scheduler by a number of M-cycles and runs the events that are due, the
+        // call is out of line since most ticks have nothing to do.
+        void tick(int32_t cycles = 1) {
+            emit.memory({0x48, 0x8B}, EAX, bind.timestamp);
+
+            for (int32_t i = 0; i < cycles; ++i) {
+                emit.bytes({0x4C, 0x01, 0xE8}); // add rax, r13
+            }
+
+            emit.memory({0x48, 0x89}, EAX, bind.timestamp);
+            emit.memory({0x48, 0x3B}, EAX, bind.next_event);
+            size_t at = emit.jump(JAE);
+            events.push_back({at, emit.size()});
+        }
+
+        void set_pc(uint16_t value) {
+            emit.memory({0x66, 0xC7}, 0, bind.pc);
+            emit.value(value);
+        }
+
+        template <typename Function> void call(Function function) {
+            emit.bytes({0x48, 0x89, 0xDF, 0x48, 0xB8}); // mov rdi, rbx; mov rax, imm64
+            emit.value(reinterpret_cast<uint64_t>(function));
+            emit.bytes({0xFF, 0xD0}); // call rax
+        }
+
+        // pc is only kept up to date for the handlers, which expect it at their instruction.
+        void call_handler(const MicroOp &op) {
+            set_pc(op.next_pc - op.length);
+            emit.bytes({0x48, 0xBE}); // mov rsi, imm64
+            emit.value(reinterpret_cast<uint64_t>(&op));
+            call(op.handler);
+        }
+
+        // Leaves the value in eax.
+        void read_hl() {
+            emit.memory({0x0F, 0xB7}, ESI, bind.hl);
+            call(bind.read);
+            emit.bytes({0x0F, 0xB6, 0xC0}); // movzx eax, al
+        }
+
+        // Writes edx.
+        void write_hl() {
+            emit.memory({0x0F, 0xB7}, ESI, bind.hl);
+            call(bind.write);
+        }
+
+        // A op= ecx, with the flags stored the same way as SM83::alu.
+        void alu(uint8_t op) {
+            emit.memory({0x0F, 0xB6}, EAX, bind.a);
+
+            switch (op) {
+            case 0:
+            case 1:
+            case 2:
+            case 3:
+            case 7: {
+                bool subtract = op >= 2;
+
+                emit.bytes({0x89, 0xC2}); // mov edx, eax
+                emit.bytes({static_cast<uint8_t>(subtract ? 0x29 : 0x01), 0xCA});
+
+                if (op == 1 || op == 3) {
+                    // movzx esi, byte [flag_result + 1]; and esi, 1
+                    emit.memory({0x0F, 0xB6}, ESI, bind.flag_result + 1);
+                    emit.bytes({0x83, 0xE6, 0x01});
+                    emit.bytes({static_cast<uint8_t>(subtract ? 0x29 : 0x01), 0xF2});
+                }
+
+                // flag_half = left ^ right ^ result
+                emit.bytes({0x89, 0xC6, 0x31, 0xCE, 0x31, 0xD6});
+                emit.memory({0x66, 0x89}, ESI, bind.flag_half);
+
+                if (subtract) {
+                    emit.bytes({0x81, 0xE2}); // and edx, 0x1FF
+                    emit.value<uint32_t>(0x1FF);
+                }
+
+                emit.memory({0x66, 0x89}, EDX, bind.flag_result);
+                emit.memory({0xC6}, 0, bind.flag_n);
+                emit.value<uint8_t>(subtract);
+
+                if (op != 7) {
+                    emit.memory({0x88}, EDX, bind.a);
+                }
+                break;
+            }
+            default: {
+                // and/xor/or edx, ecx
+                static constexpr uint8_t opcodes[] = {0x21, 0x31, 0x09};
+
+                emit.bytes({0x89, 0xC2, opcodes[op - 4], 0xCA});
+                emit.memory({0x88}, EDX, bind.a);
+                emit.memory({0x66, 0x89}, EDX, bind.flag_result);
+                emit.memory({0x66, 0xC7}, 0, bind.flag_half);
+                emit.value<uint16_t>(op == 4 ? 0x10 : 0);
+                emit.memory({0xC6}, 0, bind.flag_n);
+                emit.value<uint8_t>(0);
+                break;
+            }
+            }
+        }
+
+        // INC/DEC r, C is left as it is.
+        void inc_dec(uint8_t target, bool decrement) {
+            emit.memory({0x0F, 0xB6}, EAX, reg(target));
+            // lea edx, [rax +/- 1]
+            emit.bytes({0x8D, 0x50, static_cast<uint8_t>(decrement ? 0xFF : 0x01)});
+            emit.memory({0x88}, EDX, reg(target));
+
+            // flag_half = value ^ 1 ^ result
+            emit.bytes({0x89, 0xC6, 0x83, 0xF6, 0x01, 0x31, 0xD6});
+            emit.memory({0x66, 0x89}, ESI, bind.flag_half);
+
+            // flag_result = (flag_result & 0x100) | (result & 0xFF)
+            emit.memory({0x0F, 0xB7}, ECX, bind.flag_result);
+            emit.bytes({0x81, 0xE1});
+            emit.value<uint32_t>(0x100);
+            emit.bytes({0x0F, 0xB6, 0xF2, 0x09, 0xF1}); // movzx esi, dl; or ecx, esi
+            emit.memory({0x66, 0x89}, ECX, bind.flag_result);
+
+            emit.memory({0xC6}, 0, bind.flag_n);
+            emit.value<uint8_t>(decrement);
+        }
+
+        const RecompilerBindings &bind;
+        CodeEmitter emit;
+
+        // Early exits with the pc to leave behind, and the out of line event calls with the
+        // position to resume at.
+        std::vector<std::pair<size_t, uint16_t>> exits;
+        std::vector<std::pair<size_t, size_t>> events;
+    };
+
+    const uint8_t *Recompiler::compile(const CodeBlock &block) {
+        static const size_t page_size = sysconf(_SC_PAGESIZE);
+
+        BlockCompiler compiler(bindings, scratch);
+        compiler.compile(block);
+
+        if (code_used + scratch.size() > CODE_CACHE_SIZE) {
+            return nullptr;
+        }
+
+        uint8_t *code = code_buffer + code_used;
+        uintptr_t page_start = reinterpret_cast<uintptr_t>(code) & ~(page_size - 1);
+        size_t protect_size = reinterpret_cast<uintptr_t>(code) + scratch.size() - page_start;
+        auto pages = reinterpret_cast<void *>(page_start);
+
+        if (mprotect(pages, protect_size, PROT_READ | PROT_WRITE) != 0) {
+            return nullptr;
+        }
+
+        std::memcpy(code, scratch.data(), scratch.size());
+        mprotect(pages, protect_size, PROT_READ | PROT_EXEC);
+
+        // Blocks start on a 16 byte boundary.
+        code_used += (scratch.size() + 15) & ~size_t{15};
+        ++compiled_blocks;
+
+        return code;
+    }
+#else
+    const uint8_t *Recompiler::compile(const CodeBlock &) { return nullptr; }
+#endif
+}
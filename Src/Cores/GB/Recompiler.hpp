@@ -0,0 +1,110 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include "BlockCache.hpp"
+#include <cinttypes>
+#include <vector>
+
+namespace GB {
+    class Cartridge;
+    class SM83;
+
+    using CompiledBlock = void (*)(SM83 *cpu);
+
+    /*
+        Where compiled code finds the state it works on, as byte offsets from the SM83 running it,
+        and the functions it calls for memory accesses and scheduled events. The scheduler is part
+        of the same Core, so its fields are reached the same way.
+    */
+    struct RecompilerBindings {
+        int32_t registers = 0;
+        int32_t a = 0;
+        int32_t bc = 0;
+        int32_t de = 0;
+        int32_t hl = 0;
+        int32_t sp = 0;
+        int32_t pc = 0;
+        int32_t flag_result = 0;
+        int32_t flag_half = 0;
+        int32_t flag_n = 0;
+        int32_t double_speed = 0;
+        int32_t instructions = 0;
+        int32_t instruction_timestamp = 0;
+        int32_t block_exit = 0;
+        int32_t block_deadline = 0;
+        int32_t timestamp = 0;
+        int32_t next_event = 0;
+
+        uint8_t (*read)(SM83 *cpu, uint16_t address) = nullptr;
+        void (*write)(SM83 *cpu, uint16_t address, uint8_t value) = nullptr;
+        void (*run_events)(SM83 *cpu) = nullptr;
+    };
+
+    /*
+        Translates hot blocks of ROM code into x86-64. Register loads, the ALU, INC/DEC, 16-bit
+        loads and increments, jumps and conditional branches are emitted as native code working on
+        the CPU state in place, with the lazy flags kept in the same form as the interpreter.
+        Accesses through HL and the other memory operands call back into the CPU, so every access
+        still goes through the bus. The remaining instructions call their micro-op handler.
+
+        Every M-cycle advances the scheduler inline and only calls out when an event is due, so
+        timing is identical to the interpreter. After each instruction the block exits when an
+        interrupt was requested, something but RAM was written or the deadline passed.
+
+        Blocks come from a BlockCache looked up by ROM offset, so bank switches only require the
+        CPU addresses to be mapped again. Blocks run as micro-ops until they have executed a few
+        times. Code is written into a fixed size buffer, everything is thrown away and recompiled
+        when it fills up.
+
+        Only available on x86-64 Linux, supported() is false everywhere else.
+    */
+    class Recompiler {
+    public:
+        explicit Recompiler(const RecompilerBindings &bindings);
+        Recompiler(const Recompiler &) = delete;
+        Recompiler(Recompiler &&) = delete;
+        Recompiler &operator=(const Recompiler &) = delete;
+        Recompiler &operator=(Recompiler &&) = delete;
+        ~Recompiler();
+
+        static bool supported();
+
+        void clear();
+        size_t code_size() const;
+        size_t compiled_block_count() const;
+
+        // Returns the block at address, with its native code once it is hot, nullptr when it
+        // can't be cached.
+        CodeBlock *find(Cartridge &cart, uint16_t address);
+
+        // Has to be called when the ROM mapping may have changed.
+        void reset_mapping();
+
+    private:
+        const uint8_t *compile(const CodeBlock &block);
+
+        RecompilerBindings bindings;
+        BlockCache blocks;
+        std::vector<uint8_t> scratch;
+        uint8_t *code_buffer = nullptr;
+        size_t code_used = 0;
+        size_t compiled_blocks = 0;
+    };
+}
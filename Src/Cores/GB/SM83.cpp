@@ -20,34 +20,320 @@
 #include "Bus.hpp"
 #include "Constants.hpp"
 #include "Core.hpp"
+#include "StateArchive.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <stdexcept>
+#include <utility>
 
-#define GET_REG(R) registers[static_cast<size_t>(R)]
+#define GET_REG(R) registers[register_offset(R)]
 
 namespace GB {
-    SM83::SM83(Core *core) : opcodes(gen_optable()), cb_opcodes(gen_cb_optable()), core(core) {
+    static constexpr size_t HIGH_BYTE = std::endian::native == std::endian::little ? 1 : 0;
+
+    static constexpr size_t pair_offset(RegisterPair rp) {
+        switch (rp) {
+        case RegisterPair::BC:
+            return 0;
+        case RegisterPair::DE:
+            return 2;
+        case RegisterPair::HL:
+            return 4;
+        default:
+            return 6;
+        }
+    }
+
+    static constexpr size_t register_offset(Register r) {
+        switch (r) {
+        case Register::B:
+            return pair_offset(RegisterPair::BC) + HIGH_BYTE;
+        case Register::C:
+            return pair_offset(RegisterPair::BC) + (1 - HIGH_BYTE);
+        case Register::D:
+            return pair_offset(RegisterPair::DE) + HIGH_BYTE;
+        case Register::E:
+            return pair_offset(RegisterPair::DE) + (1 - HIGH_BYTE);
+        case Register::H:
+            return pair_offset(RegisterPair::HL) + HIGH_BYTE;
+        case Register::L:
+            return pair_offset(RegisterPair::HL) + (1 - HIGH_BYTE);
+        case Register::A:
+            return pair_offset(RegisterPair::AF) + HIGH_BYTE;
+        default:
+            return pair_offset(RegisterPair::AF) + (1 - HIGH_BYTE);
+        }
+    }
+
+    SM83::SM83(Core *core) : core(core) {
         if (!core) {
             throw std::invalid_argument("Core cannot be null.");
         }
     }
 
-    bool SM83::stopped() const { return stopped_; }
+    bool SM83::stopped() const { return stopped_ || locked_; }
 
     bool SM83::double_speed() const { return double_speed_; }
 
+    uint16_t SM83::program_counter() const { return pc; }
+
+    uint64_t SM83::instruction_count() const { return instructions_executed; }
+
+    void SM83::set_cached_interpreter(bool enabled) {
+        cached_interpreter = enabled;
+        block_cache.reset_cursor();
+    }
+
+    bool SM83::set_recompiler(bool enabled) {
+        if (enabled && Recompiler::supported()) {
+            if (!compiler) {
+                compiler = std::make_unique<Recompiler>(recompiler_bindings());
+            }
+        } else {
+            compiler.reset();
+        }
+
+        return !enabled || compiler;
+    }
+
+    const Recompiler *SM83::recompiler() const { return compiler.get(); }
+
+    bool SM83::run_block(uint64_t deadline) {
+        // Interrupts, HALT and the EI delay are only handled by step().
+        if ((!compiler && !cached_interpreter) || profiler_ || halted_ || ei_delay_ ||
+            (interrupt_flag & interrupt_enable) || pc >= 0x8000 || core->bus.bootstrap_mapped() ||
+            core->dma.is_active()) {
+            return false;
+        }
+
+        auto cart = core->bus.cartridge();
+
+        if (!cart) {
+            return false;
+        }
+
+        block_deadline = deadline;
+        block_exit = false;
+
+        // Blocks the recompiler hasn't compiled yet run as micro-ops.
+        auto block = compiler ? compiler->find(*cart, pc) : block_cache.find_block(*cart, pc);
+
+        if (!block) {
+            return false;
+        }
+
+        if (block->code) {
+            reinterpret_cast<CompiledBlock>(const_cast<uint8_t *>(block->code))(this);
+        } else {
+            run_micro_ops(*block);
+        }
+
+        core->dma.set_instruction_boundary(instruction_timestamp);
+
+        return true;
+    }
+
+    RecompilerBindings SM83::recompiler_bindings() {
+        auto offset = [this](const void *field) {
+            return static_cast<int32_t>(static_cast<const uint8_t *>(field) -
+                                        reinterpret_cast<const uint8_t *>(this));
+        };
+
+        RecompilerBindings bindings;
+        bindings.registers = offset(registers.data());
+        bindings.a = offset(&GET_REG(Register::A));
+        bindings.bc = offset(&registers[pair_offset(RegisterPair::BC)]);
+        bindings.de = offset(&registers[pair_offset(RegisterPair::DE)]);
+        bindings.hl = offset(&registers[pair_offset(RegisterPair::HL)]);
+        bindings.sp = offset(&sp);
+        bindings.pc = offset(&pc);
+        bindings.flag_result = offset(&flag_result);
+        bindings.flag_half = offset(&flag_half);
+        bindings.flag_n = offset(&flag_n);
+        bindings.double_speed = offset(&double_speed_);
+        bindings.instructions = offset(&instructions_executed);
+        bindings.instruction_timestamp = offset(&instruction_timestamp);
+        bindings.block_exit = offset(&block_exit);
+        bindings.block_deadline = offset(&block_deadline);
+        bindings.timestamp = offset(&core->scheduler.timestamp);
+        bindings.next_event = offset(&core->scheduler.earliest);
+        bindings.read = &SM83::compiled_read;
+        bindings.write = &SM83::compiled_write;
+        bindings.run_events = &SM83::compiled_events;
+
+        return bindings;
+    }
+
+    uint8_t SM83::compiled_read(SM83 *cpu, uint16_t address) { return cpu->read(address); }
+
+    void SM83::compiled_write(SM83 *cpu, uint16_t address, uint8_t value) {
+        cpu->write(address, value);
+    }
+
+    void SM83::compiled_events(SM83 *cpu) { cpu->core->tick_subcomponents(0); }
+
+    void SM83::run_micro_ops(const CodeBlock &block) {
+        for (const auto &op : block.instructions) {
+            instruction_timestamp = core->scheduler.now();
+
+            ++instructions_executed;
+            op.handler(*this, op);
+
+            if (block_exit || core->scheduler.now() >= block_deadline) {
+                return;
+            }
+        }
+    }
+
+    void SM83::set_idle_loop_skipping(bool enabled) {
+        idle_loop_skipping = enabled;
+        idle_loop_head = 0xFFFF;
+        idle_probe.valid = false;
+    }
+
+    IdleLoopCache &SM83::idle_loop_cache() { return idle_loops; }
+
+    uint64_t SM83::idle_cycles_skipped() const { return idle_cycles; }
+
+    void SM83::skip_idle_iterations(uint64_t deadline) {
+        auto cart = core->bus.cartridge();
+
+        if (!cart || halted_ || ei_delay_ || stopped_ || locked_ || pc >= 0x8000 ||
+            (master_interrupt_enable_ && (interrupt_flag & interrupt_enable & 0x1F)) ||
+            core->bus.bootstrap_mapped() || core->dma.is_active()) {
+            idle_probe.valid = false;
+            return;
+        }
+
+        if (pc != idle_loop_head) {
+            idle_loop_head = pc;
+            idle_loop = idle_loops.find(*cart, pc);
+            idle_probe.valid = false;
+        }
+
+        if (!idle_loop) {
+            return;
+        }
+
+        auto &scheduler = core->scheduler;
+        uint64_t now = scheduler.now();
+
+        auto current_registers = registers;
+        current_registers[register_offset(Register::F)] = pack_flags();
+
+        // The loop ran exactly once since the probe without changing anything, so every
+        // following iteration takes as long and reads the same values until stable_until.
+        if (idle_probe.valid && now <= idle_probe.stable_until &&
+            instructions_executed - idle_probe.instructions == idle_loop->instructions &&
+            scheduler.next_deadline() == idle_probe.deadline &&
+            current_registers == idle_probe.registers) {
+            uint64_t period = now - idle_probe.timestamp;
+            // The run goes on to the instruction at the end, so it has to stay before deadline.
+            uint64_t limit = std::min(idle_probe.stable_until, deadline - 1);
+            uint64_t iterations = (limit - now) / period;
+
+            scheduler.advance(iterations * period);
+            instructions_executed += iterations * idle_loop->instructions;
+            idle_cycles += iterations * period;
+
+            core->dma.set_instruction_boundary(scheduler.now());
+            idle_probe.valid = false;
+            return;
+        }
+
+        idle_probe.timestamp = now;
+        idle_probe.stable_until = idle_loop_stable_until(*idle_loop);
+        idle_probe.deadline = scheduler.next_deadline();
+        idle_probe.instructions = instructions_executed;
+        idle_probe.registers = current_registers;
+        idle_probe.valid = idle_probe.stable_until > now;
+    }
+
+    uint64_t SM83::idle_loop_stable_until(const IdleLoop &loop) const {
+        // Reads see the events due up to and including their own dot.
+        uint64_t until = core->scheduler.next_deadline() - 1;
+
+        for (size_t i = 0; i < loop.read_count; ++i) {
+            uint16_t address = loop.reads[i].address;
+
+            switch (loop.reads[i].source) {
+            case IdleLoopSource::Address: {
+                break;
+            }
+            case IdleLoopSource::BC: {
+                address = get_rp<RegisterPair::BC>();
+                break;
+            }
+            case IdleLoopSource::DE: {
+                address = get_rp<RegisterPair::DE>();
+                break;
+            }
+            case IdleLoopSource::HL: {
+                address = get_rp<RegisterPair::HL>();
+                break;
+            }
+            case IdleLoopSource::HighC: {
+                address = 0xFF00 + GET_REG(Register::C);
+                break;
+            }
+            }
+
+            // The joypad, serial port, timer and APU change on their own or when read.
+            if (address == 0xFF00 || (address > 0xFF00 && address < 0xFF08) ||
+                (address >= 0xFF10 && address < 0xFF40)) {
+                return 0;
+            }
+
+            if (address == 0xFF41) {
+                until = std::min(until, core->ppu.next_mode_change());
+            }
+        }
+
+        return until;
+    }
+
+    void SM83::set_profiling(bool enabled) {
+        if (!enabled) {
+            profiler_.reset();
+        } else if (!profiler_) {
+            profiler_ = std::make_unique<Profiler>();
+        }
+    }
+
+    Profiler *SM83::profiler() { return profiler_.get(); }
+
+    uint32_t SM83::profile_location(uint16_t address) const {
+        auto cart = core->bus.cartridge();
+
+        if (address < 0x8000 && cart && !core->bus.bootstrap_mapped()) {
+            return cart->rom_offset(address);
+        }
+
+        return PROFILE_RAM_LOCATION | address;
+    }
+
     void SM83::reset(uint16_t new_pc) {
+        block_cache.clear();
+        idle_loops.clear();
+        idle_loop_head = 0xFFFF;
+        idle_probe.valid = false;
+
+        if (compiler) {
+            compiler->clear();
+        }
+
         master_interrupt_enable_ = false;
         double_speed_ = false;
         halted_ = false;
         stopped_ = false;
+        locked_ = false;
         ei_delay_ = false;
         interrupt_enable = 0;
         interrupt_flag = 0;
 
         if (core->bus.is_compatibility_mode()) {
-            set_flags(FLAG_N, false);
-            set_flags(FLAG_Z, true);
-            set_flags(FLAG_HC | FLAG_CY, true);
+            unpack_flags(FLAG_Z | FLAG_HC | FLAG_CY);
 
             GET_REG(Register::A) = 0x01;
             GET_REG(Register::B) = 0x00;
@@ -60,8 +346,7 @@ namespace GB {
             pc = new_pc;
             sp = 0xFFFE;
         } else {
-            set_flags(FLAG_N | FLAG_HC | FLAG_CY, false);
-            set_flags(FLAG_Z, true);
+            unpack_flags(FLAG_Z);
 
             GET_REG(Register::A) = 0x11;
             GET_REG(Register::B) = 0x00;
@@ -76,9 +361,16 @@ namespace GB {
         }
     }
 
-    void SM83::request_interrupt(uint8_t interrupt) { interrupt_flag |= interrupt; }
+    void SM83::request_interrupt(uint8_t interrupt) {
+        interrupt_flag |= interrupt;
+        block_exit = true;
+    }
+
+    void SM83::exit_stop_mode() { stopped_ = false; }
 
     void SM83::step() {
+        uint64_t start = core->scheduler.now();
+
         service_interrupts();
 
         if (ei_delay_) {
@@ -86,13 +378,74 @@ namespace GB {
             ei_delay_ = false;
         }
 
-        uint8_t opcode = read(pc);
+        if (halted_) {
+            // Only a scheduled event can raise the interrupt that ends HALT.
+            core->skip_to_next_event();
+        }
+
+        if (cached_interpreter && !halted_ && !profiler_ && pc < 0x8000 &&
+            !core->bus.bootstrap_mapped()) {
+            auto cart = core->bus.cartridge();
+
+            if (auto op = cart ? block_cache.find(*cart, pc) : nullptr) {
+                ++instructions_executed;
+                op->handler(*this, *op);
+                return;
+            }
+        }
+
+        if (profiler_) {
+            // HALT has already moved past itself, the time spent halted is charged to it.
+            profiler_->begin_instruction(profile_location(halted_ ? pc - 1 : pc), start);
+        }
+
+        uint8_t opcode = fetch(pc);
 
         if (halted_) {
+            if (profiler_) {
+                profiler_->end_instruction(core->scheduler.now(), false);
+            }
+
             return;
         }
 
-        (this->*opcodes.at(opcode))();
+        ++instructions_executed;
+        execute(opcode);
+
+        if (profiler_) {
+            profiler_->end_instruction(core->scheduler.now(), true);
+        }
+    }
+
+    void SM83::serialize(StateArchive &archive) {
+        // Saving has no side effects, so a run can be checked against a reference block by block.
+        if (archive.loading()) {
+            block_cache.reset_cursor();
+            idle_loop_head = 0xFFFF;
+            idle_probe.valid = false;
+
+            if (compiler) {
+                compiler->reset_mapping();
+            }
+        }
+
+        // Save states keep the registers in B, C, D, E, H, L, F, A order.
+        std::array<uint8_t, 8> ordered_registers{
+            GET_REG(Register::B), GET_REG(Register::C), GET_REG(Register::D), GET_REG(Register::E),
+            GET_REG(Register::H), GET_REG(Register::L), pack_flags(),         GET_REG(Register::A),
+        };
+
+        archive(master_interrupt_enable_, halted_, ei_delay_, stopped_, locked_, double_speed_,
+                interrupt_flag, interrupt_enable, KEY1, sp, pc, ordered_registers);
+
+        GET_REG(Register::B) = ordered_registers[0];
+        GET_REG(Register::C) = ordered_registers[1];
+        GET_REG(Register::D) = ordered_registers[2];
+        GET_REG(Register::E) = ordered_registers[3];
+        GET_REG(Register::H) = ordered_registers[4];
+        GET_REG(Register::L) = ordered_registers[5];
+        GET_REG(Register::A) = ordered_registers[7];
+        unpack_flags(ordered_registers[6]);
     }
 
     void SM83::service_interrupts() {
@@ -114,6 +467,8 @@ namespace GB {
             }
 
             master_interrupt_enable_ = false;
+            idle_probe.valid = false;
+
             if (interrupt_pending & 0x01) {
                 core->tick_subcomponents(8);
                 push_sp(pc);
@@ -150,6 +505,10 @@ namespace GB {
 
                 interrupt_flag &= ~INT_JOYPAD_BIT;
             }
+
+            if (profiler_ && (interrupt_pending & 0x1F)) {
+                profiler_->call(profile_location(pc), sp);
+            }
         }
     }
 
@@ -165,9 +524,49 @@ namespace GB {
         return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(low);
     }
 
+    uint8_t SM83::fetch(uint16_t address) {
+        core->tick_subcomponents(4);
+
+        // Only set while a micro-op without its own handler runs through execute().
+        if (instruction) {
+            switch (address - pc) {
+            case 0:
+                return instruction->opcode;
+            case 1:
+                return instruction->operand & 0xFF;
+            case 2:
+                return instruction->operand >> 8;
+            }
+        }
+
+        return core->bus.read(address);
+    }
+
+    uint16_t SM83::fetch_uint16(uint16_t address) {
+        uint8_t low = fetch(address);
+        uint8_t hi = fetch(address + 1);
+
+        return (static_cast<uint16_t>(hi) << 8) | static_cast<uint16_t>(low);
+    }
+
     void SM83::write(uint16_t address, uint8_t value) {
         core->tick_subcomponents(4);
         core->bus.write(address, value);
+
+        // Writes to the cartridge can switch banks, IO writes can raise interrupts or move events.
+        if (address < 0x8000) {
+            block_cache.reset_cursor();
+            idle_loop_head = 0xFFFF;
+
+            if (compiler) {
+                compiler->reset_mapping();
+            }
+
+            block_exit = true;
+        } else if ((address >= 0xA000 && address < 0xC000) ||
+                   (address >= 0xFF00 && (address < 0xFF80 || address == 0xFFFF))) {
+            block_exit = true;
+        }
     }
 
     void SM83::write_uint16(uint16_t address, uint16_t value) {
@@ -186,80 +585,171 @@ namespace GB {
         return (hi << 8) | low;
     }
 
-    void SM83::set_flags(uint8_t flags, bool set) {
-        if (set) {
-            GET_REG(Register::F) |= flags;
+    uint8_t SM83::pack_flags() const {
+        uint8_t flags = 0;
+
+        flags |= (flag_result & 0xFF) ? 0 : FLAG_Z;
+        flags |= flag_n ? FLAG_N : 0;
+        flags |= (flag_half & 0x10) << 1;
+        flags |= (flag_result & 0x100) >> 4;
+
+        return flags;
+    }
+
+    void SM83::unpack_flags(uint8_t flags) {
+        flag_result = ((flags & FLAG_CY) << 4) | ((flags & FLAG_Z) ? 0 : 1);
+        flag_half = (flags & FLAG_HC) >> 1;
+        flag_n = flags & FLAG_N;
+    }
+
+    bool SM83::get_flag(uint8_t flag) const {
+        switch (flag) {
+        case FLAG_Z: {
+            return (flag_result & 0xFF) == 0;
+        }
+        case FLAG_N: {
+            return flag_n;
+        }
+        case FLAG_HC: {
+            return flag_half & 0x10;
+        }
+        default: {
+            return flag_result & 0x100;
+        }
+        }
+    }
+
+    void SM83::set_rotate_flags(bool carry, uint8_t result) {
+        flag_n = false;
+        flag_half = 0;
+        flag_result = (carry ? 0x100 : 0) | result;
+    }
+
+    void SM83::set_sp_offset_flags(uint16_t sp_value, int16_t offset) {
+        // H and C come from adding the offset to the low byte, Z is always cleared.
+        uint16_t low = (sp_value & 0xFF) + (offset & 0xFF);
+
+        flag_n = false;
+        flag_half = sp_value ^ offset ^ low;
+        flag_result = (low & 0x100) | 1;
+    }
+
+    template <RegisterPair rp> inline uint16_t SM83::get_rp() const {
+        if constexpr (rp == RegisterPair::SP) {
+            return sp;
+        } else if constexpr (rp == RegisterPair::AF) {
+            return static_cast<uint16_t>(GET_REG(Register::A) << 8) | pack_flags();
+        } else {
+            uint16_t value;
+            std::memcpy(&value, &registers[pair_offset(rp)], sizeof(value));
+            return value;
+        }
+    }
+
+    template <RegisterPair rp> inline void SM83::set_rp(uint16_t value) {
+        if constexpr (rp == RegisterPair::SP) {
+            sp = value;
+        } else if constexpr (rp == RegisterPair::AF) {
+            GET_REG(Register::A) = static_cast<uint8_t>(value >> 8);
+            unpack_flags(static_cast<uint8_t>(value & 0x00F0));
         } else {
-            GET_REG(Register::F) &= ~flags;
+            std::memcpy(&registers[pair_offset(rp)], &value, sizeof(value));
         }
     }
 
-    bool SM83::get_flag(uint8_t flag) const { return GET_REG(Register::F) & flag; }
+    template <AluOp op> inline void SM83::alu(uint8_t right) {
+        uint8_t left = GET_REG(Register::A);
 
-    uint16_t SM83::get_rp(RegisterPair index) const {
-        uint16_t hi;
-        uint16_t low;
-        switch (index) {
-        case RegisterPair::BC: {
-            hi = GET_REG(Register::B);
-            low = GET_REG(Register::C);
+        switch (op) {
+        case AluOp::Add:
+        case AluOp::Adc: {
+            uint16_t cy = (op == AluOp::Adc) ? get_flag(FLAG_CY) : 0;
+            uint16_t result = left + right + cy;
+
+            flag_n = false;
+            flag_half = left ^ right ^ result;
+            flag_result = result;
+
+            GET_REG(Register::A) = static_cast<uint8_t>(result);
             break;
         }
-        case RegisterPair::DE: {
-            hi = GET_REG(Register::D);
-            low = GET_REG(Register::E);
+        case AluOp::Sub:
+        case AluOp::Sbc:
+        case AluOp::Cp: {
+            int16_t cy = (op == AluOp::Sbc) ? get_flag(FLAG_CY) : 0;
+            int16_t result = static_cast<int16_t>(left - right - cy);
+
+            // A borrow leaves bit 8 of the result set.
+            flag_n = true;
+            flag_half = left ^ right ^ result;
+            flag_result = result & 0x1FF;
+
+            // Compare is a subtraction that doesn't store its result.
+            if (op != AluOp::Cp) {
+                GET_REG(Register::A) = static_cast<uint8_t>(result);
+            }
             break;
         }
-        case RegisterPair::HL: {
-            hi = GET_REG(Register::H);
-            low = GET_REG(Register::L);
+        case AluOp::And: {
+            GET_REG(Register::A) = left & right;
+            flag_n = false;
+            flag_half = 0x10;
+            flag_result = left & right;
             break;
         }
-        case RegisterPair::SP: {
-            return sp;
+        case AluOp::Xor: {
+            GET_REG(Register::A) = left ^ right;
+            flag_n = false;
+            flag_half = 0;
+            flag_result = left ^ right;
+            break;
         }
-        case RegisterPair::AF: {
-            hi = GET_REG(Register::A);
-            low = GET_REG(Register::F);
+        case AluOp::Or: {
+            GET_REG(Register::A) = left | right;
+            flag_n = false;
+            flag_half = 0;
+            flag_result = left | right;
             break;
         }
         }
+    }
+
+    inline uint8_t SM83::alu_inc(uint8_t value) {
+        uint16_t result = value + 1;
 
-        return (hi << 8) | (low);
+        // C is left as it is.
+        flag_n = false;
+        flag_half = value ^ 1 ^ result;
+        flag_result = (flag_result & 0x100) | (result & 0xFF);
+
+        return static_cast<uint8_t>(result);
     }
 
-    void SM83::set_rp(RegisterPair index, uint16_t temp) {
-        switch (index) {
-        case RegisterPair::BC: {
-            GET_REG(Register::B) = static_cast<uint8_t>((temp & 0xFF00) >> 8);
-            GET_REG(Register::C) = static_cast<uint8_t>(temp & 0x00FF);
-            return;
-        }
-        case RegisterPair::DE: {
-            GET_REG(Register::D) = static_cast<uint8_t>((temp & 0xFF00) >> 8);
-            GET_REG(Register::E) = static_cast<uint8_t>(temp & 0x00FF);
-            return;
-        }
-        case RegisterPair::HL: {
-            GET_REG(Register::H) = static_cast<uint8_t>((temp & 0xFF00) >> 8);
-            GET_REG(Register::L) = static_cast<uint8_t>(temp & 0x00FF);
-            return;
-        }
-        case RegisterPair::SP: {
-            sp = temp;
-            return;
-        }
-        case RegisterPair::AF: {
-            GET_REG(Register::A) = static_cast<uint8_t>((temp & 0xFF00) >> 8);
-            GET_REG(Register::F) = static_cast<uint8_t>(temp & 0x00FF);
-            set_flags(0xF, false);
-            return;
-        }
+    inline uint8_t SM83::alu_dec(uint8_t value) {
+        int16_t result = value - 1;
+
+        // C is left as it is.
+        flag_n = true;
+        flag_half = value ^ 1 ^ result;
+        flag_result = (flag_result & 0x100) | (result & 0xFF);
+
+        return static_cast<uint8_t>(result);
+    }
+
+    template <Register r> inline uint8_t SM83::alu_operand() {
+        if constexpr (r == Register::HL_ADDR) {
+            return read(get_rp<RegisterPair::HL>());
+        } else if constexpr (r == Register::U8) {
+            uint8_t value = fetch(pc + 1);
+            ++pc;
+            return value;
+        } else {
+            return GET_REG(r);
         }
     }
 
     void SM83::op_ld_u16_sp() {
-        auto addr = read_uint16(pc + 1);
+        auto addr = fetch_uint16(pc + 1);
 
         write_uint16(addr, sp);
         pc += 3;
@@ -268,19 +758,21 @@ namespace GB {
     void SM83::op_stop() {
         if (core->bus.is_compatibility_mode()) {
             stopped_ = true;
+            pc += 2;
             return;
         }
 
         if (KEY1 & 0x1) {
             double_speed_ = !double_speed_;
             KEY1 = double_speed_ << 7;
+            core->timer.set_double_speed(double_speed_);
         }
 
         pc += 2;
     }
 
     void SM83::op_jr_i8() {
-        int8_t off = static_cast<int8_t>(read(pc + 1));
+        int8_t off = static_cast<int8_t>(fetch(pc + 1));
 
         pc += 2;
         pc += off;
@@ -291,8 +783,7 @@ namespace GB {
         uint16_t temp = static_cast<uint16_t>(GET_REG(Register::A));
         auto bit7 = temp & 0x80 ? 1 : 0;
 
-        set_flags(FLAG_CY, bit7);
-        set_flags(FLAG_Z | FLAG_N | FLAG_HC, false);
+        set_rotate_flags(bit7, 1);
         temp = (temp << 1) | bit7;
 
         GET_REG(Register::A) = static_cast<uint8_t>(temp & 0xFF);
@@ -303,8 +794,7 @@ namespace GB {
         uint16_t temp = static_cast<uint16_t>(GET_REG(Register::A));
         uint8_t bit0 = (temp & 1) ? 0x80 : 0;
 
-        set_flags(FLAG_CY, (temp & 1));
-        set_flags(FLAG_Z | FLAG_N | FLAG_HC, false);
+        set_rotate_flags(temp & 1, 1);
         temp = (temp >> 1) | bit0;
 
         GET_REG(Register::A) = static_cast<uint8_t>(temp & 0xFF);
@@ -315,8 +805,7 @@ namespace GB {
         uint16_t temp = static_cast<uint16_t>(GET_REG(Register::A));
         uint16_t cy = get_flag(FLAG_CY);
 
-        set_flags(FLAG_CY, (temp & 0x80));
-        set_flags(FLAG_Z | FLAG_N | FLAG_HC, false);
+        set_rotate_flags(temp & 0x80, 1);
         temp = (temp << 1) | cy;
 
         GET_REG(Register::A) = static_cast<uint8_t>(temp & 0xFF);
@@ -328,8 +817,7 @@ namespace GB {
         uint16_t cy = get_flag(FLAG_CY);
 
         cy <<= 7;
-        set_flags(FLAG_CY, (temp & 1));
-        set_flags(FLAG_Z | FLAG_N | FLAG_HC, false);
+        set_rotate_flags(temp & 1, 1);
         temp = (temp >> 1) | cy;
 
         GET_REG(Register::A) = static_cast<uint8_t>(temp & 0xFF);
@@ -354,9 +842,9 @@ namespace GB {
         temp += get_flag(FLAG_N) ? -correct : correct;
         temp &= 0xFF;
 
-        set_flags(FLAG_Z, temp == 0);
-        set_flags(FLAG_HC, false);
-        set_flags(FLAG_CY, cy);
+        // N is left as it is.
+        flag_result = (cy ? 0x100 : 0) | temp;
+        flag_half = 0;
 
         GET_REG(Register::A) = static_cast<uint8_t>(temp);
         ++pc;
@@ -364,44 +852,51 @@ namespace GB {
 
     void SM83::op_cpl() {
         GET_REG(Register::A) = ~GET_REG(Register::A);
-        set_flags(FLAG_N | FLAG_HC, true);
+        flag_n = true;
+        flag_half = 0x10;
         ++pc;
     }
 
     void SM83::op_scf() {
-        set_flags(FLAG_N | FLAG_HC, false);
-        set_flags(FLAG_CY, true);
+        flag_n = false;
+        flag_half = 0;
+        flag_result |= 0x100;
         ++pc;
     }
 
     void SM83::op_ccf() {
-        set_flags(FLAG_N | FLAG_HC, false);
-        set_flags(FLAG_CY, !get_flag(FLAG_CY));
+        flag_n = false;
+        flag_half = 0;
+        flag_result ^= 0x100;
         ++pc;
     }
 
     void SM83::op_jp_u16() {
-        pc = read_uint16(pc + 1);
+        pc = fetch_uint16(pc + 1);
         core->tick_subcomponents(4);
     }
 
     void SM83::op_call_u16() {
         uint16_t saved_pc = pc + 3;
-        auto addr = read_uint16(pc + 1);
+        auto addr = fetch_uint16(pc + 1);
         core->tick_subcomponents(4);
         push_sp(saved_pc);
         pc = addr;
+
+        if (profiler_) {
+            profiler_->call(profile_location(pc), sp);
+        }
     }
 
     void SM83::op_cb() {
-        uint8_t opcode = read(pc + 1);
+        uint8_t opcode = fetch(pc + 1);
 
-        (this->*cb_opcodes.at(opcode))();
+        execute_cb(opcode);
         pc += 2;
     }
 
     void SM83::op_ld_ff00_u8_a() {
-        uint8_t off = read(pc + 1);
+        uint8_t off = fetch(pc + 1);
         write(0xFF00 + off, GET_REG(Register::A));
         pc += 2;
     }
@@ -412,31 +907,29 @@ namespace GB {
     }
 
     void SM83::op_add_sp_i8() {
-        int16_t off = static_cast<int8_t>(read(pc + 1));
+        int16_t off = static_cast<int8_t>(fetch(pc + 1));
         uint16_t sp32 = sp;
         uint16_t res32 = (sp32 + off);
 
         // internal operation?
         core->tick_subcomponents(4);
-        set_rp(RegisterPair::SP, res32 & 0xFFFF);
+        set_rp<RegisterPair::SP>(res32 & 0xFFFF);
         // sp update is visible
         core->tick_subcomponents(4);
-        set_flags(FLAG_HC, ((sp32 & 0xF) + (off & 0xF)) > 0xF);
-        set_flags(FLAG_CY, ((sp32 & 0xFF) + (off & 0xFF)) > 0xFF);
-        set_flags(FLAG_Z | FLAG_N, false);
+        set_sp_offset_flags(sp32, off);
         pc += 2;
     }
 
-    void SM83::op_jp_hl() { pc = get_rp(RegisterPair::HL); }
+    void SM83::op_jp_hl() { pc = get_rp<RegisterPair::HL>(); }
 
     void SM83::op_ld_u16_a() {
-        auto addr = read_uint16(pc + 1);
+        auto addr = fetch_uint16(pc + 1);
         write(addr, GET_REG(Register::A));
         pc += 3;
     }
 
     void SM83::op_ld_a_ff00_u8() {
-        uint16_t off = read(pc + 1);
+        uint16_t off = fetch(pc + 1);
         GET_REG(Register::A) = read(0xFF00 + off);
         pc += 2;
     }
@@ -458,126 +951,68 @@ namespace GB {
     }
 
     void SM83::op_ld_hl_sp_i8() {
-        int16_t off = static_cast<int8_t>(read(pc + 1));
+        int16_t off = static_cast<int8_t>(fetch(pc + 1));
         uint16_t sp32 = sp;
         uint16_t res32 = (sp32 + off);
-        set_rp(RegisterPair::HL, static_cast<uint16_t>(res32 & 0xFFFF));
-        set_flags(FLAG_HC, ((sp32 & 0xF) + (off & 0xF)) > 0xF);
-        set_flags(FLAG_CY, ((sp32 & 0xFF) + (off & 0xFF)) > 0xFF);
-        set_flags(FLAG_Z | FLAG_N, false);
+        set_rp<RegisterPair::HL>(static_cast<uint16_t>(res32 & 0xFFFF));
+        set_sp_offset_flags(sp32, off);
         core->tick_subcomponents(4);
         pc += 2;
     }
 
     void SM83::op_ld_sp_hl() {
-        sp = get_rp(RegisterPair::HL);
+        sp = get_rp<RegisterPair::HL>();
         core->tick_subcomponents(4);
         ++pc;
     }
 
     void SM83::op_ld_a_u16() {
-        auto addr = read_uint16(pc + 1);
+        auto addr = fetch_uint16(pc + 1);
         GET_REG(Register::A) = read(addr);
         pc += 3;
     }
 
     template <bool is_illegal_op, uint8_t illegal_op> void SM83::op_nop() {
         if constexpr (is_illegal_op) {
-            stopped_ = true;
+            locked_ = true;
             return;
         }
         ++pc;
     }
 
     template <RegisterPair rp> inline void SM83::op_ld_rp_u16() {
-        uint16_t combine = read_uint16(pc + 1);
+        uint16_t combine = fetch_uint16(pc + 1);
 
-        set_rp(rp, combine);
+        set_rp<rp>(combine);
         pc += 3;
     }
 
     template <RegisterPair rp> inline void SM83::op_inc_rp() {
-        auto increment = [this](uint8_t &high, uint8_t &low) {
-            uint16_t res = static_cast<uint16_t>(high) << 8 | static_cast<uint16_t>(low);
-
-            ++res;
-            high = static_cast<uint8_t>((res & 0xFF00) >> 8);
-            low = static_cast<uint8_t>(res & 0xFF);
-
-            core->tick_subcomponents(4);
-            ++pc;
-        };
-
-        switch (rp) {
-        case RegisterPair::BC: {
-            increment(GET_REG(Register::B), GET_REG(Register::C));
-            return;
-        }
-        case RegisterPair::DE: {
-            increment(GET_REG(Register::D), GET_REG(Register::E));
-            return;
-        }
-        case RegisterPair::HL: {
-            increment(GET_REG(Register::H), GET_REG(Register::L));
-            return;
-        }
-        case RegisterPair::SP: {
-            sp++;
-            core->tick_subcomponents(4);
-            ++pc;
-            return;
-        }
-        }
+        set_rp<rp>(get_rp<rp>() + 1);
+        core->tick_subcomponents(4);
+        ++pc;
     }
 
     template <RegisterPair rp> void SM83::op_dec_rp() {
-        const auto decrement = [this](uint8_t &high, uint8_t &low) {
-            uint16_t res = static_cast<uint16_t>(high) << 8 | static_cast<uint16_t>(low);
-
-            --res;
-            high = static_cast<uint8_t>((res & 0xFF00) >> 8);
-            low = static_cast<uint8_t>(res & 0xFF);
-
-            core->tick_subcomponents(4);
-            ++pc;
-        };
-
-        switch (rp) {
-        case RegisterPair::BC: {
-            decrement(GET_REG(Register::B), GET_REG(Register::C));
-            return;
-        }
-        case RegisterPair::DE: {
-            decrement(GET_REG(Register::D), GET_REG(Register::E));
-            return;
-        }
-        case RegisterPair::HL: {
-            decrement(GET_REG(Register::H), GET_REG(Register::L));
-            return;
-        }
-        case RegisterPair::SP: {
-            sp--;
-            core->tick_subcomponents(4);
-            ++pc;
-            return;
-        }
-        }
+        set_rp<rp>(get_rp<rp>() - 1);
+        core->tick_subcomponents(4);
+        ++pc;
     }
 
     template <RegisterPair rp, int16_t displacement> inline void SM83::op_ld_rp_a() {
-        uint16_t addr = get_rp(rp);
+        uint16_t addr = get_rp<rp>();
 
         write(addr, GET_REG(Register::A));
 
         if constexpr (displacement != 0) {
-            set_rp(rp, addr + displacement);
+            set_rp<rp>(addr + displacement);
         }
         ++pc;
     }
 
     template <uint8_t cc, bool boolean_ver> inline void SM83::op_jr_cc_i8() {
         if (get_flag(cc) == boolean_ver) {
-            int8_t off = static_cast<int8_t>(read(pc + 1));
+            int8_t off = static_cast<int8_t>(fetch(pc + 1));
 
             pc += 2;
             pc += off;
@@ -589,85 +1024,56 @@ namespace GB {
     }
 
     template <RegisterPair rp> inline void SM83::op_add_hl_rp() {
-        int32_t left = get_rp(RegisterPair::HL);
-        int32_t right = get_rp(rp);
+        int32_t left = get_rp<RegisterPair::HL>();
+        int32_t right = get_rp<rp>();
         int32_t res32 = left + right;
 
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, ((left & 0xFFF) + (right & 0xFFF)) > 0xFFF);
-        set_flags(FLAG_CY, res32 > 0xFFFF);
-        set_rp(RegisterPair::HL, static_cast<uint16_t>(res32 & 0xFFFF));
+        // Z is left as it is, H and C come from bits 11 and 15.
+        flag_n = false;
+        flag_half = (left ^ right ^ res32) >> 8;
+        flag_result = (flag_result & 0xFF) | ((res32 >> 8) & 0x100);
+        set_rp<RegisterPair::HL>(static_cast<uint16_t>(res32 & 0xFFFF));
 
         this->core->tick_subcomponents(4);
         ++pc;
     }
 
     template <Register r> void SM83::op_inc_r() {
-        uint16_t left;
-        uint16_t right = 1;
-
         if constexpr (r == Register::HL_ADDR) {
-            left = read(get_rp(RegisterPair::HL));
+            uint8_t value = read(get_rp<RegisterPair::HL>());
+            write(get_rp<RegisterPair::HL>(), alu_inc(value));
         } else {
-            left = GET_REG(r);
-        }
-
-        auto result = left + right;
-        auto masked_result = result & 0xFF;
-
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_HC, ((left & 0xF) + (right & 0xF)) > 0xF);
-
-        if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), static_cast<uint8_t>(masked_result));
-        } else {
-            GET_REG(r) = static_cast<uint8_t>(masked_result);
+            GET_REG(r) = alu_inc(GET_REG(r));
         }
         ++pc;
     }
 
     template <Register r> void SM83::op_dec_r() {
-        int16_t left;
-        int16_t right = 1;
-
         if constexpr (r == Register::HL_ADDR) {
-            left = read(get_rp(RegisterPair::HL));
+            uint8_t value = read(get_rp<RegisterPair::HL>());
+            write(get_rp<RegisterPair::HL>(), alu_dec(value));
         } else {
-            left = GET_REG(r);
-        }
-
-        auto result = left - right;
-        auto masked_result = result & 0xFF;
-
-        set_flags(FLAG_HC, ((left & 0xF) - (right & 0xF)) < 0);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_N, true); // only set if subtraction
-
-        if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), static_cast<uint8_t>(masked_result));
-        } else {
-            GET_REG(r) = static_cast<uint8_t>(masked_result);
+            GET_REG(r) = alu_dec(GET_REG(r));
         }
         ++pc;
     }
 
     template <Register r> void SM83::op_ld_r_u8() {
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), read(pc + 1));
+            write(get_rp<RegisterPair::HL>(), fetch(pc + 1));
         } else {
-            GET_REG(r) = read(pc + 1);
+            GET_REG(r) = fetch(pc + 1);
         }
         pc += 2;
     }
 
     template <RegisterPair rp, int16_t displacement> void SM83::op_ld_a_rp() {
-        auto addr = get_rp(rp);
+        auto addr = get_rp<rp>();
 
         GET_REG(Register::A) = read(addr);
 
         if constexpr (displacement != 0) {
-            set_rp(rp, addr + displacement);
+            set_rp<rp>(addr + displacement);
         }
         ++pc;
     }
@@ -676,9 +1082,9 @@ namespace GB {
         // r = destination
         // r2 = source
         if constexpr (r == Register::HL_ADDR && r2 != Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), GET_REG(r2));
+            write(get_rp<RegisterPair::HL>(), GET_REG(r2));
         } else if constexpr (r != Register::HL_ADDR && r2 == Register::HL_ADDR) {
-            GET_REG(r) = read(get_rp(RegisterPair::HL));
+            GET_REG(r) = read(get_rp<RegisterPair::HL>());
         } else if constexpr (r == Register::HL_ADDR && r2 == Register::HL_ADDR) {
             halted_ = true;
         } else if constexpr (r != Register::HL_ADDR && r2 != Register::HL_ADDR) {
@@ -688,146 +1094,32 @@ namespace GB {
     }
 
     template <Register r, bool with_carry> void SM83::op_add_a_r() {
-        uint16_t left = static_cast<uint16_t>(GET_REG(Register::A));
-        uint16_t right;
-
-        if constexpr (r == Register::HL_ADDR) {
-            right = static_cast<uint16_t>(read(get_rp(RegisterPair::HL)));
-        } else if constexpr (r == Register::U8) {
-            right = static_cast<uint16_t>(read(pc + 1));
-            ++pc;
-        } else {
-            right = static_cast<uint16_t>(GET_REG(r));
-        }
-
-        uint16_t cy = with_carry ? get_flag(FLAG_CY) : 0;
-
-        uint16_t result = left + right + cy;
-        uint8_t masked_result = result & 0xFF;
-
-        set_flags(FLAG_HC, ((left & 0xF) + (right & 0xF) + (cy & 0xF)) > 0xF);
-        set_flags(FLAG_CY, result > 0xFF);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_N, false);
-
-        GET_REG(Register::A) = masked_result;
+        alu<with_carry ? AluOp::Adc : AluOp::Add>(alu_operand<r>());
         ++pc;
     }
 
     template <Register r, bool with_carry> void SM83::op_sub_a_r() {
-        int16_t left = static_cast<int16_t>(GET_REG(Register::A));
-        int16_t right;
-
-        if constexpr (r == Register::HL_ADDR) {
-            right = static_cast<int16_t>(read(get_rp(RegisterPair::HL)));
-        } else if constexpr (r == Register::U8) {
-            right = static_cast<int16_t>(read(pc + 1));
-            ++pc;
-        } else {
-            right = static_cast<int16_t>(GET_REG(r));
-        }
-
-        int16_t cy = with_carry ? get_flag(FLAG_CY) : 0;
-
-        int16_t result = static_cast<int16_t>(left - right - cy);
-        uint8_t masked_result = result & 0xFF;
-
-        set_flags(FLAG_HC, ((left & 0xF) - (right & 0xF) - (cy & 0xF)) < 0);
-        set_flags(FLAG_CY, result < 0);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_N, true);
-
-        GET_REG(Register::A) = masked_result;
+        alu<with_carry ? AluOp::Sbc : AluOp::Sub>(alu_operand<r>());
         ++pc;
     }
 
     template <Register r> void SM83::op_and_a_r() {
-        uint8_t right;
-
-        if constexpr (r == Register::HL_ADDR) {
-            right = read(get_rp(RegisterPair::HL));
-        } else if constexpr (r == Register::U8) {
-            right = read(pc + 1);
-            ++pc;
-        } else {
-            right = GET_REG(r);
-        }
-
-        uint8_t result = GET_REG(Register::A) & right;
-        set_flags(FLAG_Z, result == 0);
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, true);
-        set_flags(FLAG_CY, false);
-
-        GET_REG(Register::A) = result;
+        alu<AluOp::And>(alu_operand<r>());
         ++pc;
     }
 
     template <Register r> void SM83::op_xor_a_r() {
-        uint8_t right;
-
-        if constexpr (r == Register::HL_ADDR) {
-            right = read(get_rp(RegisterPair::HL));
-        } else if constexpr (r == Register::U8) {
-            right = read(pc + 1);
-            ++pc;
-        } else {
-            right = GET_REG(r);
-        }
-
-        uint8_t result = GET_REG(Register::A) ^ right;
-        set_flags(FLAG_Z, result == 0);
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, false);
-        set_flags(FLAG_CY, false);
-
-        GET_REG(Register::A) = result;
+        alu<AluOp::Xor>(alu_operand<r>());
         ++pc;
     }
 
     template <Register r> void SM83::op_or_a_r() {
-        uint8_t right;
-
-        if constexpr (r == Register::HL_ADDR) {
-            right = read(get_rp(RegisterPair::HL));
-        } else if constexpr (r == Register::U8) {
-            right = read(pc + 1);
-            ++pc;
-        } else {
-            right = GET_REG(r);
-        }
-
-        uint8_t result = GET_REG(Register::A) | right;
-        set_flags(FLAG_Z, result == 0);
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, false);
-        set_flags(FLAG_CY, false);
-
-        GET_REG(Register::A) = result;
+        alu<AluOp::Or>(alu_operand<r>());
         ++pc;
     }
 
     template <Register r> void SM83::op_cp_a_r() {
-        uint8_t right;
-
-        if constexpr (r == Register::HL_ADDR) {
-            right = read(get_rp(RegisterPair::HL));
-        } else if constexpr (r == Register::U8) {
-            right = read(pc + 1);
-            ++pc;
-        } else {
-            right = GET_REG(r);
-        }
-
-        int16_t result = GET_REG(Register::A) - right;
-        uint8_t masked_result = result & 0xFF;
-
-        set_flags(FLAG_HC, ((GET_REG(Register::A) & 0xF) - (right & 0xF)) < 0);
-        set_flags(FLAG_CY, result < 0);
-        set_flags(FLAG_Z, masked_result == 0);
-        set_flags(FLAG_N, true);
-
-        // Register::A is not modified, same as subtract without carry
+        alu<AluOp::Cp>(alu_operand<r>());
         ++pc;
     }
 
@@ -837,6 +1129,10 @@ namespace GB {
 
         pc = pop_sp();
         core->tick_subcomponents(4);
+
+        if (profiler_) {
+            profiler_->ret(sp);
+        }
     }
 
     template <uint8_t cc, bool boolean_ver> void SM83::op_ret_cc() {
@@ -845,6 +1141,10 @@ namespace GB {
         if (get_flag(cc) == boolean_ver) {
             pc = pop_sp();
             core->tick_subcomponents(4);
+
+            if (profiler_) {
+                profiler_->ret(sp);
+            }
             return;
         }
         ++pc;
@@ -852,7 +1152,7 @@ namespace GB {
 
     template <uint8_t cc, bool boolean_ver> void SM83::op_jp_cc_u16() {
         if (get_flag(cc) == boolean_ver) {
-            pc = read_uint16(pc + 1);
+            pc = fetch_uint16(pc + 1);
             core->tick_subcomponents(4);
             return;
         }
@@ -864,10 +1164,14 @@ namespace GB {
     template <uint8_t cc, bool boolean_ver> void SM83::op_call_cc_u16() {
         if (get_flag(cc) == boolean_ver) {
             auto saved_pc = pc + 3;
-            auto addr = read_uint16(pc + 1);
+            auto addr = fetch_uint16(pc + 1);
             core->tick_subcomponents(4);
             push_sp(saved_pc);
             pc = addr;
+
+            if (profiler_) {
+                profiler_->call(profile_location(pc), sp);
+            }
             return;
         }
 
@@ -877,14 +1181,14 @@ namespace GB {
 
     template <RegisterPair rp> void SM83::op_pop_rp() {
         uint16_t temp = pop_sp();
-        set_rp(rp, temp);
+        set_rp<rp>(temp);
         ++pc;
     }
 
     template <RegisterPair rp> void SM83::op_push_rp() {
         core->tick_subcomponents(4);
 
-        push_sp(get_rp(rp));
+        push_sp(get_rp<rp>());
         ++pc;
     }
 
@@ -892,25 +1196,27 @@ namespace GB {
         core->tick_subcomponents(4);
         push_sp(pc + 1);
         pc = page;
+
+        if (profiler_) {
+            profiler_->call(profile_location(pc), sp);
+        }
     }
 
     template <Register r> void SM83::op_rlc() {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
         uint8_t bit7 = (temp & 0x80) ? 1 : 0;
 
-        set_flags(FLAG_CY, bit7);
-        set_flags(FLAG_Z, temp == 0);
-        set_flags(FLAG_N | FLAG_HC, false);
+        set_rotate_flags(bit7, temp);
         temp = temp << 1;
         temp |= bit7;
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), temp);
+            write(get_rp<RegisterPair::HL>(), temp);
         } else {
             GET_REG(r) = temp;
         }
@@ -920,18 +1226,16 @@ namespace GB {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
         uint8_t bit0 = (temp & 0x01) ? 0x80 : 0;
-        set_flags(FLAG_CY, bit0);
-        set_flags(FLAG_Z, temp == 0);
-        set_flags(FLAG_N | FLAG_HC, false);
+        set_rotate_flags(bit0, temp);
         temp = temp >> 1;
         temp |= bit0;
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), temp);
+            write(get_rp<RegisterPair::HL>(), temp);
         } else {
             GET_REG(r) = temp;
         }
@@ -941,20 +1245,18 @@ namespace GB {
         uint16_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
         uint16_t cy = get_flag(FLAG_CY);
-        set_flags(FLAG_CY, (temp & 0x80));
 
         temp = temp << 1;
         temp = temp | cy;
         uint8_t t8 = static_cast<uint8_t>(temp & 0xFF);
-        set_flags(FLAG_Z, t8 == 0);
-        set_flags(FLAG_N | FLAG_HC, false);
+        set_rotate_flags(temp & 0x100, t8);
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), static_cast<uint8_t>(temp));
+            write(get_rp<RegisterPair::HL>(), static_cast<uint8_t>(temp));
         } else {
             GET_REG(r) = t8;
         }
@@ -964,20 +1266,19 @@ namespace GB {
         uint16_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
         uint16_t cy = get_flag(FLAG_CY);
         cy = cy << 7;
-        set_flags(FLAG_CY, (temp & 0x01));
+        bool bit0 = temp & 0x01;
         temp = temp >> 1;
         temp = temp | cy;
         uint8_t t8 = temp & 0xFF;
-        set_flags(FLAG_Z, t8 == 0);
-        set_flags(FLAG_N | FLAG_HC, false);
+        set_rotate_flags(bit0, t8);
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), static_cast<uint8_t>(temp));
+            write(get_rp<RegisterPair::HL>(), static_cast<uint8_t>(temp));
         } else {
             GET_REG(r) = t8;
         }
@@ -987,16 +1288,15 @@ namespace GB {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
-        set_flags(FLAG_CY, (temp & 0x80));
+        bool bit7 = temp & 0x80;
         temp = temp << 1;
-        set_flags(FLAG_Z, temp == 0);
-        set_flags(FLAG_N | FLAG_HC, false);
+        set_rotate_flags(bit7, temp);
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), temp);
+            write(get_rp<RegisterPair::HL>(), temp);
         } else {
             GET_REG(r) = temp;
         }
@@ -1006,18 +1306,17 @@ namespace GB {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
         uint8_t bit7 = (temp & 0x80);
-        set_flags(FLAG_CY, (temp & 0x01));
+        bool bit0 = temp & 0x01;
         temp = temp >> 1;
         temp |= bit7; // bit7 is left unchanged
-        set_flags(FLAG_Z, temp == 0);
-        set_flags(FLAG_N | FLAG_HC, false);
+        set_rotate_flags(bit0, temp);
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), temp);
+            write(get_rp<RegisterPair::HL>(), temp);
         } else {
             GET_REG(r) = temp;
         }
@@ -1027,18 +1326,17 @@ namespace GB {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
         uint8_t hi = (temp & 0xF0) >> 4;
         uint8_t low = (temp & 0x0F) << 4;
         temp = (low) | hi;
 
-        set_flags(FLAG_Z, temp == 0);
-        set_flags(FLAG_N | FLAG_HC | FLAG_CY, false);
+        set_rotate_flags(false, temp);
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), temp);
+            write(get_rp<RegisterPair::HL>(), temp);
         } else {
             GET_REG(r) = temp;
         }
@@ -1048,16 +1346,15 @@ namespace GB {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
-        set_flags(FLAG_CY, (temp & 0x01));
+        bool bit0 = temp & 0x01;
         temp = temp >> 1;
-        set_flags(FLAG_Z, temp == 0);
-        set_flags(FLAG_N | FLAG_HC, false);
+        set_rotate_flags(bit0, temp);
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), temp);
+            write(get_rp<RegisterPair::HL>(), temp);
         } else {
             GET_REG(r) = temp;
         }
@@ -1067,26 +1364,26 @@ namespace GB {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
-        set_flags(FLAG_Z, !(temp & (1 << bit)));
-
-        set_flags(FLAG_N, false);
-        set_flags(FLAG_HC, true);
+        // C is left as it is.
+        flag_n = false;
+        flag_half = 0x10;
+        flag_result = (flag_result & 0x100) | (temp & (1 << bit));
     }
 
     template <uint8_t bit, Register r> void SM83::op_res() {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
         temp &= ~(1 << bit);
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), temp);
+            write(get_rp<RegisterPair::HL>(), temp);
         } else {
             GET_REG(r) = temp;
         }
@@ -1096,19 +1393,19 @@ namespace GB {
         uint8_t temp = GET_REG(r);
 
         if constexpr (r == Register::HL_ADDR) {
-            temp = read(get_rp(RegisterPair::HL));
+            temp = read(get_rp<RegisterPair::HL>());
         }
 
         temp |= (1 << bit);
 
         if constexpr (r == Register::HL_ADDR) {
-            write(get_rp(RegisterPair::HL), temp);
+            write(get_rp<RegisterPair::HL>(), temp);
         } else {
             GET_REG(r) = temp;
         }
     }
 
-    std::array<SM83::opcode_function, 256> SM83::gen_optable() {
+    void SM83::execute(uint8_t opcode) {
         constexpr int16_t NoDisplacement = 0;
         constexpr int16_t Increment = 1;
         constexpr int16_t Decrement = -1;
@@ -1117,605 +1414,1689 @@ namespace GB {
         constexpr bool IgnoreIME = false;
         constexpr bool SetIME = true;
 
-        return std::array<SM83::opcode_function, 256>{
-
-            // 0x00 - 0x0F
-            &SM83::op_nop<false, 0>,
-            &SM83::op_ld_rp_u16<RegisterPair::BC>,
-            &SM83::op_ld_rp_a<RegisterPair::BC, NoDisplacement>,
-            &SM83::op_inc_rp<RegisterPair::BC>,
-            &SM83::op_inc_r<Register::B>,
-            &SM83::op_dec_r<Register::B>,
-            &SM83::op_ld_r_u8<Register::B>,
-            &SM83::op_rlca,
-            &SM83::op_ld_u16_sp,
-            &SM83::op_add_hl_rp<RegisterPair::BC>,
-            &SM83::op_ld_a_rp<RegisterPair::BC, NoDisplacement>,
-            &SM83::op_dec_rp<RegisterPair::BC>,
-            &SM83::op_inc_r<Register::C>,
-            &SM83::op_dec_r<Register::C>,
-            &SM83::op_ld_r_u8<Register::C>,
-            &SM83::op_rrca,
-
-            // 0x10 - 0x1F
-            &SM83::op_stop,
-            &SM83::op_ld_rp_u16<RegisterPair::DE>,
-            &SM83::op_ld_rp_a<RegisterPair::DE, NoDisplacement>,
-            &SM83::op_inc_rp<RegisterPair::DE>,
-            &SM83::op_inc_r<Register::D>,
-            &SM83::op_dec_r<Register::D>,
-            &SM83::op_ld_r_u8<Register::D>,
-            &SM83::op_rla,
-            &SM83::op_jr_i8,
-            &SM83::op_add_hl_rp<RegisterPair::DE>,
-            &SM83::op_ld_a_rp<RegisterPair::DE, NoDisplacement>,
-            &SM83::op_dec_rp<RegisterPair::DE>,
-            &SM83::op_inc_r<Register::E>,
-            &SM83::op_dec_r<Register::E>,
-            &SM83::op_ld_r_u8<Register::E>,
-            &SM83::op_rra,
-
-            // 0x20 - 0x2F
-            &SM83::op_jr_cc_i8<FLAG_Z, false>,
-            &SM83::op_ld_rp_u16<RegisterPair::HL>,
-            &SM83::op_ld_rp_a<RegisterPair::HL, Increment>,
-            &SM83::op_inc_rp<RegisterPair::HL>,
-            &SM83::op_inc_r<Register::H>,
-            &SM83::op_dec_r<Register::H>,
-            &SM83::op_ld_r_u8<Register::H>,
-            &SM83::op_daa,
-            &SM83::op_jr_cc_i8<FLAG_Z, true>,
-            &SM83::op_add_hl_rp<RegisterPair::HL>,
-            &SM83::op_ld_a_rp<RegisterPair::HL, Increment>,
-            &SM83::op_dec_rp<RegisterPair::HL>,
-            &SM83::op_inc_r<Register::L>,
-            &SM83::op_dec_r<Register::L>,
-            &SM83::op_ld_r_u8<Register::L>,
-            &SM83::op_cpl,
-
-            // 0x30 - 0x3F
-            &SM83::op_jr_cc_i8<FLAG_CY, false>,
-            &SM83::op_ld_rp_u16<RegisterPair::SP>,
-            &SM83::op_ld_rp_a<RegisterPair::HL, Decrement>,
-            &SM83::op_inc_rp<RegisterPair::SP>,
-            &SM83::op_inc_r<Register::HL_ADDR>,
-            &SM83::op_dec_r<Register::HL_ADDR>,
-            &SM83::op_ld_r_u8<Register::HL_ADDR>,
-            &SM83::op_scf,
-            &SM83::op_jr_cc_i8<FLAG_CY, true>,
-            &SM83::op_add_hl_rp<RegisterPair::SP>,
-            &SM83::op_ld_a_rp<RegisterPair::HL, Decrement>,
-            &SM83::op_dec_rp<RegisterPair::SP>,
-            &SM83::op_inc_r<Register::A>,
-            &SM83::op_dec_r<Register::A>,
-            &SM83::op_ld_r_u8<Register::A>,
-            &SM83::op_ccf,
-
-            // 0x40 - 0x4F
-            &SM83::op_ld_r_r<Register::B, Register::B>,
-            &SM83::op_ld_r_r<Register::B, Register::C>,
-            &SM83::op_ld_r_r<Register::B, Register::D>,
-            &SM83::op_ld_r_r<Register::B, Register::E>,
-            &SM83::op_ld_r_r<Register::B, Register::H>,
-            &SM83::op_ld_r_r<Register::B, Register::L>,
-            &SM83::op_ld_r_r<Register::B, Register::HL_ADDR>,
-            &SM83::op_ld_r_r<Register::B, Register::A>,
-            &SM83::op_ld_r_r<Register::C, Register::B>,
-            &SM83::op_ld_r_r<Register::C, Register::C>,
-            &SM83::op_ld_r_r<Register::C, Register::D>,
-            &SM83::op_ld_r_r<Register::C, Register::E>,
-            &SM83::op_ld_r_r<Register::C, Register::H>,
-            &SM83::op_ld_r_r<Register::C, Register::L>,
-            &SM83::op_ld_r_r<Register::C, Register::HL_ADDR>,
-            &SM83::op_ld_r_r<Register::C, Register::A>,
-
-            // 0x50 - 0x5F
-            &SM83::op_ld_r_r<Register::D, Register::B>,
-            &SM83::op_ld_r_r<Register::D, Register::C>,
-            &SM83::op_ld_r_r<Register::D, Register::D>,
-            &SM83::op_ld_r_r<Register::D, Register::E>,
-            &SM83::op_ld_r_r<Register::D, Register::H>,
-            &SM83::op_ld_r_r<Register::D, Register::L>,
-            &SM83::op_ld_r_r<Register::D, Register::HL_ADDR>,
-            &SM83::op_ld_r_r<Register::D, Register::A>,
-            &SM83::op_ld_r_r<Register::E, Register::B>,
-            &SM83::op_ld_r_r<Register::E, Register::C>,
-            &SM83::op_ld_r_r<Register::E, Register::D>,
-            &SM83::op_ld_r_r<Register::E, Register::E>,
-            &SM83::op_ld_r_r<Register::E, Register::H>,
-            &SM83::op_ld_r_r<Register::E, Register::L>,
-            &SM83::op_ld_r_r<Register::E, Register::HL_ADDR>,
-            &SM83::op_ld_r_r<Register::E, Register::A>,
-
-            // 0x60 - 0x6F
-            &SM83::op_ld_r_r<Register::H, Register::B>,
-            &SM83::op_ld_r_r<Register::H, Register::C>,
-            &SM83::op_ld_r_r<Register::H, Register::D>,
-            &SM83::op_ld_r_r<Register::H, Register::E>,
-            &SM83::op_ld_r_r<Register::H, Register::H>,
-            &SM83::op_ld_r_r<Register::H, Register::L>,
-            &SM83::op_ld_r_r<Register::H, Register::HL_ADDR>,
-            &SM83::op_ld_r_r<Register::H, Register::A>,
-            &SM83::op_ld_r_r<Register::L, Register::B>,
-            &SM83::op_ld_r_r<Register::L, Register::C>,
-            &SM83::op_ld_r_r<Register::L, Register::D>,
-            &SM83::op_ld_r_r<Register::L, Register::E>,
-            &SM83::op_ld_r_r<Register::L, Register::H>,
-            &SM83::op_ld_r_r<Register::L, Register::L>,
-            &SM83::op_ld_r_r<Register::L, Register::HL_ADDR>,
-            &SM83::op_ld_r_r<Register::L, Register::A>,
-
-            // 0x70 - 0x7F
-            &SM83::op_ld_r_r<Register::HL_ADDR, Register::B>,
-            &SM83::op_ld_r_r<Register::HL_ADDR, Register::C>,
-            &SM83::op_ld_r_r<Register::HL_ADDR, Register::D>,
-            &SM83::op_ld_r_r<Register::HL_ADDR, Register::E>,
-            &SM83::op_ld_r_r<Register::HL_ADDR, Register::H>,
-            &SM83::op_ld_r_r<Register::HL_ADDR, Register::L>,
-            // HALT
-            &SM83::op_ld_r_r<Register::HL_ADDR, Register::HL_ADDR>,
-            &SM83::op_ld_r_r<Register::HL_ADDR, Register::A>,
-            &SM83::op_ld_r_r<Register::A, Register::B>,
-            &SM83::op_ld_r_r<Register::A, Register::C>,
-            &SM83::op_ld_r_r<Register::A, Register::D>,
-            &SM83::op_ld_r_r<Register::A, Register::E>,
-            &SM83::op_ld_r_r<Register::A, Register::H>,
-            &SM83::op_ld_r_r<Register::A, Register::L>,
-            &SM83::op_ld_r_r<Register::A, Register::HL_ADDR>,
-            &SM83::op_ld_r_r<Register::A, Register::A>,
-
-            // 0x80 - 0x8F
-            &SM83::op_add_a_r<Register::B, WithoutCarry>,
-            &SM83::op_add_a_r<Register::C, WithoutCarry>,
-            &SM83::op_add_a_r<Register::D, WithoutCarry>,
-            &SM83::op_add_a_r<Register::E, WithoutCarry>,
-            &SM83::op_add_a_r<Register::H, WithoutCarry>,
-            &SM83::op_add_a_r<Register::L, WithoutCarry>,
-            &SM83::op_add_a_r<Register::HL_ADDR, WithoutCarry>,
-            &SM83::op_add_a_r<Register::A, WithoutCarry>,
-            &SM83::op_add_a_r<Register::B, WithCarry>,
-            &SM83::op_add_a_r<Register::C, WithCarry>,
-            &SM83::op_add_a_r<Register::D, WithCarry>,
-            &SM83::op_add_a_r<Register::E, WithCarry>,
-            &SM83::op_add_a_r<Register::H, WithCarry>,
-            &SM83::op_add_a_r<Register::L, WithCarry>,
-            &SM83::op_add_a_r<Register::HL_ADDR, WithCarry>,
-            &SM83::op_add_a_r<Register::A, WithCarry>,
-
-            // 0x90 - 0x9F
-            &SM83::op_sub_a_r<Register::B, WithoutCarry>,
-            &SM83::op_sub_a_r<Register::C, WithoutCarry>,
-            &SM83::op_sub_a_r<Register::D, WithoutCarry>,
-            &SM83::op_sub_a_r<Register::E, WithoutCarry>,
-            &SM83::op_sub_a_r<Register::H, WithoutCarry>,
-            &SM83::op_sub_a_r<Register::L, WithoutCarry>,
-            &SM83::op_sub_a_r<Register::HL_ADDR, WithoutCarry>,
-            &SM83::op_sub_a_r<Register::A, WithoutCarry>,
-            &SM83::op_sub_a_r<Register::B, WithCarry>,
-            &SM83::op_sub_a_r<Register::C, WithCarry>,
-            &SM83::op_sub_a_r<Register::D, WithCarry>,
-            &SM83::op_sub_a_r<Register::E, WithCarry>,
-            &SM83::op_sub_a_r<Register::H, WithCarry>,
-            &SM83::op_sub_a_r<Register::L, WithCarry>,
-            &SM83::op_sub_a_r<Register::HL_ADDR, WithCarry>,
-            &SM83::op_sub_a_r<Register::A, WithCarry>,
-
-            // 0xA0 - 0xAF
-            &SM83::op_and_a_r<Register::B>,
-            &SM83::op_and_a_r<Register::C>,
-            &SM83::op_and_a_r<Register::D>,
-            &SM83::op_and_a_r<Register::E>,
-            &SM83::op_and_a_r<Register::H>,
-            &SM83::op_and_a_r<Register::L>,
-            &SM83::op_and_a_r<Register::HL_ADDR>,
-            &SM83::op_and_a_r<Register::A>,
-            &SM83::op_xor_a_r<Register::B>,
-            &SM83::op_xor_a_r<Register::C>,
-            &SM83::op_xor_a_r<Register::D>,
-            &SM83::op_xor_a_r<Register::E>,
-            &SM83::op_xor_a_r<Register::H>,
-            &SM83::op_xor_a_r<Register::L>,
-            &SM83::op_xor_a_r<Register::HL_ADDR>,
-            &SM83::op_xor_a_r<Register::A>,
-
-            // 0xB0 - 0xBF
-            &SM83::op_or_a_r<Register::B>,
-            &SM83::op_or_a_r<Register::C>,
-            &SM83::op_or_a_r<Register::D>,
-            &SM83::op_or_a_r<Register::E>,
-            &SM83::op_or_a_r<Register::H>,
-            &SM83::op_or_a_r<Register::L>,
-            &SM83::op_or_a_r<Register::HL_ADDR>,
-            &SM83::op_or_a_r<Register::A>,
-            &SM83::op_cp_a_r<Register::B>,
-            &SM83::op_cp_a_r<Register::C>,
-            &SM83::op_cp_a_r<Register::D>,
-            &SM83::op_cp_a_r<Register::E>,
-            &SM83::op_cp_a_r<Register::H>,
-            &SM83::op_cp_a_r<Register::L>,
-            &SM83::op_cp_a_r<Register::HL_ADDR>,
-            &SM83::op_cp_a_r<Register::A>,
-
-            // 0xC0 - 0xCF
-            &SM83::op_ret_cc<FLAG_Z, false>,
-            &SM83::op_pop_rp<RegisterPair::BC>,
-            &SM83::op_jp_cc_u16<FLAG_Z, false>,
-            &SM83::op_jp_u16,
-            &SM83::op_call_cc_u16<FLAG_Z, false>,
-            &SM83::op_push_rp<RegisterPair::BC>,
-            &SM83::op_add_a_r<Register::U8, WithoutCarry>,
-            &SM83::op_rst_n<0x00>,
-            &SM83::op_ret_cc<FLAG_Z, true>,
-            &SM83::op_ret<IgnoreIME>,
-            &SM83::op_jp_cc_u16<FLAG_Z, true>,
-            &SM83::op_cb,
-            &SM83::op_call_cc_u16<FLAG_Z, true>,
-            &SM83::op_call_u16,
-            &SM83::op_add_a_r<Register::U8, WithCarry>,
-            &SM83::op_rst_n<0x08>,
-
-            // 0xD0 - 0xDF
-            &SM83::op_ret_cc<FLAG_CY, false>,
-            &SM83::op_pop_rp<RegisterPair::DE>,
-            &SM83::op_jp_cc_u16<FLAG_CY, false>,
-            &SM83::op_nop<true, 0xD3>,
-            &SM83::op_call_cc_u16<FLAG_CY, false>,
-            &SM83::op_push_rp<RegisterPair::DE>,
-            &SM83::op_sub_a_r<Register::U8, WithoutCarry>,
-            &SM83::op_rst_n<0x10>,
-            &SM83::op_ret_cc<FLAG_CY, true>,
-            &SM83::op_ret<SetIME>,
-            &SM83::op_jp_cc_u16<FLAG_CY, true>,
-            &SM83::op_nop<true, 0xDB>,
-            &SM83::op_call_cc_u16<FLAG_CY, true>,
-            &SM83::op_nop<true, 0xDD>,
-            &SM83::op_sub_a_r<Register::U8, WithCarry>,
-            &SM83::op_rst_n<0x18>,
-
-            // 0xE0 - 0xEF
-            &SM83::op_ld_ff00_u8_a,
-            &SM83::op_pop_rp<RegisterPair::HL>,
-            &SM83::op_ld_ff00_c_a,
-            &SM83::op_nop<true, 0xE3>,
-            &SM83::op_nop<true, 0xE4>,
-            &SM83::op_push_rp<RegisterPair::HL>,
-            &SM83::op_and_a_r<Register::U8>,
-            &SM83::op_rst_n<0x20>,
-            &SM83::op_add_sp_i8,
-            &SM83::op_jp_hl,
-            &SM83::op_ld_u16_a,
-            &SM83::op_nop<true, 0xEB>,
-            &SM83::op_nop<true, 0xEC>,
-            &SM83::op_nop<true, 0xED>,
-            &SM83::op_xor_a_r<Register::U8>,
-            &SM83::op_rst_n<0x28>,
-
-            // 0xF0 - 0xFF
-            &SM83::op_ld_a_ff00_u8,
-            &SM83::op_pop_rp<RegisterPair::AF>,
-            &SM83::op_ld_a_ff00_c,
-            &SM83::op_di,
-            &SM83::op_nop<true, 0xF4>,
-            &SM83::op_push_rp<RegisterPair::AF>,
-            &SM83::op_or_a_r<Register::U8>,
-            &SM83::op_rst_n<0x30>,
-            &SM83::op_ld_hl_sp_i8,
-            &SM83::op_ld_sp_hl,
-            &SM83::op_ld_a_u16,
-            &SM83::op_ei,
-            &SM83::op_nop<true, 0xFC>,
-            &SM83::op_nop<true, 0xFD>,
-            &SM83::op_cp_a_r<Register::U8>,
-            &SM83::op_rst_n<0x38>,
-        };
+        switch (opcode) {
+        // 0x00 - 0x0F
+        case 0x00:
+            return op_nop<false, 0>();
+        case 0x01:
+            return op_ld_rp_u16<RegisterPair::BC>();
+        case 0x02:
+            return op_ld_rp_a<RegisterPair::BC, NoDisplacement>();
+        case 0x03:
+            return op_inc_rp<RegisterPair::BC>();
+        case 0x04:
+            return op_inc_r<Register::B>();
+        case 0x05:
+            return op_dec_r<Register::B>();
+        case 0x06:
+            return op_ld_r_u8<Register::B>();
+        case 0x07:
+            return op_rlca();
+        case 0x08:
+            return op_ld_u16_sp();
+        case 0x09:
+            return op_add_hl_rp<RegisterPair::BC>();
+        case 0x0A:
+            return op_ld_a_rp<RegisterPair::BC, NoDisplacement>();
+        case 0x0B:
+            return op_dec_rp<RegisterPair::BC>();
+        case 0x0C:
+            return op_inc_r<Register::C>();
+        case 0x0D:
+            return op_dec_r<Register::C>();
+        case 0x0E:
+            return op_ld_r_u8<Register::C>();
+        case 0x0F:
+            return op_rrca();
+
+        // 0x10 - 0x1F
+        case 0x10:
+            return op_stop();
+        case 0x11:
+            return op_ld_rp_u16<RegisterPair::DE>();
+        case 0x12:
+            return op_ld_rp_a<RegisterPair::DE, NoDisplacement>();
+        case 0x13:
+            return op_inc_rp<RegisterPair::DE>();
+        case 0x14:
+            return op_inc_r<Register::D>();
+        case 0x15:
+            return op_dec_r<Register::D>();
+        case 0x16:
+            return op_ld_r_u8<Register::D>();
+        case 0x17:
+            return op_rla();
+        case 0x18:
+            return op_jr_i8();
+        case 0x19:
+            return op_add_hl_rp<RegisterPair::DE>();
+        case 0x1A:
+            return op_ld_a_rp<RegisterPair::DE, NoDisplacement>();
+        case 0x1B:
+            return op_dec_rp<RegisterPair::DE>();
+        case 0x1C:
+            return op_inc_r<Register::E>();
+        case 0x1D:
+            return op_dec_r<Register::E>();
+        case 0x1E:
+            return op_ld_r_u8<Register::E>();
+        case 0x1F:
+            return op_rra();
+
+        // 0x20 - 0x2F
+        case 0x20:
+            return op_jr_cc_i8<FLAG_Z, false>();
+        case 0x21:
+            return op_ld_rp_u16<RegisterPair::HL>();
+        case 0x22:
+            return op_ld_rp_a<RegisterPair::HL, Increment>();
+        case 0x23:
+            return op_inc_rp<RegisterPair::HL>();
+        case 0x24:
+            return op_inc_r<Register::H>();
+        case 0x25:
+            return op_dec_r<Register::H>();
+        case 0x26:
+            return op_ld_r_u8<Register::H>();
+        case 0x27:
+            return op_daa();
+        case 0x28:
+            return op_jr_cc_i8<FLAG_Z, true>();
+        case 0x29:
+            return op_add_hl_rp<RegisterPair::HL>();
+        case 0x2A:
+            return op_ld_a_rp<RegisterPair::HL, Increment>();
+        case 0x2B:
+            return op_dec_rp<RegisterPair::HL>();
+        case 0x2C:
+            return op_inc_r<Register::L>();
+        case 0x2D:
+            return op_dec_r<Register::L>();
+        case 0x2E:
+            return op_ld_r_u8<Register::L>();
+        case 0x2F:
+            return op_cpl();
+
+        // 0x30 - 0x3F
+        case 0x30:
+            return op_jr_cc_i8<FLAG_CY, false>();
+        case 0x31:
+            return op_ld_rp_u16<RegisterPair::SP>();
+        case 0x32:
+            return op_ld_rp_a<RegisterPair::HL, Decrement>();
+        case 0x33:
+            return op_inc_rp<RegisterPair::SP>();
+        case 0x34:
+            return op_inc_r<Register::HL_ADDR>();
+        case 0x35:
+            return op_dec_r<Register::HL_ADDR>();
+        case 0x36:
+            return op_ld_r_u8<Register::HL_ADDR>();
+        case 0x37:
+            return op_scf();
+        case 0x38:
+            return op_jr_cc_i8<FLAG_CY, true>();
+        case 0x39:
+            return op_add_hl_rp<RegisterPair::SP>();
+        case 0x3A:
+            return op_ld_a_rp<RegisterPair::HL, Decrement>();
+        case 0x3B:
+            return op_dec_rp<RegisterPair::SP>();
+        case 0x3C:
+            return op_inc_r<Register::A>();
+        case 0x3D:
+            return op_dec_r<Register::A>();
+        case 0x3E:
+            return op_ld_r_u8<Register::A>();
+        case 0x3F:
+            return op_ccf();
+
+        // 0x40 - 0x4F
+        case 0x40:
+            return op_ld_r_r<Register::B, Register::B>();
+        case 0x41:
+            return op_ld_r_r<Register::B, Register::C>();
+        case 0x42:
+            return op_ld_r_r<Register::B, Register::D>();
+        case 0x43:
+            return op_ld_r_r<Register::B, Register::E>();
+        case 0x44:
+            return op_ld_r_r<Register::B, Register::H>();
+        case 0x45:
+            return op_ld_r_r<Register::B, Register::L>();
+        case 0x46:
+            return op_ld_r_r<Register::B, Register::HL_ADDR>();
+        case 0x47:
+            return op_ld_r_r<Register::B, Register::A>();
+        case 0x48:
+            return op_ld_r_r<Register::C, Register::B>();
+        case 0x49:
+            return op_ld_r_r<Register::C, Register::C>();
+        case 0x4A:
+            return op_ld_r_r<Register::C, Register::D>();
+        case 0x4B:
+            return op_ld_r_r<Register::C, Register::E>();
+        case 0x4C:
+            return op_ld_r_r<Register::C, Register::H>();
+        case 0x4D:
+            return op_ld_r_r<Register::C, Register::L>();
+        case 0x4E:
+            return op_ld_r_r<Register::C, Register::HL_ADDR>();
+        case 0x4F:
+            return op_ld_r_r<Register::C, Register::A>();
+
+        // 0x50 - 0x5F
+        case 0x50:
+            return op_ld_r_r<Register::D, Register::B>();
+        case 0x51:
+            return op_ld_r_r<Register::D, Register::C>();
+        case 0x52:
+            return op_ld_r_r<Register::D, Register::D>();
+        case 0x53:
+            return op_ld_r_r<Register::D, Register::E>();
+        case 0x54:
+            return op_ld_r_r<Register::D, Register::H>();
+        case 0x55:
+            return op_ld_r_r<Register::D, Register::L>();
+        case 0x56:
+            return op_ld_r_r<Register::D, Register::HL_ADDR>();
+        case 0x57:
+            return op_ld_r_r<Register::D, Register::A>();
+        case 0x58:
+            return op_ld_r_r<Register::E, Register::B>();
+        case 0x59:
+            return op_ld_r_r<Register::E, Register::C>();
+        case 0x5A:
+            return op_ld_r_r<Register::E, Register::D>();
+        case 0x5B:
+            return op_ld_r_r<Register::E, Register::E>();
+        case 0x5C:
+            return op_ld_r_r<Register::E, Register::H>();
+        case 0x5D:
+            return op_ld_r_r<Register::E, Register::L>();
+        case 0x5E:
+            return op_ld_r_r<Register::E, Register::HL_ADDR>();
+        case 0x5F:
+            return op_ld_r_r<Register::E, Register::A>();
+
+        // 0x60 - 0x6F
+        case 0x60:
+            return op_ld_r_r<Register::H, Register::B>();
+        case 0x61:
+            return op_ld_r_r<Register::H, Register::C>();
+        case 0x62:
+            return op_ld_r_r<Register::H, Register::D>();
+        case 0x63:
+            return op_ld_r_r<Register::H, Register::E>();
+        case 0x64:
+            return op_ld_r_r<Register::H, Register::H>();
+        case 0x65:
+            return op_ld_r_r<Register::H, Register::L>();
+        case 0x66:
+            return op_ld_r_r<Register::H, Register::HL_ADDR>();
+        case 0x67:
+            return op_ld_r_r<Register::H, Register::A>();
+        case 0x68:
+            return op_ld_r_r<Register::L, Register::B>();
+        case 0x69:
+            return op_ld_r_r<Register::L, Register::C>();
+        case 0x6A:
+            return op_ld_r_r<Register::L, Register::D>();
+        case 0x6B:
+            return op_ld_r_r<Register::L, Register::E>();
+        case 0x6C:
+            return op_ld_r_r<Register::L, Register::H>();
+        case 0x6D:
+            return op_ld_r_r<Register::L, Register::L>();
+        case 0x6E:
+            return op_ld_r_r<Register::L, Register::HL_ADDR>();
+        case 0x6F:
+            return op_ld_r_r<Register::L, Register::A>();
+
+        // 0x70 - 0x7F
+        case 0x70:
+            return op_ld_r_r<Register::HL_ADDR, Register::B>();
+        case 0x71:
+            return op_ld_r_r<Register::HL_ADDR, Register::C>();
+        case 0x72:
+            return op_ld_r_r<Register::HL_ADDR, Register::D>();
+        case 0x73:
+            return op_ld_r_r<Register::HL_ADDR, Register::E>();
+        case 0x74:
+            return op_ld_r_r<Register::HL_ADDR, Register::H>();
+        case 0x75:
+            return op_ld_r_r<Register::HL_ADDR, Register::L>();
+        case 0x76:
+            return op_ld_r_r<Register::HL_ADDR, Register::HL_ADDR>();
+        case 0x77:
+            return op_ld_r_r<Register::HL_ADDR, Register::A>();
+        case 0x78:
+            return op_ld_r_r<Register::A, Register::B>();
+        case 0x79:
+            return op_ld_r_r<Register::A, Register::C>();
+        case 0x7A:
+            return op_ld_r_r<Register::A, Register::D>();
+        case 0x7B:
+            return op_ld_r_r<Register::A, Register::E>();
+        case 0x7C:
+            return op_ld_r_r<Register::A, Register::H>();
+        case 0x7D:
+            return op_ld_r_r<Register::A, Register::L>();
+        case 0x7E:
+            return op_ld_r_r<Register::A, Register::HL_ADDR>();
+        case 0x7F:
+            return op_ld_r_r<Register::A, Register::A>();
+
+        // 0x80 - 0x8F
+        case 0x80:
+            return op_add_a_r<Register::B, WithoutCarry>();
+        case 0x81:
+            return op_add_a_r<Register::C, WithoutCarry>();
+        case 0x82:
+            return op_add_a_r<Register::D, WithoutCarry>();
+        case 0x83:
+            return op_add_a_r<Register::E, WithoutCarry>();
+        case 0x84:
+            return op_add_a_r<Register::H, WithoutCarry>();
+        case 0x85:
+            return op_add_a_r<Register::L, WithoutCarry>();
+        case 0x86:
+            return op_add_a_r<Register::HL_ADDR, WithoutCarry>();
+        case 0x87:
+            return op_add_a_r<Register::A, WithoutCarry>();
+        case 0x88:
+            return op_add_a_r<Register::B, WithCarry>();
+        case 0x89:
+            return op_add_a_r<Register::C, WithCarry>();
+        case 0x8A:
+            return op_add_a_r<Register::D, WithCarry>();
+        case 0x8B:
+            return op_add_a_r<Register::E, WithCarry>();
+        case 0x8C:
+            return op_add_a_r<Register::H, WithCarry>();
+        case 0x8D:
+            return op_add_a_r<Register::L, WithCarry>();
+        case 0x8E:
+            return op_add_a_r<Register::HL_ADDR, WithCarry>();
+        case 0x8F:
+            return op_add_a_r<Register::A, WithCarry>();
+
+        // 0x90 - 0x9F
+        case 0x90:
+            return op_sub_a_r<Register::B, WithoutCarry>();
+        case 0x91:
+            return op_sub_a_r<Register::C, WithoutCarry>();
+        case 0x92:
+            return op_sub_a_r<Register::D, WithoutCarry>();
+        case 0x93:
+            return op_sub_a_r<Register::E, WithoutCarry>();
+        case 0x94:
+            return op_sub_a_r<Register::H, WithoutCarry>();
+        case 0x95:
+            return op_sub_a_r<Register::L, WithoutCarry>();
+        case 0x96:
+            return op_sub_a_r<Register::HL_ADDR, WithoutCarry>();
+        case 0x97:
+            return op_sub_a_r<Register::A, WithoutCarry>();
+        case 0x98:
+            return op_sub_a_r<Register::B, WithCarry>();
+        case 0x99:
+            return op_sub_a_r<Register::C, WithCarry>();
+        case 0x9A:
+            return op_sub_a_r<Register::D, WithCarry>();
+        case 0x9B:
+            return op_sub_a_r<Register::E, WithCarry>();
+        case 0x9C:
+            return op_sub_a_r<Register::H, WithCarry>();
+        case 0x9D:
+            return op_sub_a_r<Register::L, WithCarry>();
+        case 0x9E:
+            return op_sub_a_r<Register::HL_ADDR, WithCarry>();
+        case 0x9F:
+            return op_sub_a_r<Register::A, WithCarry>();
+
+        // 0xA0 - 0xAF
+        case 0xA0:
+            return op_and_a_r<Register::B>();
+        case 0xA1:
+            return op_and_a_r<Register::C>();
+        case 0xA2:
+            return op_and_a_r<Register::D>();
+        case 0xA3:
+            return op_and_a_r<Register::E>();
+        case 0xA4:
+            return op_and_a_r<Register::H>();
+        case 0xA5:
+            return op_and_a_r<Register::L>();
+        case 0xA6:
+            return op_and_a_r<Register::HL_ADDR>();
+        case 0xA7:
+            return op_and_a_r<Register::A>();
+        case 0xA8:
+            return op_xor_a_r<Register::B>();
+        case 0xA9:
+            return op_xor_a_r<Register::C>();
+        case 0xAA:
+            return op_xor_a_r<Register::D>();
+        case 0xAB:
+            return op_xor_a_r<Register::E>();
+        case 0xAC:
+            return op_xor_a_r<Register::H>();
+        case 0xAD:
+            return op_xor_a_r<Register::L>();
+        case 0xAE:
+            return op_xor_a_r<Register::HL_ADDR>();
+        case 0xAF:
+            return op_xor_a_r<Register::A>();
+
+        // 0xB0 - 0xBF
+        case 0xB0:
+            return op_or_a_r<Register::B>();
+        case 0xB1:
+            return op_or_a_r<Register::C>();
+        case 0xB2:
+            return op_or_a_r<Register::D>();
+        case 0xB3:
+            return op_or_a_r<Register::E>();
+        case 0xB4:
+            return op_or_a_r<Register::H>();
+        case 0xB5:
+            return op_or_a_r<Register::L>();
+        case 0xB6:
+            return op_or_a_r<Register::HL_ADDR>();
+        case 0xB7:
+            return op_or_a_r<Register::A>();
+        case 0xB8:
+            return op_cp_a_r<Register::B>();
+        case 0xB9:
+            return op_cp_a_r<Register::C>();
+        case 0xBA:
+            return op_cp_a_r<Register::D>();
+        case 0xBB:
+            return op_cp_a_r<Register::E>();
+        case 0xBC:
+            return op_cp_a_r<Register::H>();
+        case 0xBD:
+            return op_cp_a_r<Register::L>();
+        case 0xBE:
+            return op_cp_a_r<Register::HL_ADDR>();
+        case 0xBF:
+            return op_cp_a_r<Register::A>();
+
+        // 0xC0 - 0xCF
+        case 0xC0:
+            return op_ret_cc<FLAG_Z, false>();
+        case 0xC1:
+            return op_pop_rp<RegisterPair::BC>();
+        case 0xC2:
+            return op_jp_cc_u16<FLAG_Z, false>();
+        case 0xC3:
+            return op_jp_u16();
+        case 0xC4:
+            return op_call_cc_u16<FLAG_Z, false>();
+        case 0xC5:
+            return op_push_rp<RegisterPair::BC>();
+        case 0xC6:
+            return op_add_a_r<Register::U8, WithoutCarry>();
+        case 0xC7:
+            return op_rst_n<0x00>();
+        case 0xC8:
+            return op_ret_cc<FLAG_Z, true>();
+        case 0xC9:
+            return op_ret<IgnoreIME>();
+        case 0xCA:
+            return op_jp_cc_u16<FLAG_Z, true>();
+        case 0xCB:
+            return op_cb();
+        case 0xCC:
+            return op_call_cc_u16<FLAG_Z, true>();
+        case 0xCD:
+            return op_call_u16();
+        case 0xCE:
+            return op_add_a_r<Register::U8, WithCarry>();
+        case 0xCF:
+            return op_rst_n<0x08>();
+
+        // 0xD0 - 0xDF
+        case 0xD0:
+            return op_ret_cc<FLAG_CY, false>();
+        case 0xD1:
+            return op_pop_rp<RegisterPair::DE>();
+        case 0xD2:
+            return op_jp_cc_u16<FLAG_CY, false>();
+        case 0xD3:
+            return op_nop<true, 0xD3>();
+        case 0xD4:
+            return op_call_cc_u16<FLAG_CY, false>();
+        case 0xD5:
+            return op_push_rp<RegisterPair::DE>();
+        case 0xD6:
+            return op_sub_a_r<Register::U8, WithoutCarry>();
+        case 0xD7:
+            return op_rst_n<0x10>();
+        case 0xD8:
+            return op_ret_cc<FLAG_CY, true>();
+        case 0xD9:
+            return op_ret<SetIME>();
+        case 0xDA:
+            return op_jp_cc_u16<FLAG_CY, true>();
+        case 0xDB:
+            return op_nop<true, 0xDB>();
+        case 0xDC:
+            return op_call_cc_u16<FLAG_CY, true>();
+        case 0xDD:
+            return op_nop<true, 0xDD>();
+        case 0xDE:
+            return op_sub_a_r<Register::U8, WithCarry>();
+        case 0xDF:
+            return op_rst_n<0x18>();
+
+        // 0xE0 - 0xEF
+        case 0xE0:
+            return op_ld_ff00_u8_a();
+        case 0xE1:
+            return op_pop_rp<RegisterPair::HL>();
+        case 0xE2:
+            return op_ld_ff00_c_a();
+        case 0xE3:
+            return op_nop<true, 0xE3>();
+        case 0xE4:
+            return op_nop<true, 0xE4>();
+        case 0xE5:
+            return op_push_rp<RegisterPair::HL>();
+        case 0xE6:
+            return op_and_a_r<Register::U8>();
+        case 0xE7:
+            return op_rst_n<0x20>();
+        case 0xE8:
+            return op_add_sp_i8();
+        case 0xE9:
+            return op_jp_hl();
+        case 0xEA:
+            return op_ld_u16_a();
+        case 0xEB:
+            return op_nop<true, 0xEB>();
+        case 0xEC:
+            return op_nop<true, 0xEC>();
+        case 0xED:
+            return op_nop<true, 0xED>();
+        case 0xEE:
+            return op_xor_a_r<Register::U8>();
+        case 0xEF:
+            return op_rst_n<0x28>();
+
+        // 0xF0 - 0xFF
+        case 0xF0:
+            return op_ld_a_ff00_u8();
+        case 0xF1:
+            return op_pop_rp<RegisterPair::AF>();
+        case 0xF2:
+            return op_ld_a_ff00_c();
+        case 0xF3:
+            return op_di();
+        case 0xF4:
+            return op_nop<true, 0xF4>();
+        case 0xF5:
+            return op_push_rp<RegisterPair::AF>();
+        case 0xF6:
+            return op_or_a_r<Register::U8>();
+        case 0xF7:
+            return op_rst_n<0x30>();
+        case 0xF8:
+            return op_ld_hl_sp_i8();
+        case 0xF9:
+            return op_ld_sp_hl();
+        case 0xFA:
+            return op_ld_a_u16();
+        case 0xFB:
+            return op_ei();
+        case 0xFC:
+            return op_nop<true, 0xFC>();
+        case 0xFD:
+            return op_nop<true, 0xFD>();
+        case 0xFE:
+            return op_cp_a_r<Register::U8>();
+        case 0xFF:
+            return op_rst_n<0x38>();
+        }
+    }
+
+    void SM83::execute_cb(uint8_t opcode) {
+        switch (opcode) {
+        // 0x00 - 0x0F
+        case 0x00:
+            return op_rlc<Register::B>();
+        case 0x01:
+            return op_rlc<Register::C>();
+        case 0x02:
+            return op_rlc<Register::D>();
+        case 0x03:
+            return op_rlc<Register::E>();
+        case 0x04:
+            return op_rlc<Register::H>();
+        case 0x05:
+            return op_rlc<Register::L>();
+        case 0x06:
+            return op_rlc<Register::HL_ADDR>();
+        case 0x07:
+            return op_rlc<Register::A>();
+        case 0x08:
+            return op_rrc<Register::B>();
+        case 0x09:
+            return op_rrc<Register::C>();
+        case 0x0A:
+            return op_rrc<Register::D>();
+        case 0x0B:
+            return op_rrc<Register::E>();
+        case 0x0C:
+            return op_rrc<Register::H>();
+        case 0x0D:
+            return op_rrc<Register::L>();
+        case 0x0E:
+            return op_rrc<Register::HL_ADDR>();
+        case 0x0F:
+            return op_rrc<Register::A>();
+
+        // 0x10 - 0x1F
+        case 0x10:
+            return op_rl<Register::B>();
+        case 0x11:
+            return op_rl<Register::C>();
+        case 0x12:
+            return op_rl<Register::D>();
+        case 0x13:
+            return op_rl<Register::E>();
+        case 0x14:
+            return op_rl<Register::H>();
+        case 0x15:
+            return op_rl<Register::L>();
+        case 0x16:
+            return op_rl<Register::HL_ADDR>();
+        case 0x17:
+            return op_rl<Register::A>();
+        case 0x18:
+            return op_rr<Register::B>();
+        case 0x19:
+            return op_rr<Register::C>();
+        case 0x1A:
+            return op_rr<Register::D>();
+        case 0x1B:
+            return op_rr<Register::E>();
+        case 0x1C:
+            return op_rr<Register::H>();
+        case 0x1D:
+            return op_rr<Register::L>();
+        case 0x1E:
+            return op_rr<Register::HL_ADDR>();
+        case 0x1F:
+            return op_rr<Register::A>();
+
+        // 0x20 - 0x2F
+        case 0x20:
+            return op_sla<Register::B>();
+        case 0x21:
+            return op_sla<Register::C>();
+        case 0x22:
+            return op_sla<Register::D>();
+        case 0x23:
+            return op_sla<Register::E>();
+        case 0x24:
+            return op_sla<Register::H>();
+        case 0x25:
+            return op_sla<Register::L>();
+        case 0x26:
+            return op_sla<Register::HL_ADDR>();
+        case 0x27:
+            return op_sla<Register::A>();
+        case 0x28:
+            return op_sra<Register::B>();
+        case 0x29:
+            return op_sra<Register::C>();
+        case 0x2A:
+            return op_sra<Register::D>();
+        case 0x2B:
+            return op_sra<Register::E>();
+        case 0x2C:
+            return op_sra<Register::H>();
+        case 0x2D:
+            return op_sra<Register::L>();
+        case 0x2E:
+            return op_sra<Register::HL_ADDR>();
+        case 0x2F:
+            return op_sra<Register::A>();
+
+        // 0x30 - 0x3F
+        case 0x30:
+            return op_swap<Register::B>();
+        case 0x31:
+            return op_swap<Register::C>();
+        case 0x32:
+            return op_swap<Register::D>();
+        case 0x33:
+            return op_swap<Register::E>();
+        case 0x34:
+            return op_swap<Register::H>();
+        case 0x35:
+            return op_swap<Register::L>();
+        case 0x36:
+            return op_swap<Register::HL_ADDR>();
+        case 0x37:
+            return op_swap<Register::A>();
+        case 0x38:
+            return op_srl<Register::B>();
+        case 0x39:
+            return op_srl<Register::C>();
+        case 0x3A:
+            return op_srl<Register::D>();
+        case 0x3B:
+            return op_srl<Register::E>();
+        case 0x3C:
+            return op_srl<Register::H>();
+        case 0x3D:
+            return op_srl<Register::L>();
+        case 0x3E:
+            return op_srl<Register::HL_ADDR>();
+        case 0x3F:
+            return op_srl<Register::A>();
+
+        // 0x40 - 0x4F
+        case 0x40:
+            return op_bit<0, Register::B>();
+        case 0x41:
+            return op_bit<0, Register::C>();
+        case 0x42:
+            return op_bit<0, Register::D>();
+        case 0x43:
+            return op_bit<0, Register::E>();
+        case 0x44:
+            return op_bit<0, Register::H>();
+        case 0x45:
+            return op_bit<0, Register::L>();
+        case 0x46:
+            return op_bit<0, Register::HL_ADDR>();
+        case 0x47:
+            return op_bit<0, Register::A>();
+        case 0x48:
+            return op_bit<1, Register::B>();
+        case 0x49:
+            return op_bit<1, Register::C>();
+        case 0x4A:
+            return op_bit<1, Register::D>();
+        case 0x4B:
+            return op_bit<1, Register::E>();
+        case 0x4C:
+            return op_bit<1, Register::H>();
+        case 0x4D:
+            return op_bit<1, Register::L>();
+        case 0x4E:
+            return op_bit<1, Register::HL_ADDR>();
+        case 0x4F:
+            return op_bit<1, Register::A>();
+
+        // 0x50 - 0x5F
+        case 0x50:
+            return op_bit<2, Register::B>();
+        case 0x51:
+            return op_bit<2, Register::C>();
+        case 0x52:
+            return op_bit<2, Register::D>();
+        case 0x53:
+            return op_bit<2, Register::E>();
+        case 0x54:
+            return op_bit<2, Register::H>();
+        case 0x55:
+            return op_bit<2, Register::L>();
+        case 0x56:
+            return op_bit<2, Register::HL_ADDR>();
+        case 0x57:
+            return op_bit<2, Register::A>();
+        case 0x58:
+            return op_bit<3, Register::B>();
+        case 0x59:
+            return op_bit<3, Register::C>();
+        case 0x5A:
+            return op_bit<3, Register::D>();
+        case 0x5B:
+            return op_bit<3, Register::E>();
+        case 0x5C:
+            return op_bit<3, Register::H>();
+        case 0x5D:
+            return op_bit<3, Register::L>();
+        case 0x5E:
+            return op_bit<3, Register::HL_ADDR>();
+        case 0x5F:
+            return op_bit<3, Register::A>();
+
+        // 0x60 - 0x6F
+        case 0x60:
+            return op_bit<4, Register::B>();
+        case 0x61:
+            return op_bit<4, Register::C>();
+        case 0x62:
+            return op_bit<4, Register::D>();
+        case 0x63:
+            return op_bit<4, Register::E>();
+        case 0x64:
+            return op_bit<4, Register::H>();
+        case 0x65:
+            return op_bit<4, Register::L>();
+        case 0x66:
+            return op_bit<4, Register::HL_ADDR>();
+        case 0x67:
+            return op_bit<4, Register::A>();
+        case 0x68:
+            return op_bit<5, Register::B>();
+        case 0x69:
+            return op_bit<5, Register::C>();
+        case 0x6A:
+            return op_bit<5, Register::D>();
+        case 0x6B:
+            return op_bit<5, Register::E>();
+        case 0x6C:
+            return op_bit<5, Register::H>();
+        case 0x6D:
+            return op_bit<5, Register::L>();
+        case 0x6E:
+            return op_bit<5, Register::HL_ADDR>();
+        case 0x6F:
+            return op_bit<5, Register::A>();
+
+        // 0x70 - 0x7F
+        case 0x70:
+            return op_bit<6, Register::B>();
+        case 0x71:
+            return op_bit<6, Register::C>();
+        case 0x72:
+            return op_bit<6, Register::D>();
+        case 0x73:
+            return op_bit<6, Register::E>();
+        case 0x74:
+            return op_bit<6, Register::H>();
+        case 0x75:
+            return op_bit<6, Register::L>();
+        case 0x76:
+            return op_bit<6, Register::HL_ADDR>();
+        case 0x77:
+            return op_bit<6, Register::A>();
+        case 0x78:
+            return op_bit<7, Register::B>();
+        case 0x79:
+            return op_bit<7, Register::C>();
+        case 0x7A:
+            return op_bit<7, Register::D>();
+        case 0x7B:
+            return op_bit<7, Register::E>();
+        case 0x7C:
+            return op_bit<7, Register::H>();
+        case 0x7D:
+            return op_bit<7, Register::L>();
+        case 0x7E:
+            return op_bit<7, Register::HL_ADDR>();
+        case 0x7F:
+            return op_bit<7, Register::A>();
+
+        // 0x80 - 0x8F
+        case 0x80:
+            return op_res<0, Register::B>();
+        case 0x81:
+            return op_res<0, Register::C>();
+        case 0x82:
+            return op_res<0, Register::D>();
+        case 0x83:
+            return op_res<0, Register::E>();
+        case 0x84:
+            return op_res<0, Register::H>();
+        case 0x85:
+            return op_res<0, Register::L>();
+        case 0x86:
+            return op_res<0, Register::HL_ADDR>();
+        case 0x87:
+            return op_res<0, Register::A>();
+        case 0x88:
+            return op_res<1, Register::B>();
+        case 0x89:
+            return op_res<1, Register::C>();
+        case 0x8A:
+            return op_res<1, Register::D>();
+        case 0x8B:
+            return op_res<1, Register::E>();
+        case 0x8C:
+            return op_res<1, Register::H>();
+        case 0x8D:
+            return op_res<1, Register::L>();
+        case 0x8E:
+            return op_res<1, Register::HL_ADDR>();
+        case 0x8F:
+            return op_res<1, Register::A>();
+
+        // 0x90 - 0x9F
+        case 0x90:
+            return op_res<2, Register::B>();
+        case 0x91:
+            return op_res<2, Register::C>();
+        case 0x92:
+            return op_res<2, Register::D>();
+        case 0x93:
+            return op_res<2, Register::E>();
+        case 0x94:
+            return op_res<2, Register::H>();
+        case 0x95:
+            return op_res<2, Register::L>();
+        case 0x96:
+            return op_res<2, Register::HL_ADDR>();
+        case 0x97:
+            return op_res<2, Register::A>();
+        case 0x98:
+            return op_res<3, Register::B>();
+        case 0x99:
+            return op_res<3, Register::C>();
+        case 0x9A:
+            return op_res<3, Register::D>();
+        case 0x9B:
+            return op_res<3, Register::E>();
+        case 0x9C:
+            return op_res<3, Register::H>();
+        case 0x9D:
+            return op_res<3, Register::L>();
+        case 0x9E:
+            return op_res<3, Register::HL_ADDR>();
+        case 0x9F:
+            return op_res<3, Register::A>();
+
+        // 0xA0 - 0xAF
+        case 0xA0:
+            return op_res<4, Register::B>();
+        case 0xA1:
+            return op_res<4, Register::C>();
+        case 0xA2:
+            return op_res<4, Register::D>();
+        case 0xA3:
+            return op_res<4, Register::E>();
+        case 0xA4:
+            return op_res<4, Register::H>();
+        case 0xA5:
+            return op_res<4, Register::L>();
+        case 0xA6:
+            return op_res<4, Register::HL_ADDR>();
+        case 0xA7:
+            return op_res<4, Register::A>();
+        case 0xA8:
+            return op_res<5, Register::B>();
+        case 0xA9:
+            return op_res<5, Register::C>();
+        case 0xAA:
+            return op_res<5, Register::D>();
+        case 0xAB:
+            return op_res<5, Register::E>();
+        case 0xAC:
+            return op_res<5, Register::H>();
+        case 0xAD:
+            return op_res<5, Register::L>();
+        case 0xAE:
+            return op_res<5, Register::HL_ADDR>();
+        case 0xAF:
+            return op_res<5, Register::A>();
+
+        // 0xB0 - 0xBF
+        case 0xB0:
+            return op_res<6, Register::B>();
+        case 0xB1:
+            return op_res<6, Register::C>();
+        case 0xB2:
+            return op_res<6, Register::D>();
+        case 0xB3:
+            return op_res<6, Register::E>();
+        case 0xB4:
+            return op_res<6, Register::H>();
+        case 0xB5:
+            return op_res<6, Register::L>();
+        case 0xB6:
+            return op_res<6, Register::HL_ADDR>();
+        case 0xB7:
+            return op_res<6, Register::A>();
+        case 0xB8:
+            return op_res<7, Register::B>();
+        case 0xB9:
+            return op_res<7, Register::C>();
+        case 0xBA:
+            return op_res<7, Register::D>();
+        case 0xBB:
+            return op_res<7, Register::E>();
+        case 0xBC:
+            return op_res<7, Register::H>();
+        case 0xBD:
+            return op_res<7, Register::L>();
+        case 0xBE:
+            return op_res<7, Register::HL_ADDR>();
+        case 0xBF:
+            return op_res<7, Register::A>();
+
+        // 0xC0 - 0xCF
+        case 0xC0:
+            return op_set<0, Register::B>();
+        case 0xC1:
+            return op_set<0, Register::C>();
+        case 0xC2:
+            return op_set<0, Register::D>();
+        case 0xC3:
+            return op_set<0, Register::E>();
+        case 0xC4:
+            return op_set<0, Register::H>();
+        case 0xC5:
+            return op_set<0, Register::L>();
+        case 0xC6:
+            return op_set<0, Register::HL_ADDR>();
+        case 0xC7:
+            return op_set<0, Register::A>();
+        case 0xC8:
+            return op_set<1, Register::B>();
+        case 0xC9:
+            return op_set<1, Register::C>();
+        case 0xCA:
+            return op_set<1, Register::D>();
+        case 0xCB:
+            return op_set<1, Register::E>();
+        case 0xCC:
+            return op_set<1, Register::H>();
+        case 0xCD:
+            return op_set<1, Register::L>();
+        case 0xCE:
+            return op_set<1, Register::HL_ADDR>();
+        case 0xCF:
+            return op_set<1, Register::A>();
+
+        // 0xD0 - 0xDF
+        case 0xD0:
+            return op_set<2, Register::B>();
+        case 0xD1:
+            return op_set<2, Register::C>();
+        case 0xD2:
+            return op_set<2, Register::D>();
+        case 0xD3:
+            return op_set<2, Register::E>();
+        case 0xD4:
+            return op_set<2, Register::H>();
+        case 0xD5:
+            return op_set<2, Register::L>();
+        case 0xD6:
+            return op_set<2, Register::HL_ADDR>();
+        case 0xD7:
+            return op_set<2, Register::A>();
+        case 0xD8:
+            return op_set<3, Register::B>();
+        case 0xD9:
+            return op_set<3, Register::C>();
+        case 0xDA:
+            return op_set<3, Register::D>();
+        case 0xDB:
+            return op_set<3, Register::E>();
+        case 0xDC:
+            return op_set<3, Register::H>();
+        case 0xDD:
+            return op_set<3, Register::L>();
+        case 0xDE:
+            return op_set<3, Register::HL_ADDR>();
+        case 0xDF:
+            return op_set<3, Register::A>();
+
+        // 0xE0 - 0xEF
+        case 0xE0:
+            return op_set<4, Register::B>();
+        case 0xE1:
+            return op_set<4, Register::C>();
+        case 0xE2:
+            return op_set<4, Register::D>();
+        case 0xE3:
+            return op_set<4, Register::E>();
+        case 0xE4:
+            return op_set<4, Register::H>();
+        case 0xE5:
+            return op_set<4, Register::L>();
+        case 0xE6:
+            return op_set<4, Register::HL_ADDR>();
+        case 0xE7:
+            return op_set<4, Register::A>();
+        case 0xE8:
+            return op_set<5, Register::B>();
+        case 0xE9:
+            return op_set<5, Register::C>();
+        case 0xEA:
+            return op_set<5, Register::D>();
+        case 0xEB:
+            return op_set<5, Register::E>();
+        case 0xEC:
+            return op_set<5, Register::H>();
+        case 0xED:
+            return op_set<5, Register::L>();
+        case 0xEE:
+            return op_set<5, Register::HL_ADDR>();
+        case 0xEF:
+            return op_set<5, Register::A>();
+
+        // 0xF0 - 0xFF
+        case 0xF0:
+            return op_set<6, Register::B>();
+        case 0xF1:
+            return op_set<6, Register::C>();
+        case 0xF2:
+            return op_set<6, Register::D>();
+        case 0xF3:
+            return op_set<6, Register::E>();
+        case 0xF4:
+            return op_set<6, Register::H>();
+        case 0xF5:
+            return op_set<6, Register::L>();
+        case 0xF6:
+            return op_set<6, Register::HL_ADDR>();
+        case 0xF7:
+            return op_set<6, Register::A>();
+        case 0xF8:
+            return op_set<7, Register::B>();
+        case 0xF9:
+            return op_set<7, Register::C>();
+        case 0xFA:
+            return op_set<7, Register::D>();
+        case 0xFB:
+            return op_set<7, Register::E>();
+        case 0xFC:
+            return op_set<7, Register::H>();
+        case 0xFD:
+            return op_set<7, Register::L>();
+        case 0xFE:
+            return op_set<7, Register::HL_ADDR>();
+        case 0xFF:
+            return op_set<7, Register::A>();
+        }
+    }
+
+    /*
+        Handlers for the micro-ops decoded by BlockCache. They start with the tick of the opcode
+        fetch and tick for every operand byte at the point the interpreter fetches it, then leave
+        pc at the next instruction unless they jump. Profiling never runs micro-ops, so the calls
+        and returns don't report to the profiler.
+    */
+    struct MicroOps {
+        static void tick(SM83 &cpu, int32_t cycles = 4) { cpu.core->tick_subcomponents(cycles); }
+
+        static void nop(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.pc = op.next_pc;
+        }
+
+        // Anything without a handler of its own goes through the interpreter, which fetches the
+        // operands from the micro-op instead of the bus.
+        static void execute(SM83 &cpu, const MicroOp &op) {
+            cpu.instruction = &op;
+            cpu.execute(cpu.fetch(cpu.pc));
+            cpu.instruction = nullptr;
+        }
+
+        // For single byte instructions, the handler moves pc itself.
+        template <void (SM83::*handler)()> static void run(SM83 &cpu, const MicroOp &) {
+            tick(cpu);
+            (cpu.*handler)();
+        }
+
+        static void ld_r_r(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.registers[op.target] = cpu.registers[op.source];
+            cpu.pc = op.next_pc;
+        }
+
+        static void ld_r_u8(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            cpu.registers[op.target] = static_cast<uint8_t>(op.operand);
+            cpu.pc = op.next_pc;
+        }
+
+        static void ld_r_hl(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.registers[op.target] = cpu.read(cpu.get_rp<RegisterPair::HL>());
+            cpu.pc = op.next_pc;
+        }
+
+        static void ld_hl_r(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.write(cpu.get_rp<RegisterPair::HL>(), cpu.registers[op.source]);
+            cpu.pc = op.next_pc;
+        }
+
+        static void ld_hl_u8(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            cpu.write(cpu.get_rp<RegisterPair::HL>(), static_cast<uint8_t>(op.operand));
+            cpu.pc = op.next_pc;
+        }
+
+        template <AluOp alu> static void alu_r(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.alu<alu>(cpu.registers[op.source]);
+            cpu.pc = op.next_pc;
+        }
+
+        template <AluOp alu> static void alu_u8(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            cpu.alu<alu>(static_cast<uint8_t>(op.operand));
+            cpu.pc = op.next_pc;
+        }
+
+        template <AluOp alu> static void alu_hl(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.alu<alu>(cpu.read(cpu.get_rp<RegisterPair::HL>()));
+            cpu.pc = op.next_pc;
+        }
+
+        static void inc_r(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.registers[op.target] = cpu.alu_inc(cpu.registers[op.target]);
+            cpu.pc = op.next_pc;
+        }
+
+        static void dec_r(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.registers[op.target] = cpu.alu_dec(cpu.registers[op.target]);
+            cpu.pc = op.next_pc;
+        }
+
+        template <RegisterPair rp> static void ld_rp_u16(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            tick(cpu);
+            cpu.set_rp<rp>(op.operand);
+            cpu.pc = op.next_pc;
+        }
+
+        template <RegisterPair rp, int16_t displacement>
+        static void ld_rp_a(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            uint16_t address = cpu.get_rp<rp>();
+            cpu.write(address, cpu.GET_REG(Register::A));
+
+            if constexpr (displacement != 0) {
+                cpu.set_rp<rp>(address + displacement);
+            }
+            cpu.pc = op.next_pc;
+        }
+
+        template <RegisterPair rp, int16_t displacement>
+        static void ld_a_rp(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            uint16_t address = cpu.get_rp<rp>();
+            cpu.GET_REG(Register::A) = cpu.read(address);
+
+            if constexpr (displacement != 0) {
+                cpu.set_rp<rp>(address + displacement);
+            }
+            cpu.pc = op.next_pc;
+        }
+
+        static void ld_ff00_u8_a(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            cpu.write(0xFF00 + op.operand, cpu.GET_REG(Register::A));
+            cpu.pc = op.next_pc;
+        }
+
+        static void ld_a_ff00_u8(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            cpu.GET_REG(Register::A) = cpu.read(0xFF00 + op.operand);
+            cpu.pc = op.next_pc;
+        }
+
+        static void ld_u16_a(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            tick(cpu);
+            cpu.write(op.operand, cpu.GET_REG(Register::A));
+            cpu.pc = op.next_pc;
+        }
+
+        static void ld_a_u16(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            tick(cpu);
+            cpu.GET_REG(Register::A) = cpu.read(op.operand);
+            cpu.pc = op.next_pc;
+        }
+
+        // The operand of relative jumps is already the target.
+        static void jr(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            tick(cpu);
+            cpu.pc = op.operand;
+        }
+
+        template <uint8_t cc, bool boolean_ver> static void jr_cc(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+
+            if (cpu.get_flag(cc) == boolean_ver) {
+                tick(cpu);
+                tick(cpu);
+                cpu.pc = op.operand;
+                return;
+            }
+
+            tick(cpu);
+            cpu.pc = op.next_pc;
+        }
+
+        static void jp(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            tick(cpu);
+            tick(cpu);
+            cpu.pc = op.operand;
+        }
+
+        template <uint8_t cc, bool boolean_ver> static void jp_cc(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+
+            if (cpu.get_flag(cc) == boolean_ver) {
+                tick(cpu);
+                tick(cpu);
+                tick(cpu);
+                cpu.pc = op.operand;
+                return;
+            }
+
+            tick(cpu, 8);
+            cpu.pc = op.next_pc;
+        }
+
+        static void call(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            tick(cpu);
+            tick(cpu);
+            cpu.push_sp(op.next_pc);
+            cpu.pc = op.operand;
+        }
+
+        template <uint8_t cc, bool boolean_ver> static void call_cc(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+
+            if (cpu.get_flag(cc) == boolean_ver) {
+                tick(cpu);
+                tick(cpu);
+                tick(cpu);
+                cpu.push_sp(op.next_pc);
+                cpu.pc = op.operand;
+                return;
+            }
+
+            tick(cpu, 8);
+            cpu.pc = op.next_pc;
+        }
+
+        static void ret(SM83 &cpu, const MicroOp &) {
+            tick(cpu);
+            cpu.pc = cpu.pop_sp();
+            tick(cpu);
+        }
+
+        template <uint8_t cc, bool boolean_ver> static void ret_cc(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+
+            if (cpu.get_flag(cc) == boolean_ver) {
+                cpu.pc = cpu.pop_sp();
+                tick(cpu);
+                return;
+            }
+
+            cpu.pc = op.next_pc;
+        }
+
+        template <RegisterPair rp> static void push(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            tick(cpu);
+            cpu.push_sp(cpu.get_rp<rp>());
+            cpu.pc = op.next_pc;
+        }
+
+        template <RegisterPair rp> static void pop(SM83 &cpu, const MicroOp &op) {
+            tick(cpu);
+            cpu.set_rp<rp>(cpu.pop_sp());
+            cpu.pc = op.next_pc;
+        }
+
+        // The low three bits of a prefixed opcode select the register, the rest the operation.
+        template <uint8_t opcode> static void cb(SM83 &cpu, const MicroOp &op) {
+            constexpr auto r = static_cast<Register>(opcode & 0x7);
+            constexpr uint8_t bit = (opcode >> 3) & 0x7;
+
+            tick(cpu);
+            tick(cpu);
+
+            if constexpr (opcode >= 0xC0) {
+                cpu.op_set<bit, r>();
+            } else if constexpr (opcode >= 0x80) {
+                cpu.op_res<bit, r>();
+            } else if constexpr (opcode >= 0x40) {
+                cpu.op_bit<bit, r>();
+            } else if constexpr (bit == 0) {
+                cpu.op_rlc<r>();
+            } else if constexpr (bit == 1) {
+                cpu.op_rrc<r>();
+            } else if constexpr (bit == 2) {
+                cpu.op_rl<r>();
+            } else if constexpr (bit == 3) {
+                cpu.op_rr<r>();
+            } else if constexpr (bit == 4) {
+                cpu.op_sla<r>();
+            } else if constexpr (bit == 5) {
+                cpu.op_sra<r>();
+            } else if constexpr (bit == 6) {
+                cpu.op_swap<r>();
+            } else {
+                cpu.op_srl<r>();
+            }
+
+            cpu.pc = op.next_pc;
+        }
+    };
+
+    static constexpr std::array<MicroOpHandler, 8> ALU_R_MICRO_OPS = {
+        &MicroOps::alu_r<AluOp::Add>, &MicroOps::alu_r<AluOp::Adc>, &MicroOps::alu_r<AluOp::Sub>,
+        &MicroOps::alu_r<AluOp::Sbc>, &MicroOps::alu_r<AluOp::And>, &MicroOps::alu_r<AluOp::Xor>,
+        &MicroOps::alu_r<AluOp::Or>,  &MicroOps::alu_r<AluOp::Cp>,
+    };
+
+    static constexpr std::array<MicroOpHandler, 8> ALU_U8_MICRO_OPS = {
+        &MicroOps::alu_u8<AluOp::Add>, &MicroOps::alu_u8<AluOp::Adc>,
+        &MicroOps::alu_u8<AluOp::Sub>, &MicroOps::alu_u8<AluOp::Sbc>,
+        &MicroOps::alu_u8<AluOp::And>, &MicroOps::alu_u8<AluOp::Xor>,
+        &MicroOps::alu_u8<AluOp::Or>,  &MicroOps::alu_u8<AluOp::Cp>,
+    };
+
+    static constexpr std::array<MicroOpHandler, 8> ALU_HL_MICRO_OPS = {
+        &MicroOps::alu_hl<AluOp::Add>, &MicroOps::alu_hl<AluOp::Adc>,
+        &MicroOps::alu_hl<AluOp::Sub>, &MicroOps::alu_hl<AluOp::Sbc>,
+        &MicroOps::alu_hl<AluOp::And>, &MicroOps::alu_hl<AluOp::Xor>,
+        &MicroOps::alu_hl<AluOp::Or>,  &MicroOps::alu_hl<AluOp::Cp>,
+    };
+
+    template <size_t... opcodes>
+    static constexpr std::array<MicroOpHandler, 256> cb_micro_ops(std::index_sequence<opcodes...>) {
+        return {&MicroOps::cb<static_cast<uint8_t>(opcodes)>...};
     }
 
-    std::array<SM83::opcode_function, 256> SM83::gen_cb_optable() {
-        return std::array<SM83::opcode_function, 256>{
-            // 0x00 - 0x0F
-            &SM83::op_rlc<Register::B>,
-            &SM83::op_rlc<Register::C>,
-            &SM83::op_rlc<Register::D>,
-            &SM83::op_rlc<Register::E>,
-            &SM83::op_rlc<Register::H>,
-            &SM83::op_rlc<Register::L>,
-            &SM83::op_rlc<Register::HL_ADDR>,
-            &SM83::op_rlc<Register::A>,
-
-            &SM83::op_rrc<Register::B>,
-            &SM83::op_rrc<Register::C>,
-            &SM83::op_rrc<Register::D>,
-            &SM83::op_rrc<Register::E>,
-            &SM83::op_rrc<Register::H>,
-            &SM83::op_rrc<Register::L>,
-            &SM83::op_rrc<Register::HL_ADDR>,
-            &SM83::op_rrc<Register::A>,
-
-            // 0x10 - 0x1F
-            &SM83::op_rl<Register::B>,
-            &SM83::op_rl<Register::C>,
-            &SM83::op_rl<Register::D>,
-            &SM83::op_rl<Register::E>,
-            &SM83::op_rl<Register::H>,
-            &SM83::op_rl<Register::L>,
-            &SM83::op_rl<Register::HL_ADDR>,
-            &SM83::op_rl<Register::A>,
-
-            &SM83::op_rr<Register::B>,
-            &SM83::op_rr<Register::C>,
-            &SM83::op_rr<Register::D>,
-            &SM83::op_rr<Register::E>,
-            &SM83::op_rr<Register::H>,
-            &SM83::op_rr<Register::L>,
-            &SM83::op_rr<Register::HL_ADDR>,
-            &SM83::op_rr<Register::A>,
-
-            // 0x20 - 0x2F
-            &SM83::op_sla<Register::B>,
-            &SM83::op_sla<Register::C>,
-            &SM83::op_sla<Register::D>,
-            &SM83::op_sla<Register::E>,
-            &SM83::op_sla<Register::H>,
-            &SM83::op_sla<Register::L>,
-            &SM83::op_sla<Register::HL_ADDR>,
-            &SM83::op_sla<Register::A>,
-
-            &SM83::op_sra<Register::B>,
-            &SM83::op_sra<Register::C>,
-            &SM83::op_sra<Register::D>,
-            &SM83::op_sra<Register::E>,
-            &SM83::op_sra<Register::H>,
-            &SM83::op_sra<Register::L>,
-            &SM83::op_sra<Register::HL_ADDR>,
-            &SM83::op_sra<Register::A>,
-
-            // 0x30 - 0x3F
-            &SM83::op_swap<Register::B>,
-            &SM83::op_swap<Register::C>,
-            &SM83::op_swap<Register::D>,
-            &SM83::op_swap<Register::E>,
-            &SM83::op_swap<Register::H>,
-            &SM83::op_swap<Register::L>,
-            &SM83::op_swap<Register::HL_ADDR>,
-            &SM83::op_swap<Register::A>,
-
-            &SM83::op_srl<Register::B>,
-            &SM83::op_srl<Register::C>,
-            &SM83::op_srl<Register::D>,
-            &SM83::op_srl<Register::E>,
-            &SM83::op_srl<Register::H>,
-            &SM83::op_srl<Register::L>,
-            &SM83::op_srl<Register::HL_ADDR>,
-            &SM83::op_srl<Register::A>,
-
-            // 0x40 - 0x4F
-            &SM83::op_bit<0, Register::B>,
-            &SM83::op_bit<0, Register::C>,
-            &SM83::op_bit<0, Register::D>,
-            &SM83::op_bit<0, Register::E>,
-            &SM83::op_bit<0, Register::H>,
-            &SM83::op_bit<0, Register::L>,
-            &SM83::op_bit<0, Register::HL_ADDR>,
-            &SM83::op_bit<0, Register::A>,
-
-            &SM83::op_bit<1, Register::B>,
-            &SM83::op_bit<1, Register::C>,
-            &SM83::op_bit<1, Register::D>,
-            &SM83::op_bit<1, Register::E>,
-            &SM83::op_bit<1, Register::H>,
-            &SM83::op_bit<1, Register::L>,
-            &SM83::op_bit<1, Register::HL_ADDR>,
-            &SM83::op_bit<1, Register::A>,
-
-            // 0x50 - 0x5F
-            &SM83::op_bit<2, Register::B>,
-            &SM83::op_bit<2, Register::C>,
-            &SM83::op_bit<2, Register::D>,
-            &SM83::op_bit<2, Register::E>,
-            &SM83::op_bit<2, Register::H>,
-            &SM83::op_bit<2, Register::L>,
-            &SM83::op_bit<2, Register::HL_ADDR>,
-            &SM83::op_bit<2, Register::A>,
-
-            &SM83::op_bit<3, Register::B>,
-            &SM83::op_bit<3, Register::C>,
-            &SM83::op_bit<3, Register::D>,
-            &SM83::op_bit<3, Register::E>,
-            &SM83::op_bit<3, Register::H>,
-            &SM83::op_bit<3, Register::L>,
-            &SM83::op_bit<3, Register::HL_ADDR>,
-            &SM83::op_bit<3, Register::A>,
-
-            // 0x60 - 0x6F
-            &SM83::op_bit<4, Register::B>,
-            &SM83::op_bit<4, Register::C>,
-            &SM83::op_bit<4, Register::D>,
-            &SM83::op_bit<4, Register::E>,
-            &SM83::op_bit<4, Register::H>,
-            &SM83::op_bit<4, Register::L>,
-            &SM83::op_bit<4, Register::HL_ADDR>,
-            &SM83::op_bit<4, Register::A>,
-
-            &SM83::op_bit<5, Register::B>,
-            &SM83::op_bit<5, Register::C>,
-            &SM83::op_bit<5, Register::D>,
-            &SM83::op_bit<5, Register::E>,
-            &SM83::op_bit<5, Register::H>,
-            &SM83::op_bit<5, Register::L>,
-            &SM83::op_bit<5, Register::HL_ADDR>,
-            &SM83::op_bit<5, Register::A>,
-
-            // 0x70 - 0x7F
-            &SM83::op_bit<6, Register::B>,
-            &SM83::op_bit<6, Register::C>,
-            &SM83::op_bit<6, Register::D>,
-            &SM83::op_bit<6, Register::E>,
-            &SM83::op_bit<6, Register::H>,
-            &SM83::op_bit<6, Register::L>,
-            &SM83::op_bit<6, Register::HL_ADDR>,
-            &SM83::op_bit<6, Register::A>,
-
-            &SM83::op_bit<7, Register::B>,
-            &SM83::op_bit<7, Register::C>,
-            &SM83::op_bit<7, Register::D>,
-            &SM83::op_bit<7, Register::E>,
-            &SM83::op_bit<7, Register::H>,
-            &SM83::op_bit<7, Register::L>,
-            &SM83::op_bit<7, Register::HL_ADDR>,
-            &SM83::op_bit<7, Register::A>,
-
-            // 0x80 - 0x8F
-            &SM83::op_res<0, Register::B>,
-            &SM83::op_res<0, Register::C>,
-            &SM83::op_res<0, Register::D>,
-            &SM83::op_res<0, Register::E>,
-            &SM83::op_res<0, Register::H>,
-            &SM83::op_res<0, Register::L>,
-            &SM83::op_res<0, Register::HL_ADDR>,
-            &SM83::op_res<0, Register::A>,
-
-            &SM83::op_res<1, Register::B>,
-            &SM83::op_res<1, Register::C>,
-            &SM83::op_res<1, Register::D>,
-            &SM83::op_res<1, Register::E>,
-            &SM83::op_res<1, Register::H>,
-            &SM83::op_res<1, Register::L>,
-            &SM83::op_res<1, Register::HL_ADDR>,
-            &SM83::op_res<1, Register::A>,
-
-            // 0x90 - 0x9F
-            &SM83::op_res<2, Register::B>,
-            &SM83::op_res<2, Register::C>,
-            &SM83::op_res<2, Register::D>,
-            &SM83::op_res<2, Register::E>,
-            &SM83::op_res<2, Register::H>,
-            &SM83::op_res<2, Register::L>,
-            &SM83::op_res<2, Register::HL_ADDR>,
-            &SM83::op_res<2, Register::A>,
-
-            &SM83::op_res<3, Register::B>,
-            &SM83::op_res<3, Register::C>,
-            &SM83::op_res<3, Register::D>,
-            &SM83::op_res<3, Register::E>,
-            &SM83::op_res<3, Register::H>,
-            &SM83::op_res<3, Register::L>,
-            &SM83::op_res<3, Register::HL_ADDR>,
-            &SM83::op_res<3, Register::A>,
-
-            // 0xA0 - 0xAF
-            &SM83::op_res<4, Register::B>,
-            &SM83::op_res<4, Register::C>,
-            &SM83::op_res<4, Register::D>,
-            &SM83::op_res<4, Register::E>,
-            &SM83::op_res<4, Register::H>,
-            &SM83::op_res<4, Register::L>,
-            &SM83::op_res<4, Register::HL_ADDR>,
-            &SM83::op_res<4, Register::A>,
-
-            &SM83::op_res<5, Register::B>,
-            &SM83::op_res<5, Register::C>,
-            &SM83::op_res<5, Register::D>,
-            &SM83::op_res<5, Register::E>,
-            &SM83::op_res<5, Register::H>,
-            &SM83::op_res<5, Register::L>,
-            &SM83::op_res<5, Register::HL_ADDR>,
-            &SM83::op_res<5, Register::A>,
-
-            // 0xB0 - 0xBF
-            &SM83::op_res<6, Register::B>,
-            &SM83::op_res<6, Register::C>,
-            &SM83::op_res<6, Register::D>,
-            &SM83::op_res<6, Register::E>,
-            &SM83::op_res<6, Register::H>,
-            &SM83::op_res<6, Register::L>,
-            &SM83::op_res<6, Register::HL_ADDR>,
-            &SM83::op_res<6, Register::A>,
-
-            &SM83::op_res<7, Register::B>,
-            &SM83::op_res<7, Register::C>,
-            &SM83::op_res<7, Register::D>,
-            &SM83::op_res<7, Register::E>,
-            &SM83::op_res<7, Register::H>,
-            &SM83::op_res<7, Register::L>,
-            &SM83::op_res<7, Register::HL_ADDR>,
-            &SM83::op_res<7, Register::A>,
-
-            // 0xC0 - 0xCF
-            &SM83::op_set<0, Register::B>,
-            &SM83::op_set<0, Register::C>,
-            &SM83::op_set<0, Register::D>,
-            &SM83::op_set<0, Register::E>,
-            &SM83::op_set<0, Register::H>,
-            &SM83::op_set<0, Register::L>,
-            &SM83::op_set<0, Register::HL_ADDR>,
-            &SM83::op_set<0, Register::A>,
-
-            &SM83::op_set<1, Register::B>,
-            &SM83::op_set<1, Register::C>,
-            &SM83::op_set<1, Register::D>,
-            &SM83::op_set<1, Register::E>,
-            &SM83::op_set<1, Register::H>,
-            &SM83::op_set<1, Register::L>,
-            &SM83::op_set<1, Register::HL_ADDR>,
-            &SM83::op_set<1, Register::A>,
-
-            // 0xD0 - 0xDF
-            &SM83::op_set<2, Register::B>,
-            &SM83::op_set<2, Register::C>,
-            &SM83::op_set<2, Register::D>,
-            &SM83::op_set<2, Register::E>,
-            &SM83::op_set<2, Register::H>,
-            &SM83::op_set<2, Register::L>,
-            &SM83::op_set<2, Register::HL_ADDR>,
-            &SM83::op_set<2, Register::A>,
-
-            &SM83::op_set<3, Register::B>,
-            &SM83::op_set<3, Register::C>,
-            &SM83::op_set<3, Register::D>,
-            &SM83::op_set<3, Register::E>,
-            &SM83::op_set<3, Register::H>,
-            &SM83::op_set<3, Register::L>,
-            &SM83::op_set<3, Register::HL_ADDR>,
-            &SM83::op_set<3, Register::A>,
-
-            // 0xE0 - 0xEF
-            &SM83::op_set<4, Register::B>,
-            &SM83::op_set<4, Register::C>,
-            &SM83::op_set<4, Register::D>,
-            &SM83::op_set<4, Register::E>,
-            &SM83::op_set<4, Register::H>,
-            &SM83::op_set<4, Register::L>,
-            &SM83::op_set<4, Register::HL_ADDR>,
-            &SM83::op_set<4, Register::A>,
-
-            &SM83::op_set<5, Register::B>,
-            &SM83::op_set<5, Register::C>,
-            &SM83::op_set<5, Register::D>,
-            &SM83::op_set<5, Register::E>,
-            &SM83::op_set<5, Register::H>,
-            &SM83::op_set<5, Register::L>,
-            &SM83::op_set<5, Register::HL_ADDR>,
-            &SM83::op_set<5, Register::A>,
-
-            // 0xF0 - 0xFF
-            &SM83::op_set<6, Register::B>,
-            &SM83::op_set<6, Register::C>,
-            &SM83::op_set<6, Register::D>,
-            &SM83::op_set<6, Register::E>,
-            &SM83::op_set<6, Register::H>,
-            &SM83::op_set<6, Register::L>,
-            &SM83::op_set<6, Register::HL_ADDR>,
-            &SM83::op_set<6, Register::A>,
-
-            &SM83::op_set<7, Register::B>,
-            &SM83::op_set<7, Register::C>,
-            &SM83::op_set<7, Register::D>,
-            &SM83::op_set<7, Register::E>,
-            &SM83::op_set<7, Register::H>,
-            &SM83::op_set<7, Register::L>,
-            &SM83::op_set<7, Register::HL_ADDR>,
-            &SM83::op_set<7, Register::A>,
+    static constexpr auto CB_MICRO_OPS = cb_micro_ops(std::make_index_sequence<256>{});
+
+    void SM83::decode_micro_op(MicroOp &op) {
+        constexpr int16_t NoDisplacement = 0;
+        constexpr int16_t Increment = 1;
+        constexpr int16_t Decrement = -1;
+
+        // Bits 3-5 and 0-2 select the register of most opcodes, in the order of Register.
+        uint8_t y = (op.opcode >> 3) & 0x7;
+        uint8_t z = op.opcode & 0x7;
+        auto offset = [](uint8_t index) {
+            return static_cast<uint8_t>(register_offset(static_cast<Register>(index)));
         };
-    }
 
+        op.handler = &MicroOps::execute;
+
+        if (op.opcode >= 0x40 && op.opcode < 0x80) {
+            // 0x76 is HALT
+            if (y == 6 && z == 6) {
+                return;
+            }
+
+            op.target = offset(y);
+            op.source = offset(z);
+            op.handler = (y == 6)   ? &MicroOps::ld_hl_r
+                         : (z == 6) ? &MicroOps::ld_r_hl
+                                    : &MicroOps::ld_r_r;
+            return;
+        }
+
+        if (op.opcode >= 0x80 && op.opcode < 0xC0) {
+            op.source = offset(z);
+            op.handler = (z == 6) ? ALU_HL_MICRO_OPS[y] : ALU_R_MICRO_OPS[y];
+            return;
+        }
+
+        if (op.opcode < 0x40 && z >= 4 && z <= 6) {
+            op.target = offset(y);
+
+            if (z == 4) {
+                op.handler = (y == 6) ? &MicroOps::run<&SM83::op_inc_r<Register::HL_ADDR>>
+                                      : &MicroOps::inc_r;
+            } else if (z == 5) {
+                op.handler = (y == 6) ? &MicroOps::run<&SM83::op_dec_r<Register::HL_ADDR>>
+                                      : &MicroOps::dec_r;
+            } else {
+                op.handler = (y == 6) ? &MicroOps::ld_hl_u8 : &MicroOps::ld_r_u8;
+            }
+            return;
+        }
+
+        if (op.opcode >= 0xC0 && z == 6) {
+            op.handler = ALU_U8_MICRO_OPS[y];
+            return;
+        }
+
+        switch (op.opcode) {
+        case 0x00:
+            op.handler = &MicroOps::nop;
+            break;
+        case 0x01:
+            op.handler = &MicroOps::ld_rp_u16<RegisterPair::BC>;
+            break;
+        case 0x11:
+            op.handler = &MicroOps::ld_rp_u16<RegisterPair::DE>;
+            break;
+        case 0x21:
+            op.handler = &MicroOps::ld_rp_u16<RegisterPair::HL>;
+            break;
+        case 0x31:
+            op.handler = &MicroOps::ld_rp_u16<RegisterPair::SP>;
+            break;
+        case 0x02:
+            op.handler = &MicroOps::ld_rp_a<RegisterPair::BC, NoDisplacement>;
+            break;
+        case 0x12:
+            op.handler = &MicroOps::ld_rp_a<RegisterPair::DE, NoDisplacement>;
+            break;
+        case 0x22:
+            op.handler = &MicroOps::ld_rp_a<RegisterPair::HL, Increment>;
+            break;
+        case 0x32:
+            op.handler = &MicroOps::ld_rp_a<RegisterPair::HL, Decrement>;
+            break;
+        case 0x0A:
+            op.handler = &MicroOps::ld_a_rp<RegisterPair::BC, NoDisplacement>;
+            break;
+        case 0x1A:
+            op.handler = &MicroOps::ld_a_rp<RegisterPair::DE, NoDisplacement>;
+            break;
+        case 0x2A:
+            op.handler = &MicroOps::ld_a_rp<RegisterPair::HL, Increment>;
+            break;
+        case 0x3A:
+            op.handler = &MicroOps::ld_a_rp<RegisterPair::HL, Decrement>;
+            break;
+        case 0x03:
+            op.handler = &MicroOps::run<&SM83::op_inc_rp<RegisterPair::BC>>;
+            break;
+        case 0x13:
+            op.handler = &MicroOps::run<&SM83::op_inc_rp<RegisterPair::DE>>;
+            break;
+        case 0x23:
+            op.handler = &MicroOps::run<&SM83::op_inc_rp<RegisterPair::HL>>;
+            break;
+        case 0x33:
+            op.handler = &MicroOps::run<&SM83::op_inc_rp<RegisterPair::SP>>;
+            break;
+        case 0x0B:
+            op.handler = &MicroOps::run<&SM83::op_dec_rp<RegisterPair::BC>>;
+            break;
+        case 0x1B:
+            op.handler = &MicroOps::run<&SM83::op_dec_rp<RegisterPair::DE>>;
+            break;
+        case 0x2B:
+            op.handler = &MicroOps::run<&SM83::op_dec_rp<RegisterPair::HL>>;
+            break;
+        case 0x3B:
+            op.handler = &MicroOps::run<&SM83::op_dec_rp<RegisterPair::SP>>;
+            break;
+        case 0x09:
+            op.handler = &MicroOps::run<&SM83::op_add_hl_rp<RegisterPair::BC>>;
+            break;
+        case 0x19:
+            op.handler = &MicroOps::run<&SM83::op_add_hl_rp<RegisterPair::DE>>;
+            break;
+        case 0x29:
+            op.handler = &MicroOps::run<&SM83::op_add_hl_rp<RegisterPair::HL>>;
+            break;
+        case 0x39:
+            op.handler = &MicroOps::run<&SM83::op_add_hl_rp<RegisterPair::SP>>;
+            break;
+        case 0x07:
+            op.handler = &MicroOps::run<&SM83::op_rlca>;
+            break;
+        case 0x0F:
+            op.handler = &MicroOps::run<&SM83::op_rrca>;
+            break;
+        case 0x17:
+            op.handler = &MicroOps::run<&SM83::op_rla>;
+            break;
+        case 0x1F:
+            op.handler = &MicroOps::run<&SM83::op_rra>;
+            break;
+        case 0x27:
+            op.handler = &MicroOps::run<&SM83::op_daa>;
+            break;
+        case 0x2F:
+            op.handler = &MicroOps::run<&SM83::op_cpl>;
+            break;
+        case 0x37:
+            op.handler = &MicroOps::run<&SM83::op_scf>;
+            break;
+        case 0x3F:
+            op.handler = &MicroOps::run<&SM83::op_ccf>;
+            break;
+        case 0x18:
+            op.handler = &MicroOps::jr;
+            break;
+        case 0x20:
+            op.handler = &MicroOps::jr_cc<FLAG_Z, false>;
+            break;
+        case 0x28:
+            op.handler = &MicroOps::jr_cc<FLAG_Z, true>;
+            break;
+        case 0x30:
+            op.handler = &MicroOps::jr_cc<FLAG_CY, false>;
+            break;
+        case 0x38:
+            op.handler = &MicroOps::jr_cc<FLAG_CY, true>;
+            break;
+        case 0xC3:
+            op.handler = &MicroOps::jp;
+            break;
+        case 0xC2:
+            op.handler = &MicroOps::jp_cc<FLAG_Z, false>;
+            break;
+        case 0xCA:
+            op.handler = &MicroOps::jp_cc<FLAG_Z, true>;
+            break;
+        case 0xD2:
+            op.handler = &MicroOps::jp_cc<FLAG_CY, false>;
+            break;
+        case 0xDA:
+            op.handler = &MicroOps::jp_cc<FLAG_CY, true>;
+            break;
+        case 0xE9:
+            op.handler = &MicroOps::run<&SM83::op_jp_hl>;
+            break;
+        case 0xCD:
+            op.handler = &MicroOps::call;
+            break;
+        case 0xC4:
+            op.handler = &MicroOps::call_cc<FLAG_Z, false>;
+            break;
+        case 0xCC:
+            op.handler = &MicroOps::call_cc<FLAG_Z, true>;
+            break;
+        case 0xD4:
+            op.handler = &MicroOps::call_cc<FLAG_CY, false>;
+            break;
+        case 0xDC:
+            op.handler = &MicroOps::call_cc<FLAG_CY, true>;
+            break;
+        case 0xC9:
+            op.handler = &MicroOps::ret;
+            break;
+        case 0xC0:
+            op.handler = &MicroOps::ret_cc<FLAG_Z, false>;
+            break;
+        case 0xC8:
+            op.handler = &MicroOps::ret_cc<FLAG_Z, true>;
+            break;
+        case 0xD0:
+            op.handler = &MicroOps::ret_cc<FLAG_CY, false>;
+            break;
+        case 0xD8:
+            op.handler = &MicroOps::ret_cc<FLAG_CY, true>;
+            break;
+        case 0xC5:
+            op.handler = &MicroOps::push<RegisterPair::BC>;
+            break;
+        case 0xD5:
+            op.handler = &MicroOps::push<RegisterPair::DE>;
+            break;
+        case 0xE5:
+            op.handler = &MicroOps::push<RegisterPair::HL>;
+            break;
+        case 0xF5:
+            op.handler = &MicroOps::push<RegisterPair::AF>;
+            break;
+        case 0xC1:
+            op.handler = &MicroOps::pop<RegisterPair::BC>;
+            break;
+        case 0xD1:
+            op.handler = &MicroOps::pop<RegisterPair::DE>;
+            break;
+        case 0xE1:
+            op.handler = &MicroOps::pop<RegisterPair::HL>;
+            break;
+        case 0xF1:
+            op.handler = &MicroOps::pop<RegisterPair::AF>;
+            break;
+        case 0xE0:
+            op.handler = &MicroOps::ld_ff00_u8_a;
+            break;
+        case 0xF0:
+            op.handler = &MicroOps::ld_a_ff00_u8;
+            break;
+        case 0xE2:
+            op.handler = &MicroOps::run<&SM83::op_ld_ff00_c_a>;
+            break;
+        case 0xF2:
+            op.handler = &MicroOps::run<&SM83::op_ld_a_ff00_c>;
+            break;
+        case 0xEA:
+            op.handler = &MicroOps::ld_u16_a;
+            break;
+        case 0xFA:
+            op.handler = &MicroOps::ld_a_u16;
+            break;
+        case 0xF3:
+            op.handler = &MicroOps::run<&SM83::op_di>;
+            break;
+        case 0xF9:
+            op.handler = &MicroOps::run<&SM83::op_ld_sp_hl>;
+            break;
+        case 0xCB:
+            op.handler = CB_MICRO_OPS[op.operand];
+            break;
+        default:
+            break;
+        }
+    }
 }
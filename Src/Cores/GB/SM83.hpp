@@ -17,11 +17,17 @@
 */
 
 #pragma once
+#include "BlockCache.hpp"
+#include "IdleLoopCache.hpp"
+#include "Profiler.hpp"
+#include "Recompiler.hpp"
 #include <array>
 #include <cinttypes>
+#include <memory>
 
 namespace GB {
     class Core;
+    class StateArchive;
 
     enum class Register {
         B = 0,
@@ -44,36 +50,120 @@ namespace GB {
         AF,
     };
 
+    // In the order of the ALU opcodes 0x80-0xBF.
+    enum class AluOp {
+        Add,
+        Adc,
+        Sub,
+        Sbc,
+        And,
+        Xor,
+        Or,
+        Cp,
+    };
+
     constexpr uint8_t FLAG_Z = 128;
     constexpr uint8_t FLAG_N = 64;
     constexpr uint8_t FLAG_HC = 32;
     constexpr uint8_t FLAG_CY = 16;
 
+    // CPU state at the start of an idle loop iteration, with F packed into registers.
+    struct IdleLoopProbe {
+        bool valid = false;
+        uint64_t timestamp = 0;
+        uint64_t stable_until = 0;
+        uint64_t deadline = 0;
+        uint64_t instructions = 0;
+        std::array<uint8_t, 8> registers{};
+    };
+
     class SM83 {
     public:
         SM83(Core *core);
 
         bool stopped() const;
         bool double_speed() const;
+        uint16_t program_counter() const;
+        uint64_t instruction_count() const;
+
+        // Runs code from ROM as micro-ops decoded by BlockCache, the result is identical either way.
+        void set_cached_interpreter(bool enabled);
+
+        // Picks the handler and register operands of op, its opcode and operand have to be set.
+        static void decode_micro_op(MicroOp &op);
+
+        // Returns false when the recompiler isn't supported on this platform.
+        bool set_recompiler(bool enabled);
+        const Recompiler *recompiler() const;
+
+        /*
+            Runs the compiled block at pc, or its micro-ops with the cached interpreter, stopping
+            after the instruction that reaches deadline, requests an interrupt or writes to anything
+            but RAM. Returns false without running anything when the next instruction has to go
+            through step().
+        */
+        bool run_block(uint64_t deadline);
+
+        /*
+            Once an iteration of an idle loop has left the CPU unchanged, the following ones are
+            skipped in one go up to the last dot before an event is due, the mode in STAT changes
+            or deadline is reached. Nothing the loop reads can change before then, so the result
+            is identical either way.
+        */
+        void set_idle_loop_skipping(bool enabled);
+        IdleLoopCache &idle_loop_cache();
+        uint64_t idle_cycles_skipped() const;
+
+        // Called at every instruction boundary of a run, only backward jumps are looked up.
+        void skip_idle_loop(uint64_t deadline);
+
+        /*
+            Counts every instruction in the profiler while enabled. Profiling runs all code through
+            the interpreter, so the cached interpreter, the recompiler and idle loop skipping are
+            bypassed until it is disabled again, which discards the profile.
+        */
+        void set_profiling(bool enabled);
+        Profiler *profiler();
 
         void reset(uint16_t new_pc);
         void request_interrupt(uint8_t interrupt);
+        void exit_stop_mode();
         void step();
+        void serialize(StateArchive &archive);
 
     private:
         void service_interrupts();
+        void skip_idle_iterations(uint64_t deadline);
+        uint64_t idle_loop_stable_until(const IdleLoop &loop) const;
+        uint32_t profile_location(uint16_t address) const;
 
         uint8_t read(uint16_t address);
         uint16_t read_uint16(uint16_t address);
+        uint8_t fetch(uint16_t address);
+        uint16_t fetch_uint16(uint16_t address);
+        void run_micro_ops(const CodeBlock &block);
         void write(uint16_t address, uint8_t value);
         void write_uint16(uint16_t address, uint16_t value);
 
+        // Called from compiled code.
+        RecompilerBindings recompiler_bindings();
+        static uint8_t compiled_read(SM83 *cpu, uint16_t address);
+        static void compiled_write(SM83 *cpu, uint16_t address, uint8_t value);
+        static void compiled_events(SM83 *cpu);
+
         void push_sp(uint16_t value);
         uint16_t pop_sp();
-        void set_flags(uint8_t flags, bool set);
+        uint8_t pack_flags() const;
+        void unpack_flags(uint8_t flags);
         bool get_flag(uint8_t flag) const;
-        uint16_t get_rp(RegisterPair index) const;
-        void set_rp(RegisterPair index, uint16_t value);
+        void set_rotate_flags(bool carry, uint8_t result);
+        void set_sp_offset_flags(uint16_t sp_value, int16_t offset);
+        template <RegisterPair rp> uint16_t get_rp() const;
+        template <RegisterPair rp> void set_rp(uint16_t value);
+        template <AluOp op> void alu(uint8_t right);
+        uint8_t alu_inc(uint8_t value);
+        uint8_t alu_dec(uint8_t value);
+        template <Register r> uint8_t alu_operand();
 
         void op_ld_u16_sp();
         void op_stop();
@@ -147,28 +237,78 @@ namespace GB {
         template <uint8_t bit, Register r> void op_res();
         template <uint8_t bit, Register r> void op_set();
 
-        using opcode_function = void (SM83::*)();
-        static std::array<SM83::opcode_function, 256> gen_optable();
-        static std::array<SM83::opcode_function, 256> gen_cb_optable();
+        /*
+            Dispatch is a switch so the compiler can build a jump table and inline the handlers
+            into it, instead of calling every instruction through a member function pointer.
+        */
+        void execute(uint8_t opcode);
+        void execute_cb(uint8_t opcode);
 
         bool master_interrupt_enable_ = true;
         bool halted_ = false;
         bool ei_delay_ = false;
         bool stopped_ = false;
+        bool locked_ = false;
         bool double_speed_ = false;
 
         uint8_t interrupt_flag = 0, interrupt_enable = 0;
         uint8_t KEY1 = 0;
 
         uint16_t sp = 0xFFFF, pc = 0;
-        std::array<uint8_t, 8> registers{};
 
-        std::array<opcode_function, 256> opcodes;
-        std::array<opcode_function, 256> cb_opcodes;
+        /*
+            Registers are stored as the pairs BC, DE, HL and AF in host byte order so a pair can be
+            loaded or stored as one 16-bit value, GET_REG maps a single register to its byte.
+        */
+        alignas(uint16_t) std::array<uint8_t, 8> registers{};
+
+        /*
+            Flags are evaluated lazily, instructions only store what they are derived from and F is
+            put together when something reads it. Z is set when the low byte of flag_result is 0,
+            C is bit 8 of flag_result and H is bit 4 of flag_half, which holds operand ^ operand ^
+            result for additions and subtractions.
+        */
+        uint16_t flag_result = 0;
+        uint16_t flag_half = 0;
+        bool flag_n = false;
+
+        uint64_t instructions_executed = 0;
+
+        bool cached_interpreter = false;
+        BlockCache block_cache;
+        const MicroOp *instruction = nullptr;
+
+        std::unique_ptr<Recompiler> compiler;
+        uint64_t block_deadline = 0;
+        uint64_t instruction_timestamp = 0;
+        bool block_exit = false;
+
+        bool idle_loop_skipping = false;
+        IdleLoopCache idle_loops;
+        const IdleLoop *idle_loop = nullptr;
+        uint16_t idle_loop_head = 0xFFFF;
+        uint16_t previous_pc = 0;
+        IdleLoopProbe idle_probe;
+        uint64_t idle_cycles = 0;
+
+        std::unique_ptr<Profiler> profiler_;
 
         Core *core;
 
         friend class MainBus;
+        friend struct MicroOps;
     };
 
+    inline void SM83::skip_idle_loop(uint64_t deadline) {
+        if (!idle_loop_skipping || profiler_) {
+            return;
+        }
+
+        if (pc <= previous_pc) {
+            skip_idle_iterations(deadline);
+        }
+
+        previous_pc = pc;
+    }
+
 }
\ No newline at end of file
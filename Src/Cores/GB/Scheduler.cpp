@@ -0,0 +1,76 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Scheduler.hpp"
+#include "StateArchive.hpp"
+
+namespace GB {
+    void Scheduler::reset() {
+        timestamp = 0;
+        earliest = NEVER;
+        deadlines.fill(NEVER);
+    }
+
+    uint64_t Scheduler::deadline(EventType type) const {
+        return deadlines[static_cast<size_t>(type)];
+    }
+
+    void Scheduler::schedule(EventType type, uint64_t deadline) {
+        auto &slot = deadlines[static_cast<size_t>(type)];
+        bool was_earliest = slot == earliest;
+
+        slot = deadline;
+
+        if (deadline < earliest) {
+            earliest = deadline;
+        } else if (was_earliest) {
+            find_earliest();
+        }
+    }
+
+    void Scheduler::cancel(EventType type) { schedule(type, NEVER); }
+
+    EventType Scheduler::pop_due_event() {
+        if (timestamp < earliest) {
+            return EventType::Count;
+        }
+
+        for (size_t i = 0; i < deadlines.size(); ++i) {
+            if (deadlines[i] == earliest) {
+                deadlines[i] = NEVER;
+                find_earliest();
+
+                return static_cast<EventType>(i);
+            }
+        }
+
+        return EventType::Count;
+    }
+
+    void Scheduler::find_earliest() {
+        earliest = NEVER;
+
+        for (auto deadline : deadlines) {
+            if (deadline < earliest) {
+                earliest = deadline;
+            }
+        }
+    }
+
+    void Scheduler::serialize(StateArchive &archive) { archive(timestamp, earliest, deadlines); }
+}
@@ -0,0 +1,75 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <array>
+#include <cinttypes>
+#include <cstddef>
+#include <limits>
+
+namespace GB {
+    class StateArchive;
+
+    enum class EventType : uint8_t {
+        PPU,
+        TimerOverflow,
+        FrameSequencer,
+        RTC,
+        Count,
+    };
+
+    constexpr uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+    /*
+        Deadlines are stored in a fixed slot per event type, there are only a handful of them so
+        finding the earliest one with a linear scan is cheaper than maintaining a heap. The
+        earliest deadline is cached so checking for due events is a single comparison.
+
+        Timestamps are counted in dots (4 MiHz), which does not change with the CPU speed.
+    */
+    class Scheduler {
+    public:
+        void reset();
+
+        uint64_t now() const { return timestamp; }
+        uint64_t next_deadline() const { return earliest; }
+        bool has_due_events() const { return timestamp >= earliest; }
+
+        void advance(uint64_t dots) { timestamp += dots; }
+
+        uint64_t deadline(EventType type) const;
+        void schedule(EventType type, uint64_t deadline);
+        void cancel(EventType type);
+
+        // Returns the earliest due event and removes it from the queue, EventType::Count when
+        // nothing is due.
+        EventType pop_due_event();
+
+        void serialize(StateArchive &archive);
+
+    private:
+        void find_earliest();
+
+        uint64_t timestamp = 0;
+        uint64_t earliest = NEVER;
+        std::array<uint64_t, static_cast<size_t>(EventType::Count)> deadlines{};
+
+        // Compiled code advances the timestamp and checks for due events in place.
+        friend class SM83;
+    };
+}
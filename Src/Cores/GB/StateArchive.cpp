@@ -0,0 +1,64 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "StateArchive.hpp"
+
+namespace GB {
+    StateArchive::StateArchive(std::vector<uint8_t> &output)
+        : mode_(ArchiveMode::Save), output(&output) {}
+
+    StateArchive::StateArchive(std::span<const uint8_t> input)
+        : mode_(ArchiveMode::Load), input(input) {}
+
+    StateArchive::StateArchive() : mode_(ArchiveMode::Measure) {}
+
+    ArchiveMode StateArchive::mode() const { return mode_; }
+
+    bool StateArchive::loading() const { return mode_ == ArchiveMode::Load; }
+
+    bool StateArchive::good() const { return good_; }
+
+    size_t StateArchive::position() const { return position_; }
+
+    void StateArchive::bytes(void *data, size_t size) {
+        switch (mode_) {
+        case ArchiveMode::Save: {
+            if (position_ + size > output->size()) {
+                output->resize(position_ + size);
+            }
+
+            std::memcpy(output->data() + position_, data, size);
+            break;
+        }
+        case ArchiveMode::Load: {
+            if (!good_ || position_ + size > input.size()) {
+                good_ = false;
+                return;
+            }
+
+            std::memcpy(data, input.data() + position_, size);
+            break;
+        }
+        case ArchiveMode::Measure: {
+            break;
+        }
+        }
+
+        position_ += size;
+    }
+}
@@ -0,0 +1,74 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cinttypes>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace GB {
+    constexpr uint32_t SAVE_STATE_MAGIC = 0x53424342; // "BCBS"
+    constexpr uint32_t SAVE_STATE_VERSION = 2;
+
+    enum class ArchiveMode {
+        Save,
+        Load,
+        Measure,
+    };
+
+    /*
+        Components describe their state once with a serialize function that works in both
+        directions. Every field is trivially copyable and of fixed size, so a state has the same
+        layout and size for every cartridge of a given type and each field is a single memcpy.
+
+        Measuring only counts the bytes, so the output can be sized once and every save writes
+        into the same buffer without growing it.
+    */
+    class StateArchive {
+    public:
+        explicit StateArchive(std::vector<uint8_t> &output);
+        explicit StateArchive(std::span<const uint8_t> input);
+        StateArchive();
+
+        ArchiveMode mode() const;
+        bool loading() const;
+
+        // False once a load tried to read past the end of the input.
+        bool good() const;
+        size_t position() const;
+
+        template <typename... T> void operator()(T &...values) { (field(values), ...); }
+
+    private:
+        template <typename T> void field(T &value) {
+            static_assert(std::is_trivially_copyable_v<T>,
+                          "Only trivially copyable fields can be archived.");
+            bytes(&value, sizeof(T));
+        }
+
+        void bytes(void *data, size_t size);
+
+        ArchiveMode mode_;
+        bool good_ = true;
+        size_t position_ = 0;
+        std::vector<uint8_t> *output = nullptr;
+        std::span<const uint8_t> input{};
+    };
+}
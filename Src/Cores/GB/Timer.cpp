@@ -18,14 +18,11 @@
 
 #include "Timer.hpp"
 #include "Core.hpp"
+#include "StateArchive.hpp"
 #include <array>
 #include <stdexcept>
 
 namespace GB {
-    constexpr bool EdgeFell(uint16_t previous, uint16_t next, uint16_t mask) {
-        return (previous & mask) && (!(next & mask));
-    }
-
     Timer::Timer(Core *core) : core(core) {
         if (!core) {
             throw std::invalid_argument("Core cannot be null.");
@@ -35,27 +32,33 @@ namespace GB {
     }
 
     void Timer::write_register(uint8_t reg, uint8_t value) {
+        sync();
+
         switch (reg) {
         case 0x04: {
             reset_div();
-            return;
+            break;
         }
         case 0x05: {
             tima = value;
-            return;
+            break;
         }
         case 0x06: {
             tma = value;
-            return;
+            break;
         }
         case 0x07: {
             set_tac(value);
-            return;
+            break;
         }
         }
+
+        schedule_events();
     }
 
     uint8_t Timer::read_register(uint8_t reg) {
+        sync();
+
         switch (reg) {
         case 0x04:
             return read_div();
@@ -70,47 +73,121 @@ namespace GB {
     }
 
     void Timer::reset() {
-        div_cycles = 0xAB00;
         tima = 0;
         tma = 0;
+        div_rate = 1;
+        sync_timestamp = core->scheduler.now();
+        div_timestamp = sync_timestamp - 0xAB00;
         set_tac(0xF8);
     }
 
-    void Timer::set_tac(uint8_t rate) {
-        static constexpr std::array<uint16_t, 4> tac_table = {512, 8, 32, 128};
+    void Timer::sync() {
+        uint64_t now = core->scheduler.now();
+        uint64_t previous = div_counter(sync_timestamp);
+        uint64_t current = div_counter(now);
 
-        tac_rate = tac_table[rate & 0x3];
-        tac = rate;
+        // The frame sequencer is clocked by the falling edge of DIV bit 4 (bit 5 in double speed
+        // mode), the APU is caught up to the start of the M-cycle that caused each edge.
+        uint64_t sequencer_period = 0x2000 * div_rate;
+        uint64_t sequencer_edges = current / sequencer_period - previous / sequencer_period;
+
+        for (uint64_t i = 1; i <= sequencer_edges; ++i) {
+            uint64_t edge = (previous / sequencer_period + i) * sequencer_period;
+
+            core->apu.sync(edge_timestamp(edge));
+            core->apu.step_frame_sequencer();
+        }
+
+        if (timer_enabled()) {
+            uint64_t period = tac_rate * 2;
+            increment_tima(current / period - previous / period);
+        }
+
+        sync_timestamp = now;
     }
 
-    void Timer::reset_div() { change_div(0); }
+    void Timer::schedule_events() {
+        uint64_t current = div_counter(sync_timestamp);
+        uint64_t sequencer_period = 0x2000 * div_rate;
 
-    uint8_t Timer::read_div() { return div_cycles >> 8; }
+        // Events are due right after the M-cycle whose DIV update causes the edge.
+        core->scheduler.schedule(
+            EventType::FrameSequencer,
+            edge_timestamp((current / sequencer_period + 1) * sequencer_period) + 1);
 
-    void Timer::update(int32_t cycles) {
-        if (core->cpu.stopped()) {
-            change_div(0);
+        if (timer_enabled()) {
+            uint64_t period = tac_rate * 2;
+            uint64_t overflow_edge = (current / period + (0x100 - tima)) * period;
+
+            core->scheduler.schedule(EventType::TimerOverflow, edge_timestamp(overflow_edge) + 1);
         } else {
-            change_div(div_cycles + cycles);
+            core->scheduler.cancel(EventType::TimerOverflow);
         }
     }
 
+    void Timer::set_double_speed(bool enabled) {
+        sync();
+
+        // DIV keeps its value across the switch, only the rate it advances at changes.
+        uint64_t current = div_counter(sync_timestamp);
+
+        div_rate = enabled ? 2 : 1;
+        div_timestamp = sync_timestamp - current / div_rate;
+
+        schedule_events();
+    }
+
     bool Timer::timer_enabled() const { return tac & 0b100; }
 
-    void Timer::change_div(uint16_t new_div) {
-        if (EdgeFell(div_cycles >> 8, new_div >> 8,
-                     core->cpu.double_speed() ? 0b100000 : 0b10000)) {
+    void Timer::set_tac(uint8_t rate) {
+        static constexpr std::array<uint16_t, 4> tac_table = {512, 8, 32, 128};
+
+        tac_rate = tac_table[rate & 0x3];
+        tac = rate;
+    }
+
+    void Timer::reset_div() {
+        uint64_t current = div_counter(sync_timestamp);
+
+        // Resetting DIV while the selected bits are set is seen as a falling edge.
+        if (current & (0x1000 * div_rate)) {
+            core->apu.sync(sync_timestamp);
             core->apu.step_frame_sequencer();
         }
 
-        if (timer_enabled() && EdgeFell(div_cycles, new_div, tac_rate)) {
-            ++tima;
-            if (tima == 0) {
-                tima = tma;
-                core->cpu.request_interrupt(INT_TIMER_BIT);
+        if (timer_enabled() && (current & tac_rate)) {
+            increment_tima(1);
+        }
+
+        div_timestamp = sync_timestamp;
+    }
+
+    uint8_t Timer::read_div() const { return div_counter(sync_timestamp) >> 8; }
+
+    uint64_t Timer::div_counter(uint64_t timestamp) const {
+        return (timestamp - div_timestamp) * div_rate;
+    }
+
+    uint64_t Timer::edge_timestamp(uint64_t counter) const {
+        return sync_timestamp + (counter - div_counter(sync_timestamp)) / div_rate - 4 / div_rate;
+    }
+
+    void Timer::increment_tima(uint64_t increments) {
+        while (increments) {
+            uint64_t until_overflow = 0x100 - tima;
+
+            if (increments < until_overflow) {
+                tima += increments;
+                return;
             }
+
+            increments -= until_overflow;
+            tima = tma;
+            core->cpu.request_interrupt(INT_TIMER_BIT);
         }
+    }
 
-        div_cycles = new_div;
+    void Timer::serialize(StateArchive &archive) {
+        archive(tima, tma, tac, tac_rate, div_rate, div_timestamp, sync_timestamp);
     }
 }
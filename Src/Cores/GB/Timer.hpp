@@ -21,7 +21,13 @@
 
 namespace GB {
     class Core;
+    class StateArchive;
 
+    /*
+        DIV is not stepped, it is derived from the time elapsed since it was last reset. TIMA and
+        the frame sequencer are caught up by counting the falling edges of their DIV bits between
+        two syncs, which happens on register access and when one of the scheduled edges is due.
+    */
     class Timer {
     public:
         Timer(Core *core);
@@ -30,19 +36,26 @@ namespace GB {
         void write_register(uint8_t reg, uint8_t value);
         uint8_t read_register(uint8_t reg);
         void reset();
-        void update(int32_t cycles);
+        void sync();
+        void schedule_events();
+        void set_double_speed(bool enabled);
+        void serialize(StateArchive &archive);
 
     private:
         void set_tac(uint8_t rate);
         void reset_div();
-        uint8_t read_div();
-        void change_div(uint16_t new_div);
+        uint8_t read_div() const;
+        uint64_t div_counter(uint64_t timestamp) const;
+        uint64_t edge_timestamp(uint64_t counter) const;
+        void increment_tima(uint64_t increments);
 
         Core *core;
         uint8_t tima = 0;
         uint8_t tma = 0;
         uint8_t tac = 0;
         uint16_t tac_rate = 0;
-        uint16_t div_cycles = 0;
+        uint64_t div_rate = 1;
+        uint64_t div_timestamp = 0;
+        uint64_t sync_timestamp = 0;
     };
 }
@@ -0,0 +1,441 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Runner.hpp"
+#include "Cores/GB/Constants.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+namespace Headless {
+    constexpr int32_t AUDIO_SAMPLE_RATE = 48000;
+
+    constexpr std::chrono::nanoseconds FRAME_DURATION{1000000000LL * GB::CYCLES_PER_FRAME /
+                                                      GB::CPU_CLOCK_RATE};
+
+    double RunStatistics::seconds() const {
+        return std::chrono::duration<double>(elapsed).count();
+    }
+
+    double RunStatistics::frames_per_second() const {
+        return seconds() > 0.0 ? frames / seconds() : 0.0;
+    }
+
+    double RunStatistics::cycles_per_second() const {
+        return seconds() > 0.0 ? static_cast<double>(cycles) / seconds() : 0.0;
+    }
+
+    double RunStatistics::instructions_per_second() const {
+        return seconds() > 0.0 ? static_cast<double>(instructions) / seconds() : 0.0;
+    }
+
+    double RunStatistics::speed_multiplier() const {
+        return cycles_per_second() / GB::CPU_CLOCK_RATE;
+    }
+
+    Runner::Runner(RunnerOptions options) : options(std::move(options)) {}
+
+    bool Runner::load() {
+        cart = GB::Cartridge::from_file(options.rom_path);
+
+        if (!cart) {
+            std::fprintf(stderr, "Unable to load cartridge: %s\n",
+                         options.rom_path.string().c_str());
+            return false;
+        }
+
+        initialize(*core, *cart);
+        core->cpu.set_cached_interpreter(options.cached_interpreter);
+
+        if ((options.recompiler || options.verify_recompiler) && !core->cpu.set_recompiler(true)) {
+            std::fprintf(stderr, "The recompiler isn't supported on this platform\n");
+            return false;
+        }
+
+        if (options.skip_idle_loops || options.verify_idle_loops) {
+            core->cpu.set_idle_loop_skipping(true);
+            core->cpu.idle_loop_cache().load(idle_loop_cache_path(), cart->header().checksum);
+        }
+
+        // The reference runs the same cartridge in the interpreter only, without skipping.
+        if (options.verify_recompiler || options.verify_idle_loops) {
+            reference_cart = GB::Cartridge::from_file(options.rom_path);
+            reference = std::make_unique<GB::Core>();
+            initialize(*reference, *reference_cart);
+        }
+
+        core->bus.set_io_counting(!options.io_counts_path.empty());
+
+        if (!open_movie() || !start_profiling()) {
+            return false;
+        }
+
+        if (!options.audio_path.empty()) {
+            open_audio();
+
+            if (!audio->is_open()) {
+                std::fprintf(stderr, "Unable to open audio output: %s\n",
+                             options.audio_path.string().c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void Runner::initialize(GB::Core &target, GB::Cartridge &target_cart) const {
+        if (options.bootstrap_path.empty()) {
+            target.initialize(&target_cart);
+            return;
+        }
+
+        auto console = options.console;
+
+        if (console == GB::ConsoleType::AutoSelect) {
+            console = (target_cart.header().cgb_support & 0x80) ? GB::ConsoleType::CGB
+                                                                : GB::ConsoleType::DMG;
+        }
+
+        target.initialize_with_bootstrap(&target_cart, console, options.bootstrap_path);
+    }
+
+    RunStatistics Runner::run() {
+        RunStatistics stats{};
+
+        auto start = std::chrono::steady_clock::now();
+        auto next_frame = start;
+        auto start_cycles = core->elapsed_cycles();
+        auto start_instructions = core->cpu.instruction_count();
+        auto start_idle_cycles = core->cpu.idle_cycles_skipped();
+
+        for (int32_t i = 0; i < options.frames; ++i) {
+            core->ppu.set_output_enabled(should_draw(i));
+            movie.begin_frame(*core);
+            bool in_sync = true;
+
+            if (reference) {
+                in_sync = run_verified_frame(i);
+            } else {
+                core->run_for_frames(1);
+            }
+
+            movie.end_frame(*core);
+            stats.frames++;
+
+            if (!in_sync) {
+                stats.reference_diverged = true;
+                break;
+            }
+
+            if (audio) {
+                write_audio();
+            }
+
+            if (options.pace_to_real_time) {
+                next_frame += FRAME_DURATION;
+                std::this_thread::sleep_until(next_frame);
+            }
+        }
+
+        core->ppu.set_output_enabled(true);
+        stats.elapsed = std::chrono::steady_clock::now() - start;
+        stats.cycles = core->elapsed_cycles() - start_cycles;
+        stats.instructions = core->cpu.instruction_count() - start_instructions;
+        stats.idle_cycles = core->cpu.idle_cycles_skipped() - start_idle_cycles;
+
+        finish_movie(stats);
+        write_profile();
+
+        if (!options.io_counts_path.empty() && !write_io_counts()) {
+            std::fprintf(stderr, "Unable to write IO counts: %s\n",
+                         options.io_counts_path.string().c_str());
+        }
+
+        if ((options.skip_idle_loops || options.verify_idle_loops) &&
+            !core->cpu.idle_loop_cache().save(idle_loop_cache_path(), cart->header().checksum)) {
+            std::fprintf(stderr, "Unable to write idle loop cache: %s\n",
+                         idle_loop_cache_path().string().c_str());
+        }
+
+        if (!options.screenshot_path.empty() && !write_screenshot()) {
+            std::fprintf(stderr, "Unable to write screenshot: %s\n",
+                         options.screenshot_path.string().c_str());
+        }
+
+        return stats;
+    }
+
+    bool Runner::run_verified_frame(int32_t frame) {
+        auto buttons = core->pad.buttons();
+
+        reference->ppu.set_output_enabled(should_draw(frame));
+        reference->pad.set_buttons(buttons);
+        core->save_state(frame_state);
+
+        auto block = run_frame_in_lockstep(false);
+
+        if (!block) {
+            core->save_state(state);
+            reference->save_state(reference_state);
+
+            if (state == reference_state) {
+                return true;
+            }
+
+            // Something only the whole state shows, both cores go back to the start of the frame.
+            core->load_state(frame_state);
+            reference->load_state(frame_state);
+            core->pad.set_buttons(buttons);
+            reference->pad.set_buttons(buttons);
+            block = run_frame_in_lockstep(true);
+        }
+
+        if (block) {
+            std::printf("Core diverged from the reference in frame %d, in the block at %04X\n",
+                        frame, *block);
+        } else {
+            std::printf("Core diverged from the reference in frame %d, but not when run again\n",
+                        frame);
+        }
+
+        std::printf("Core is at PC %04X cycle %llu, the reference at PC %04X cycle %llu\n",
+                    core->cpu.program_counter(),
+                    static_cast<unsigned long long>(core->elapsed_cycles()),
+                    reference->cpu.program_counter(),
+                    static_cast<unsigned long long>(reference->elapsed_cycles()));
+
+        return false;
+    }
+
+    std::optional<uint16_t> Runner::run_frame_in_lockstep(bool compare_states) {
+        // The same run as run_for_frames(1), the reference catches up after every block.
+        auto vblank = core->ppu.vblank_count();
+        uint64_t frame_end = core->elapsed_cycles() + GB::CYCLES_PER_FRAME;
+
+        // Loading a state leaves the instruction counts alone, so only what the frame ran counts.
+        uint64_t instructions = core->cpu.instruction_count();
+        uint64_t reference_instructions = reference->cpu.instruction_count();
+
+        while (true) {
+            uint16_t block = core->cpu.program_counter();
+            uint64_t start = core->elapsed_cycles();
+
+            core->run_single_block(frame_end - start);
+
+            if (reference->elapsed_cycles() < core->elapsed_cycles()) {
+                reference->run_for_cycles(core->elapsed_cycles() - reference->elapsed_cycles());
+            }
+
+            if (core->elapsed_cycles() != reference->elapsed_cycles() ||
+                core->cpu.program_counter() != reference->cpu.program_counter() ||
+                core->cpu.instruction_count() - instructions !=
+                    reference->cpu.instruction_count() - reference_instructions) {
+                return block;
+            }
+
+            if (compare_states) {
+                core->save_state(state);
+                reference->save_state(reference_state);
+
+                if (state != reference_state) {
+                    return block;
+                }
+            }
+
+            if (core->ppu.vblank_count() != vblank || core->elapsed_cycles() >= frame_end ||
+                core->elapsed_cycles() == start || core->cpu.stopped()) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    bool Runner::should_draw(int32_t frame) const {
+        if (options.frame_skip <= 0 || movie.mode() != GB::MovieMode::Inactive) {
+            return true;
+        }
+
+        // The last frame is always drawn for the screenshot.
+        return (frame % (options.frame_skip + 1)) == options.frame_skip ||
+               frame == options.frames - 1;
+    }
+
+    bool Runner::open_movie() {
+        if (!options.play_movie_path.empty()) {
+            if (!movie.load(options.play_movie_path)) {
+                std::fprintf(stderr, "Unable to load movie: %s\n",
+                             options.play_movie_path.string().c_str());
+                return false;
+            }
+
+            if (!movie.start_playback(*core)) {
+                std::fprintf(stderr, "Movie was recorded with a different cartridge: %s\n",
+                             options.play_movie_path.string().c_str());
+                return false;
+            }
+
+            options.frames = static_cast<int32_t>(movie.frame_count());
+            options.pace_to_real_time = false;
+        } else if (!options.record_movie_path.empty()) {
+            movie.start_recording(*core);
+        }
+
+        return true;
+    }
+
+    void Runner::finish_movie(RunStatistics &stats) {
+        switch (movie.mode()) {
+        case GB::MovieMode::Recording: {
+            if (!movie.save(options.record_movie_path)) {
+                std::fprintf(stderr, "Unable to write movie: %s\n",
+                             options.record_movie_path.string().c_str());
+            }
+            break;
+        }
+        case GB::MovieMode::Playback: {
+            if (auto frame = movie.desync_frame()) {
+                std::printf("Movie desynced at frame %zu\n", *frame);
+                stats.movie_desynced = true;
+            } else {
+                std::printf("Movie played back in sync\n");
+            }
+            break;
+        }
+        case GB::MovieMode::Inactive: {
+            break;
+        }
+        }
+
+        movie.stop();
+    }
+
+    std::filesystem::path Runner::idle_loop_cache_path() const {
+        auto path = options.rom_path;
+        path += ".idle";
+
+        return path;
+    }
+
+    bool Runner::start_profiling() {
+        if (options.profile_path.empty()) {
+            return true;
+        }
+
+        core->cpu.set_profiling(true);
+
+        if (!options.symbols_path.empty()) {
+            if (!core->cpu.profiler()->load_symbols(options.symbols_path)) {
+                std::fprintf(stderr, "Unable to load symbols: %s\n",
+                             options.symbols_path.string().c_str());
+                return false;
+            }
+
+            return true;
+        }
+
+        // RGBDS writes the symbols next to the ROM, they are optional.
+        auto symbols_path = options.rom_path;
+        core->cpu.profiler()->load_symbols(symbols_path.replace_extension(".sym"));
+
+        return true;
+    }
+
+    void Runner::write_profile() {
+        auto profiler = core->cpu.profiler();
+
+        if (!profiler) {
+            return;
+        }
+
+        auto stacks_path = options.profile_path;
+        stacks_path += ".folded";
+
+        if (!profiler->write_report(options.profile_path)) {
+            std::fprintf(stderr, "Unable to write profile: %s\n",
+                         options.profile_path.string().c_str());
+        }
+
+        if (!profiler->write_collapsed_stacks(stacks_path)) {
+            std::fprintf(stderr, "Unable to write profile: %s\n", stacks_path.string().c_str());
+        }
+    }
+
+    bool Runner::write_io_counts() const {
+        std::ofstream out(options.io_counts_path);
+
+        if (!out) {
+            return false;
+        }
+
+        const auto &counts = core->bus.io_access_counts();
+        std::vector<uint8_t> addresses;
+
+        for (size_t address = 0; address < counts.reads.size(); ++address) {
+            if (counts.reads[address] || counts.writes[address]) {
+                addresses.push_back(static_cast<uint8_t>(address));
+            }
+        }
+
+        std::stable_sort(addresses.begin(), addresses.end(), [&](uint8_t a, uint8_t b) {
+            return counts.reads[a] + counts.writes[a] > counts.reads[b] + counts.writes[b];
+        });
+
+        char line[64];
+        std::snprintf(line, sizeof(line), "%-8s %14s %14s\n", "Address", "Reads", "Writes");
+        out << line;
+
+        for (auto address : addresses) {
+            std::snprintf(line, sizeof(line), "FF%02X     %14llu %14llu\n", address,
+                          static_cast<unsigned long long>(counts.reads[address]),
+                          static_cast<unsigned long long>(counts.writes[address]));
+            out << line;
+        }
+
+        return static_cast<bool>(out);
+    }
+
+    void Runner::open_audio() {
+        audio = std::make_unique<WaveWriter>(options.audio_path, AUDIO_SAMPLE_RATE);
+        core->apu.set_sample_rate(AUDIO_SAMPLE_RATE);
+    }
+
+    void Runner::write_audio() {
+        audio_samples.resize(core->apu.samples_available() * 2);
+
+        size_t count = core->apu.read_samples(std::span<int16_t>(audio_samples));
+        audio->write(std::span<const int16_t>(audio_samples.data(), count * 2));
+    }
+
+    bool Runner::write_screenshot() const {
+        std::ofstream image(options.screenshot_path, std::ios::binary);
+
+        if (!image) {
+            return false;
+        }
+
+        image << "P6\n" << GB::LCD_WIDTH << " " << GB::LCD_HEIGHT << "\n255\n";
+
+        auto framebuffer = core->ppu.framebuffer();
+
+        for (size_t i = 0; i < framebuffer.size(); i += GB::FRAMEBUFFER_COLOR_CHANNELS) {
+            image.write(reinterpret_cast<const char *>(&framebuffer[i]), 3);
+        }
+
+        return static_cast<bool>(image);
+    }
+}
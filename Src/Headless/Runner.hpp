@@ -0,0 +1,127 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "Cores/GB/Core.hpp"
+#include "Cores/GB/Movie.hpp"
+#include "WaveWriter.hpp"
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace Headless {
+    struct RunnerOptions {
+        std::filesystem::path rom_path;
+        std::filesystem::path bootstrap_path;
+        GB::ConsoleType console = GB::ConsoleType::AutoSelect;
+        int32_t frames = 3600;
+
+        // Optional stages, everything is skipped by default so the core runs unthrottled.
+        bool pace_to_real_time = false;
+        std::filesystem::path audio_path;
+        std::filesystem::path screenshot_path;
+
+        // Number of frames skipped between drawn ones, skipped frames still run the PPU with exact
+        // timing but don't compose any pixels. Ignored with movies since video state is hashed.
+        int32_t frame_skip = 0;
+
+        // Runs ROM code from pre-decoded blocks, see GB::BlockCache.
+        bool cached_interpreter = false;
+
+        // Verifying runs a second core in the interpreter in lockstep, comparing the CPU after
+        // every block and the whole state after every frame. A frame that differs is run again
+        // comparing the whole state after every block, to find the first one that went wrong.
+        bool recompiler = false;
+        bool verify_recompiler = false;
+
+        // Skips idle loops, see GB::SM83::set_idle_loop_skipping. The loops found are kept next to
+        // the ROM in <rom>.idle. Verifying compares against a core that runs every iteration.
+        bool skip_idle_loops = false;
+        bool verify_idle_loops = false;
+
+        // Writes a hot spot report to profile_path and collapsed stacks to <profile_path>.folded,
+        // see GB::Profiler. Symbols are read from <rom>.sym unless a path is given.
+        std::filesystem::path profile_path;
+        std::filesystem::path symbols_path;
+
+        // Writes the number of reads and writes to each IO register, see GB::MainBus.
+        std::filesystem::path io_counts_path;
+
+        // Playback replaces the frame count with the length of the movie and is never paced.
+        std::filesystem::path record_movie_path;
+        std::filesystem::path play_movie_path;
+    };
+
+    struct RunStatistics {
+        int32_t frames = 0;
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        uint64_t idle_cycles = 0;
+        std::chrono::nanoseconds elapsed{};
+        bool movie_desynced = false;
+        bool reference_diverged = false;
+
+        double seconds() const;
+        double frames_per_second() const;
+        double cycles_per_second() const;
+        double instructions_per_second() const;
+        double speed_multiplier() const;
+    };
+
+    class Runner {
+    public:
+        explicit Runner(RunnerOptions options);
+        Runner(const Runner &) = delete;
+        Runner(Runner &&) = delete;
+        Runner &operator=(const Runner &) = delete;
+        Runner &operator=(Runner &&) = delete;
+
+        bool load();
+        RunStatistics run();
+
+    private:
+        void open_audio();
+        void write_audio();
+        void initialize(GB::Core &target, GB::Cartridge &target_cart) const;
+        bool run_verified_frame(int32_t frame);
+        std::optional<uint16_t> run_frame_in_lockstep(bool compare_states);
+        bool should_draw(int32_t frame) const;
+        bool write_screenshot() const;
+        bool open_movie();
+        void finish_movie(RunStatistics &stats);
+        std::filesystem::path idle_loop_cache_path() const;
+        bool start_profiling();
+        void write_profile();
+        bool write_io_counts() const;
+
+        RunnerOptions options;
+        std::unique_ptr<GB::Core> core = std::make_unique<GB::Core>();
+        std::unique_ptr<GB::Cartridge> cart;
+        std::unique_ptr<WaveWriter> audio;
+        GB::Movie movie;
+        std::vector<int16_t> audio_samples;
+
+        std::unique_ptr<GB::Core> reference;
+        std::unique_ptr<GB::Cartridge> reference_cart;
+        std::vector<uint8_t> frame_state;
+        std::vector<uint8_t> state;
+        std::vector<uint8_t> reference_state;
+    };
+}
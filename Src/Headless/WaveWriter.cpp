@@ -0,0 +1,83 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "WaveWriter.hpp"
+#include <array>
+
+namespace Headless {
+    constexpr uint16_t CHANNELS = 2;
+    constexpr uint16_t BITS_PER_SAMPLE = 16;
+    constexpr uint32_t HEADER_SIZE = 44;
+
+    template <typename T> static void write_le(std::ofstream &file, T value) {
+        std::array<char, sizeof(T)> bytes{};
+
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            bytes[i] = static_cast<char>((value >> (i * 8)) & 0xFF);
+        }
+
+        file.write(bytes.data(), bytes.size());
+    }
+
+    WaveWriter::WaveWriter(std::filesystem::path path, int32_t sample_rate)
+        : sample_rate(sample_rate), file(path, std::ios::binary) {
+        if (file) {
+            write_header();
+        }
+    }
+
+    WaveWriter::~WaveWriter() {
+        if (file) {
+            // Sizes are only known once all samples have been written.
+            file.seekp(0);
+            write_header();
+            file.close();
+        }
+    }
+
+    bool WaveWriter::is_open() const { return file.is_open(); }
+
+    void WaveWriter::write(std::span<const int16_t> frames) {
+        for (auto sample : frames) {
+            write_le(file, static_cast<uint16_t>(sample));
+        }
+
+        frames_written += static_cast<uint32_t>(frames.size() / CHANNELS);
+    }
+
+    void WaveWriter::write_header() {
+        uint32_t data_size = frames_written * CHANNELS * (BITS_PER_SAMPLE / 8);
+        uint16_t block_align = CHANNELS * (BITS_PER_SAMPLE / 8);
+
+        file.write("RIFF", 4);
+        write_le<uint32_t>(file, HEADER_SIZE - 8 + data_size);
+        file.write("WAVE", 4);
+
+        file.write("fmt ", 4);
+        write_le<uint32_t>(file, 16);
+        write_le<uint16_t>(file, 1); // PCM
+        write_le<uint16_t>(file, CHANNELS);
+        write_le<uint32_t>(file, sample_rate);
+        write_le<uint32_t>(file, sample_rate * block_align);
+        write_le<uint16_t>(file, block_align);
+        write_le<uint16_t>(file, BITS_PER_SAMPLE);
+
+        file.write("data", 4);
+        write_le<uint32_t>(file, data_size);
+    }
+}
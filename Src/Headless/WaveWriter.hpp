@@ -0,0 +1,45 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cinttypes>
+#include <filesystem>
+#include <fstream>
+#include <span>
+
+namespace Headless {
+    class WaveWriter {
+    public:
+        WaveWriter(std::filesystem::path path, int32_t sample_rate);
+        ~WaveWriter();
+        WaveWriter(const WaveWriter &) = delete;
+        WaveWriter(WaveWriter &&) = delete;
+        WaveWriter &operator=(const WaveWriter &) = delete;
+        WaveWriter &operator=(WaveWriter &&) = delete;
+
+        bool is_open() const;
+        void write(std::span<const int16_t> frames);
+
+    private:
+        void write_header();
+
+        int32_t sample_rate = 0;
+        uint32_t frames_written = 0;
+        std::ofstream file;
+    };
+}
@@ -0,0 +1,235 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Runner.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+static void print_usage(const char *program) {
+    std::printf("Usage: %s [options] <rom>\n"
+                "\n"
+                "Options:\n"
+                "  --frames <n>          Number of frames to run (default 3600)\n"
+                "  --bootstrap <path>    Boot ROM to run before the cartridge\n"
+                "  --console <dmg|cgb>   Console type used with --bootstrap\n"
+                "  --pace                Throttle emulation to real time\n"
+                "  --audio <path>        Write the audio output to a WAV file\n"
+                "  --screenshot <path>   Write the final frame to a PPM file\n"
+                "  --frame-skip <n>      Skip drawing n frames between drawn ones\n"
+                "  --cached-interpreter  Run ROM code from pre-decoded blocks\n"
+                "  --recompiler          Compile hot ROM code to native code (x86-64 Linux)\n"
+                "  --verify-recompiler   Check the recompiler against the interpreter each block\n"
+                "  --skip-idle-loops     Fast forward through loops that wait for an event\n"
+                "  --verify-idle-loops   Check idle loop skipping against a full run each block\n"
+                "  --profile <path>      Write a hot spot report and <path>.folded call stacks\n"
+                "  --symbols <path>      RGBDS symbols for the profile (default <rom>.sym)\n"
+                "  --io-counts <path>    Write the number of accesses to each IO register\n"
+                "  --record <path>       Record a movie of the run\n"
+                "  --play <path>         Play back a movie and check it stays in sync\n"
+                "  --help                Show this message\n",
+                program);
+}
+
+static bool parse_arguments(int argc, char *argv[], Headless::RunnerOptions &options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+
+        const auto next_value = [&]() -> const char * {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "Missing value for %s\n", argv[i]);
+                return nullptr;
+            }
+
+            return argv[++i];
+        };
+
+        if (arg == "--help") {
+            print_usage(argv[0]);
+            std::exit(EXIT_SUCCESS);
+        } else if (arg == "--pace") {
+            options.pace_to_real_time = true;
+        } else if (arg == "--cached-interpreter") {
+            options.cached_interpreter = true;
+        } else if (arg == "--recompiler") {
+            options.recompiler = true;
+        } else if (arg == "--verify-recompiler") {
+            options.verify_recompiler = true;
+        } else if (arg == "--skip-idle-loops") {
+            options.skip_idle_loops = true;
+        } else if (arg == "--verify-idle-loops") {
+            options.verify_idle_loops = true;
+        } else if (arg == "--frames") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.frames = std::atoi(value);
+
+            if (options.frames <= 0) {
+                std::fprintf(stderr, "Frame count must be positive\n");
+                return false;
+            }
+        } else if (arg == "--bootstrap") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.bootstrap_path = value;
+        } else if (arg == "--console") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            std::string_view console = value;
+
+            if (console == "dmg") {
+                options.console = GB::ConsoleType::DMG;
+            } else if (console == "cgb") {
+                options.console = GB::ConsoleType::CGB;
+            } else {
+                std::fprintf(stderr, "Unknown console type: %s\n", value);
+                return false;
+            }
+        } else if (arg == "--audio") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.audio_path = value;
+        } else if (arg == "--screenshot") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.screenshot_path = value;
+        } else if (arg == "--frame-skip") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.frame_skip = std::atoi(value);
+
+            if (options.frame_skip < 0) {
+                std::fprintf(stderr, "Frame skip can't be negative\n");
+                return false;
+            }
+        } else if (arg == "--profile") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.profile_path = value;
+        } else if (arg == "--symbols") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.symbols_path = value;
+        } else if (arg == "--io-counts") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.io_counts_path = value;
+        } else if (arg == "--record") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.record_movie_path = value;
+        } else if (arg == "--play") {
+            auto value = next_value();
+
+            if (!value) {
+                return false;
+            }
+
+            options.play_movie_path = value;
+        } else if (arg.starts_with("--")) {
+            std::fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return false;
+        } else {
+            options.rom_path = arg;
+        }
+    }
+
+    if (options.rom_path.empty()) {
+        std::fprintf(stderr, "No ROM specified\n");
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    Headless::RunnerOptions options;
+
+    if (!parse_arguments(argc, argv, options)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Headless::Runner runner(std::move(options));
+
+    if (!runner.load()) {
+        return EXIT_FAILURE;
+    }
+
+    auto stats = runner.run();
+
+    std::printf("Frames:     %d\n"
+                "Cycles:     %llu\n"
+                "Instrs:     %llu\n"
+                "Wall time:  %.3f s\n"
+                "FPS:        %.2f\n"
+                "Cycles/s:   %.0f\n"
+                "Instrs/s:   %.0f\n"
+                "Speed:      %.2fx\n",
+                stats.frames, static_cast<unsigned long long>(stats.cycles),
+                static_cast<unsigned long long>(stats.instructions), stats.seconds(),
+                stats.frames_per_second(), stats.cycles_per_second(),
+                stats.instructions_per_second(), stats.speed_multiplier());
+
+    if (stats.idle_cycles) {
+        std::printf("Idle:       %llu cycles skipped\n",
+                    static_cast<unsigned long long>(stats.idle_cycles));
+    }
+
+    return (stats.movie_desynced || stats.reference_diverged) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
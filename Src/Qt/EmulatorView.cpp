@@ -26,8 +26,10 @@
 #include <QCoreApplication>
 #include <QLabel>
 #include <QScreen>
+#include <QStatusBar>
 #include <QWindow>
 #include <fmt/format.h>
+#include <cmath>
 
 namespace QtFrontend {
     EmulatorThread::EmulatorThread(QObject *parent)
@@ -39,6 +41,10 @@ namespace QtFrontend {
                 dynamic_cast<QOpenGLWidget *>(parent), &QWidget::hide);
         connect(this, &EmulatorThread::on_post_input, gb_controller,
                 &GBEmulatorController::copy_input);
+        connect(this, &EmulatorThread::on_post_rewind, gb_controller,
+                &GBEmulatorController::set_rewinding);
+        connect(this, &EmulatorThread::on_post_fast_forward, gb_controller,
+                &GBEmulatorController::set_fast_forward);
 
         connect(&input_timer, &QTimer::timeout, this, &EmulatorThread::update_input);
 
@@ -66,7 +72,9 @@ namespace QtFrontend {
         auto accumulator = std::chrono::nanoseconds::zero();
         auto last_timer_time = std::chrono::steady_clock::now();
         auto last_callback_time = std::chrono::steady_clock::now();
-        auto interval = Common::Math::freq_to_nanoseconds(60);
+        auto last_present_time = std::chrono::steady_clock::now();
+        auto present_interval = Common::Math::freq_to_nanoseconds(60);
+        int32_t unpaced_frames = 0;
 
         std::array<double, 100> samples{};
         size_t next = 0;
@@ -76,8 +84,34 @@ namespace QtFrontend {
             using namespace std::chrono_literals;
             QCoreApplication::processEvents();
 
-            if (gb_controller->get_state() != EmulationState::Stopped) {
+            int32_t speed = gb_controller->get_speed_percent();
+
+            if (gb_controller->get_state() != EmulationState::Stopped && speed == 0) {
+                // Frames are run back to back, only the ones due at 60 Hz are uploaded.
+                auto time_now = std::chrono::steady_clock::now();
+
+                if (!gb_controller->try_run_frame()) {
+                    continue;
+                }
+
+                ++unpaced_frames;
+
+                if (time_now - last_present_time >= present_interval) {
+                    std::chrono::duration<double> elapsed = time_now - last_present_time;
+                    double fps = unpaced_frames / elapsed.count();
+
+                    emit on_update_fps_display(QString::fromStdString(
+                        fmt::format("FPS:{} Speed:{:.1f}x", std::trunc(fps), fps / 60.0)));
+
+                    unpaced_frames = 0;
+                    last_present_time = time_now;
+                    present_frame();
+                }
+
+                accumulator = 0ns;
+            } else if (gb_controller->get_state() != EmulationState::Stopped) {
                 using namespace std::chrono_literals;
+                auto interval = present_interval * 100 / speed;
                 auto time_now = std::chrono::steady_clock::now();
                 auto delta = time_now - last_timer_time;
 
@@ -109,13 +143,11 @@ namespace QtFrontend {
                     emit on_update_fps_display(QString::fromStdString(
                         fmt::format("FPS:{} Avg:{:05.2f}ms", fps, current_average)));
 
-                    if (gb_controller->try_run_frame()) {
-                        auto &image = image_buffer.next_rendering_image();
-                        auto ppu_image = gb_controller->get_core().ppu.framebuffer();
-
-                        std::copy(ppu_image.begin(), ppu_image.end(), image.begin());
-
-                        emit update_textures();
+                    // Above full speed frames come faster than the display can show them.
+                    if (gb_controller->try_run_frame() &&
+                        (speed <= 100 || time_now - last_present_time >= present_interval)) {
+                        last_present_time = time_now;
+                        present_frame();
                     }
 
                     accumulator -= interval;
@@ -126,11 +158,22 @@ namespace QtFrontend {
         }
     }
 
+    void EmulatorThread::present_frame() {
+        auto &image = image_buffer.next_rendering_image();
+        auto ppu_image = gb_controller->framebuffer();
+
+        std::copy(ppu_image.begin(), ppu_image.end(), image.begin());
+
+        emit update_textures();
+    }
+
     void EmulatorThread::update_input() {
         if (gb_controller) {
             std::array<bool, 8> buttons{};
             gb_controller->process_input(buttons);
             emit on_post_input(buttons);
+            emit on_post_rewind(gb_controller->is_rewind_held());
+            emit on_post_fast_forward(gb_controller->is_fast_forward_held());
         }
     }
 
@@ -158,6 +201,9 @@ namespace QtFrontend {
         window->get_reset_action()->setDisabled(false);
         window->get_pause_action()->setDisabled(false);
         window->get_stop_action()->setDisabled(false);
+        window->get_record_movie_action()->setDisabled(false);
+        window->get_play_movie_action()->setDisabled(false);
+        window->get_stop_movie_action()->setDisabled(false);
     }
 
     void EmulatorView::hideEvent(QHideEvent *ev) {
@@ -167,6 +213,9 @@ namespace QtFrontend {
         window->get_reset_action()->setDisabled(true);
         window->get_pause_action()->setDisabled(true);
         window->get_stop_action()->setDisabled(true);
+        window->get_record_movie_action()->setDisabled(true);
+        window->get_play_movie_action()->setDisabled(true);
+        window->get_stop_movie_action()->setDisabled(true);
     }
 
     void EmulatorView::initializeGL() {
@@ -230,6 +279,20 @@ namespace QtFrontend {
 
         connect(window, &MainWindow::rom_loaded, thread->gb_controller,
                 &GBEmulatorController::start_rom);
+
+        connect(window, &MainWindow::movie_record, thread->gb_controller,
+                &GBEmulatorController::start_movie_recording);
+
+        connect(window, &MainWindow::movie_play, thread->gb_controller,
+                &GBEmulatorController::play_movie);
+
+        connect(window->get_stop_movie_action(), &QAction::triggered, thread->gb_controller,
+                &GBEmulatorController::stop_movie);
+
+        connect(thread->gb_controller, &GBEmulatorController::on_movie_status, window,
+                [this](const QString &message) {
+                    window->statusBar()->showMessage(message, 5000);
+                });
     }
 
     void EmulatorView::update_textures() {
@@ -56,9 +56,13 @@ namespace QtFrontend {
         void update_input();
         Q_SIGNAL void on_update_fps_display(const QString &text);
         Q_SIGNAL void on_post_input(std::array<bool, 8> input);
+        Q_SIGNAL void on_post_rewind(bool held);
+        Q_SIGNAL void on_post_fast_forward(bool held);
         Q_SIGNAL void update_textures();
 
     private:
+        void present_frame();
+
         std::atomic_bool running = true;
 
         QTimer input_timer;
@@ -18,12 +18,16 @@
 
 #include "AudioSystem.hpp"
 #include "Common/Config.hpp"
-#include "Cores/GB/Constants.hpp"
+#include <algorithm>
 
 namespace QtFrontend {
-    constexpr bool SYNC_TO_AUDIO = true;
-    constexpr float MAX_LAG = 0.04f;
-    constexpr float VOLUME_SCALE = 255.0f;
+    /*
+        Video is paced by the emulator thread at 60 Hz, slightly faster than the 59.73 Hz of the
+        Game Boy, and the audio device has its own clock on top of that. Instead of blocking on
+        the audio device the resample ratio is nudged by at most this much depending on how full
+        the ring is, which keeps it from either draining or overflowing.
+    */
+    constexpr double MAX_RATE_DELTA = 0.01;
 
     AudioSystem::AudioSystem() { open_device(); }
 
@@ -39,88 +43,49 @@ namespace QtFrontend {
         audio_spec.format = AUDIO_F32SYS;
         audio_spec.channels = 2;
         audio_spec.samples = 512;
-        audio_spec.callback = NULL;
+        audio_spec.callback = &AudioSystem::pull_samples;
+        audio_spec.userdata = this;
         audio_device = SDL_OpenAudioDevice(NULL, 0, &audio_spec, &obtained, 0);
 
-        opened = true;
+        opened = audio_device != 0;
     }
 
     void AudioSystem::close_device() {
         SDL_CloseAudioDevice(audio_device);
         samples.clear();
+        ring.clear();
         opened = false;
         audio_device = 0;
     }
 
-    bool AudioSystem::should_continue() {
-        float samples_remain =
-            static_cast<float>(SDL_GetQueuedAudioSize(audio_device) / (sizeof(AudioSample)));
-        float lag_threshold = static_cast<float>(obtained.freq) * MAX_LAG;
-
-        if (samples_remain > lag_threshold) {
-            if (SYNC_TO_AUDIO) {
-                return false;
-            } else {
-                return true;
-            }
+    void AudioSystem::queue_samples(GB::APU &apu) {
+        samples.resize(apu.samples_available() * 2);
+
+        size_t count = apu.read_samples(std::span<float>(samples));
+
+        if (!opened) {
+            return;
         }
 
-        return true;
-    }
+        // Whatever does not fit is dropped, the rate control below prevents that from happening
+        // outside of hiccups.
+        ring.push(std::span<const float>(samples.data(), count * 2));
 
-    void AudioSystem::operator()(GB::SampleResult result) {
-        const auto &config = Common::Config::current().gameboy;
+        double fill = static_cast<double>(ring.size()) / static_cast<double>(ring.capacity());
 
-        float left_vol = static_cast<float>(128 * result.left_channel.master_volume) / 7;
-        float right_vol = static_cast<float>(128 * result.right_channel.master_volume) / 7;
+        apu.set_resample_ratio((1.0 + MAX_RATE_DELTA * (1.0 - 2.0 * fill)) / speed);
+    }
 
-        float volume = static_cast<float>(config.audio.volume) / 100.0f;
-        float square1 = static_cast<float>(config.audio.square1) / 100.0f;
-        float square2 = static_cast<float>(config.audio.square2) / 100.0f;
-        float wave = static_cast<float>(config.audio.wave) / 100.0f;
-        float noise = static_cast<float>(config.audio.noise) / 100.0f;
-
-        float sample_left = 0;
-        float input = static_cast<float>(result.left_channel.pulse_1) / VOLUME_SCALE;
-        SDL_MixAudioFormat(reinterpret_cast<Uint8 *>(&sample_left),
-                           reinterpret_cast<Uint8 *>(&input), AUDIO_F32SYS, sizeof(float),
-                           static_cast<int>(left_vol * square1));
-        input = static_cast<float>(result.left_channel.pulse_2) / VOLUME_SCALE;
-        SDL_MixAudioFormat(reinterpret_cast<Uint8 *>(&sample_left),
-                           reinterpret_cast<Uint8 *>(&input), AUDIO_F32SYS, sizeof(float),
-                           static_cast<int>(left_vol * square2));
-        input = static_cast<float>(result.left_channel.wave) / VOLUME_SCALE;
-        SDL_MixAudioFormat(reinterpret_cast<Uint8 *>(&sample_left),
-                           reinterpret_cast<Uint8 *>(&input), AUDIO_F32SYS, sizeof(float),
-                           static_cast<int>(left_vol * wave));
-        input = static_cast<float>(result.left_channel.noise) / VOLUME_SCALE;
-        SDL_MixAudioFormat(reinterpret_cast<Uint8 *>(&sample_left),
-                           reinterpret_cast<Uint8 *>(&input), AUDIO_F32SYS, sizeof(float),
-                           static_cast<int>(left_vol * noise));
-
-        float sample_right = 0;
-        input = static_cast<float>(result.right_channel.pulse_1) / VOLUME_SCALE;
-        SDL_MixAudioFormat(reinterpret_cast<Uint8 *>(&sample_right),
-                           reinterpret_cast<Uint8 *>(&input), AUDIO_F32SYS, sizeof(float),
-                           static_cast<int>(right_vol * square1));
-        input = static_cast<float>(result.right_channel.pulse_2) / VOLUME_SCALE;
-        SDL_MixAudioFormat(reinterpret_cast<Uint8 *>(&sample_right),
-                           reinterpret_cast<Uint8 *>(&input), AUDIO_F32SYS, sizeof(float),
-                           static_cast<int>(right_vol * square2));
-        input = static_cast<float>(result.right_channel.wave) / VOLUME_SCALE;
-        SDL_MixAudioFormat(reinterpret_cast<Uint8 *>(&sample_right),
-                           reinterpret_cast<Uint8 *>(&input), AUDIO_F32SYS, sizeof(float),
-                           static_cast<int>(right_vol * wave));
-        input = static_cast<float>(result.right_channel.noise) / VOLUME_SCALE;
-        SDL_MixAudioFormat(reinterpret_cast<Uint8 *>(&sample_right),
-                           reinterpret_cast<Uint8 *>(&input), AUDIO_F32SYS, sizeof(float),
-                           static_cast<int>(right_vol * noise));
-
-        samples.push_back({.left = sample_left * volume, .right = sample_right * volume});
-
-        if (samples.size() == obtained.samples) {
-            SDL_QueueAudio(audio_device, samples.data(), samples.size() * sizeof(AudioSample));
-            samples.clear();
+    void AudioSystem::set_speed(GB::APU &apu, double new_speed) {
+        /*
+            Off full speed the output is resampled so each emulated second still lasts a second,
+            the band-limited synthesis filters it for the new rate. An unthrottled core has no
+            rate to match and produces no output at all.
+        */
+        apu.set_output_enabled(new_speed > 0.0);
+
+        if (new_speed > 0.0) {
+            speed = new_speed;
         }
     }
 
@@ -129,11 +94,39 @@ namespace QtFrontend {
             return;
         }
 
+        SDL_LockAudioDevice(audio_device);
+        ring.clear();
+        SDL_UnlockAudioDevice(audio_device);
+
         SDL_PauseAudioDevice(audio_device, 0);
         samples.clear();
-        samples.reserve(obtained.samples);
 
-        apu.set_samples_callback(GB::CPU_CLOCK_RATE / obtained.freq,
-                                 [this](GB::SampleResult samples) { this->operator()(samples); });
+        apply_volume_settings(apu);
+        apu.set_sample_rate(obtained.freq);
+    }
+
+    void AudioSystem::apply_volume_settings(GB::APU &apu) {
+        const auto &config = Common::Config::current().gameboy;
+
+        float volume = static_cast<float>(config.audio.volume) / 100.0f;
+
+        apu.set_channel_volume(GB::AudioChannel::Pulse1,
+                               volume * static_cast<float>(config.audio.square1) / 100.0f);
+        apu.set_channel_volume(GB::AudioChannel::Pulse2,
+                               volume * static_cast<float>(config.audio.square2) / 100.0f);
+        apu.set_channel_volume(GB::AudioChannel::Wave,
+                               volume * static_cast<float>(config.audio.wave) / 100.0f);
+        apu.set_channel_volume(GB::AudioChannel::Noise,
+                               volume * static_cast<float>(config.audio.noise) / 100.0f);
+    }
+
+    void SDLCALL AudioSystem::pull_samples(void *userdata, Uint8 *stream, int len) {
+        auto system = static_cast<AudioSystem *>(userdata);
+        std::span<float> out(reinterpret_cast<float *>(stream), len / sizeof(float));
+
+        size_t count = system->ring.pop(out);
+
+        // Underruns are filled with silence rather than blocking the audio thread.
+        std::fill(out.begin() + count, out.end(), 0.0f);
     }
-}
\ No newline at end of file
+}
@@ -18,15 +18,14 @@
 
 #pragma once
 #include "Cores/GB/APU.hpp"
+#include "Qt/RingBuffer.hpp"
 #include <SDL.h>
 #include <vector>
 
 namespace QtFrontend {
     class AudioSystem {
-        struct AudioSample {
-            float left = 0.0f;
-            float right = 0.0f;
-        };
+        // Interleaved stereo floats, about 85 ms at 48 KHz.
+        static constexpr size_t RING_SIZE = 8192;
 
     public:
         AudioSystem();
@@ -38,14 +37,21 @@ namespace QtFrontend {
 
         void open_device();
         void close_device();
-        bool should_continue();
-        void operator()(GB::SampleResult result);
         void prep_for_playback(GB::APU &apu);
+        void queue_samples(GB::APU &apu);
+        void apply_volume_settings(GB::APU &apu);
+
+        // Emulation speed as a multiple of full speed, 0 when unthrottled.
+        void set_speed(GB::APU &apu, double speed);
 
     private:
+        static void SDLCALL pull_samples(void *userdata, Uint8 *stream, int len);
+
         bool opened = false;
+        double speed = 1.0;
         SDL_AudioSpec obtained{};
         SDL_AudioDeviceID audio_device = 0;
-        std::vector<AudioSample> samples{};
+        std::vector<float> samples{};
+        RingBuffer<float, RING_SIZE> ring;
     };
 }
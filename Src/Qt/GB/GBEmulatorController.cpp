@@ -19,8 +19,12 @@
 #include "GBEmulatorController.hpp"
 #include "Common/Config.hpp"
 #include "Input/DeviceRegistry.hpp"
+#include <algorithm>
+#include <fmt/format.h>
 
 namespace QtFrontend {
+    constexpr int32_t MIN_SPEED_PERCENT = 25;
+
     GBEmulatorController::GBEmulatorController() : QObject(nullptr), sram_timer(new QTimer(this)) {
         connect(sram_timer, &QTimer::timeout, this, &GBEmulatorController::save_sram);
     }
@@ -31,11 +35,32 @@ namespace QtFrontend {
 
     GB::Core &GBEmulatorController::get_core() { return core; }
 
+    std::span<uint8_t, GB::LCD_WIDTH * GB::LCD_HEIGHT * 4> GBEmulatorController::framebuffer() {
+        if (presenting_run_ahead) {
+            return run_ahead_framebuffer;
+        }
+
+        return core.ppu.framebuffer();
+    }
+
     bool GBEmulatorController::try_run_frame() {
         using namespace std::chrono_literals;
 
-        if (state == EmulationState::Running && audio_system.should_continue()) {
-            core.run_for_frames(1);
+        if (state == EmulationState::Running) {
+            if (rewinding && movie.mode() == GB::MovieMode::Inactive) {
+                return rewind_frame();
+            }
+
+            audio_system.apply_volume_settings(core.apu);
+            audio_system.set_speed(core.apu, get_speed_percent() / 100.0);
+            run_frame();
+            audio_system.queue_samples(core.apu);
+            take_snapshot();
+
+            if (movie.finished()) {
+                stop_movie();
+            }
+
             return true;
         }
 
@@ -60,11 +85,46 @@ namespace QtFrontend {
         }
     }
 
+    static bool is_hotkey_down(int32_t key) {
+        auto keyboard = Input::try_find_by_name("Keyboard");
+
+        if (!keyboard) {
+            return false;
+        }
+
+        return keyboard.value()->is_key_down(Input::InputSource{.keyboard = key});
+    }
+
+    bool GBEmulatorController::is_rewind_held() const {
+        const auto &rewind = Common::Config::current().gameboy.rewind;
+
+        return rewind.enabled && is_hotkey_down(rewind.key);
+    }
+
+    bool GBEmulatorController::is_fast_forward_held() const {
+        return is_hotkey_down(Common::Config::current().gameboy.emulation.fast_forward_key);
+    }
+
+    int32_t GBEmulatorController::get_speed_percent() const {
+        const auto &emulation = Common::Config::current().gameboy.emulation;
+
+        if (movie.mode() == GB::MovieMode::Playback) {
+            return 0;
+        }
+
+        int32_t speed = fast_forward ? emulation.fast_forward_speed : emulation.speed;
+
+        return speed > 0 ? std::max(speed, MIN_SPEED_PERCENT) : 0;
+    }
+
     void GBEmulatorController::start_rom(std::filesystem::path path) {
         auto new_cart = GB::Cartridge::from_file(path);
 
+        stop_movie();
+
         if (cart) {
             cart->save_sram_to_file();
+            save_idle_loop_cache();
             cart.reset();
         }
 
@@ -74,6 +134,7 @@ namespace QtFrontend {
             cart = std::move(new_cart);
 
             init_by_console_type();
+            reset_rewind();
 
             audio_system.prep_for_playback(core.apu);
 
@@ -100,6 +161,10 @@ namespace QtFrontend {
         }
     }
 
+    void GBEmulatorController::set_rewinding(bool held) { rewinding = held; }
+
+    void GBEmulatorController::set_fast_forward(bool held) { fast_forward = held; }
+
     void GBEmulatorController::set_pause(bool checked) {
         switch (state) {
         case EmulationState::Paused: {
@@ -117,16 +182,21 @@ namespace QtFrontend {
     }
 
     void GBEmulatorController::stop_emulation() {
+        stop_movie();
         sram_timer->stop();
         core.initialize(nullptr);
         cart->save_sram_to_file();
+        save_idle_loop_cache();
         cart.reset();
+        rewind_buffer.clear();
         state = EmulationState::Stopped;
         emit on_hide();
     }
 
     void GBEmulatorController::reset_emulation() {
+        stop_movie();
         init_by_console_type();
+        reset_rewind();
         audio_system.prep_for_playback(core.apu);
     }
 
@@ -140,6 +210,76 @@ namespace QtFrontend {
         }
     }
 
+    void GBEmulatorController::start_movie_recording(std::filesystem::path path) {
+        if (state == EmulationState::Stopped) {
+            return;
+        }
+
+        stop_movie();
+
+        movie_path = std::move(path);
+        movie.start_recording(core);
+
+        emit on_movie_status(QString::fromStdString(
+            fmt::format("Recording movie to '{}'", movie_path.string())));
+    }
+
+    void GBEmulatorController::play_movie(std::filesystem::path path) {
+        if (state == EmulationState::Stopped) {
+            return;
+        }
+
+        stop_movie();
+
+        if (!movie.load(path)) {
+            emit on_movie_status(
+                QString::fromStdString(fmt::format("Unable to load movie '{}'", path.string())));
+            return;
+        }
+
+        if (!movie.start_playback(core)) {
+            emit on_movie_status(QString::fromStdString(fmt::format(
+                "Movie '{}' was recorded with a different cartridge", path.string())));
+            return;
+        }
+
+        movie_path = std::move(path);
+        reset_rewind();
+
+        emit on_movie_status(
+            QString::fromStdString(fmt::format("Playing movie '{}'", movie_path.string())));
+    }
+
+    void GBEmulatorController::stop_movie() {
+        switch (movie.mode()) {
+        case GB::MovieMode::Recording: {
+            if (movie.save(movie_path)) {
+                emit on_movie_status(QString::fromStdString(
+                    fmt::format("Movie saved to '{}'", movie_path.string())));
+            } else {
+                emit on_movie_status(QString::fromStdString(
+                    fmt::format("Unable to save movie '{}'", movie_path.string())));
+            }
+            break;
+        }
+        case GB::MovieMode::Playback: {
+            if (auto frame = movie.desync_frame()) {
+                emit on_movie_status(
+                    QString::fromStdString(fmt::format("Movie desynced at frame {}", *frame)));
+            } else {
+                emit on_movie_status(QString::fromStdString(fmt::format(
+                    "Movie finished in sync after {} frames", movie.current_frame())));
+            }
+            break;
+        }
+        case GB::MovieMode::Inactive: {
+            break;
+        }
+        }
+
+        movie.stop();
+    }
+
     void GBEmulatorController::init_by_console_type() {
         const auto &emulation = Common::Config::current().gameboy.emulation;
 
@@ -157,5 +297,115 @@ namespace QtFrontend {
             break;
         }
         }
+
+        core.cpu.set_cached_interpreter(emulation.cached_interpreter);
+        core.cpu.set_recompiler(emulation.recompiler);
+        core.cpu.set_idle_loop_skipping(emulation.skip_idle_loops);
+
+        // Resetting clears the cache, loops found before are loaded again from the last save.
+        if (emulation.skip_idle_loops) {
+            core.cpu.idle_loop_cache().load(idle_loop_cache_path(), cart->header().checksum);
+        }
+    }
+
+    std::filesystem::path GBEmulatorController::idle_loop_cache_path() const {
+        auto path = cart->header().file_path;
+        path += ".idle";
+
+        return path;
+    }
+
+    void GBEmulatorController::save_idle_loop_cache() {
+        if (Common::Config::current().gameboy.emulation.skip_idle_loops) {
+            core.cpu.idle_loop_cache().save(idle_loop_cache_path(), cart->header().checksum);
+        }
+    }
+
+    void GBEmulatorController::run_frame() {
+        const auto run_ahead_frames = Common::Config::current().gameboy.emulation.run_ahead_frames;
+
+        /*
+            Speculative frames would poll the pad and pollute a movie recording, and there is no
+            latency to hide while running unthrottled.
+        */
+        if (run_ahead_frames > 0 && movie.mode() == GB::MovieMode::Inactive &&
+            get_speed_percent() != 0) {
+            run_ahead(run_ahead_frames);
+            return;
+        }
+
+        movie.begin_frame(core);
+        core.run_for_frames(1);
+        movie.end_frame(core);
+        presenting_run_ahead = false;
+    }
+
+    void GBEmulatorController::run_ahead(int32_t frames) {
+        /*
+            Only the first frame is real, its state is kept and everything after it is thrown away
+            once the last frame has been captured, which is the only one that has to be drawn.
+            When the last run doesn't publish a frame the previous image is kept like the PPU would.
+        */
+        int32_t total = frames + 1;
+
+        if (!presenting_run_ahead) {
+            auto image = core.ppu.framebuffer();
+            std::copy(image.begin(), image.end(), run_ahead_framebuffer.begin());
+        }
+
+        for (int32_t i = 0; i < total; ++i) {
+            bool last = i + 1 == total;
+            auto frame = core.ppu.frame_count();
+
+            core.ppu.set_output_enabled(last);
+            core.run_until_vblank();
+
+            if (last && core.ppu.frame_count() != frame) {
+                auto image = core.ppu.framebuffer();
+                std::copy(image.begin(), image.end(), run_ahead_framebuffer.begin());
+            }
+
+            if (i == 0) {
+                core.save_state(run_ahead_state);
+                core.apu.set_output_enabled(false);
+            }
+        }
+
+        presenting_run_ahead = true;
+
+        core.load_state(run_ahead_state);
+        core.ppu.set_output_enabled(true);
+        core.apu.set_output_enabled(true);
+    }
+
+    void GBEmulatorController::reset_rewind() {
+        const auto &rewind = Common::Config::current().gameboy.rewind;
+        size_t capacity = rewind.enabled ? static_cast<size_t>(rewind.buffer_size_mb) << 20 : 0;
+
+        rewind_buffer.set_capacity(capacity);
+        rewind_buffer.clear();
+        frames_since_snapshot = 0;
+    }
+
+    void GBEmulatorController::take_snapshot() {
+        const auto &rewind = Common::Config::current().gameboy.rewind;
+
+        if (!rewind.enabled || ++frames_since_snapshot < rewind.frames_per_snapshot) {
+            return;
+        }
+
+        frames_since_snapshot = 0;
+        core.save_state(snapshot);
+        rewind_buffer.push(snapshot);
+    }
+
+    bool GBEmulatorController::rewind_frame() {
+        if (!rewind_buffer.pop(snapshot)) {
+            return false;
+        }
+
+        frames_since_snapshot = 0;
+        presenting_run_ahead = false;
+        return core.load_state(snapshot);
     }
 }
\ No newline at end of file
@@ -20,11 +20,15 @@
 #include "AudioSystem.hpp"
 #include "Common/Math.hpp"
 #include "Cores/GB/Core.hpp"
+#include "Cores/GB/Movie.hpp"
+#include "RewindBuffer.hpp"
 #include <QObject>
 #include <QTimer>
 #include <array>
 #include <filesystem>
 #include <memory>
+#include <span>
+#include <vector>
 
 namespace GL {
     class Renderer;
@@ -49,29 +53,63 @@ namespace QtFrontend {
         EmulationState get_state() const;
         GB::Core &get_core();
 
+        // The frame to present, the one at the end of the speculative frames with run-ahead.
+        std::span<uint8_t, GB::LCD_WIDTH * GB::LCD_HEIGHT * 4> framebuffer();
+
         bool try_run_frame();
         void process_input(std::array<bool, 8> &buttons);
+        bool is_rewind_held() const;
+        bool is_fast_forward_held() const;
+
+        // Percent of full speed, 0 when frames should run as fast as the host allows.
+        int32_t get_speed_percent() const;
 
         Q_SLOT void start_rom(std::filesystem::path path);
         Q_SLOT void copy_input(std::array<bool, 8> input);
+        Q_SLOT void set_rewinding(bool held);
+        Q_SLOT void set_fast_forward(bool held);
         Q_SLOT void set_pause(bool checked);
         Q_SLOT void stop_emulation();
         Q_SLOT void reset_emulation();
         Q_SLOT void save_sram();
+        Q_SLOT void start_movie_recording(std::filesystem::path path);
+        Q_SLOT void play_movie(std::filesystem::path path);
+        Q_SLOT void stop_movie();
 
         Q_SIGNAL void on_load_success(const QString &message, int timeout = 0);
         Q_SIGNAL void on_load_fail(const QString &message, int timeout = 0);
         Q_SIGNAL void on_show();
         Q_SIGNAL void on_hide();
+        Q_SIGNAL void on_movie_status(const QString &message);
 
     private:
         void init_by_console_type();
+        std::filesystem::path idle_loop_cache_path() const;
+        void save_idle_loop_cache();
+        void run_frame();
+        void run_ahead(int32_t frames);
+        void reset_rewind();
+        void take_snapshot();
+        bool rewind_frame();
 
         EmulationState state = EmulationState::Stopped;
         GB::Core core{};
         std::unique_ptr<GB::Cartridge> cart;
         AudioSystem audio_system{};
 
+        bool fast_forward = false;
+        bool rewinding = false;
+        int32_t frames_since_snapshot = 0;
+        RewindBuffer rewind_buffer{};
+        std::vector<uint8_t> snapshot{};
+
+        bool presenting_run_ahead = false;
+        std::vector<uint8_t> run_ahead_state{};
+        std::array<uint8_t, GB::LCD_WIDTH * GB::LCD_HEIGHT * 4> run_ahead_framebuffer{};
+
+        GB::Movie movie{};
+        std::filesystem::path movie_path{};
+
         QTimer *sram_timer = nullptr;
     };
 }
\ No newline at end of file
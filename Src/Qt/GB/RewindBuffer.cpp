@@ -0,0 +1,223 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "RewindBuffer.hpp"
+#include <cstring>
+
+namespace QtFrontend {
+    /*
+        Encoded deltas are a list of (equal bytes to skip, length, XORed bytes) tokens. States are
+        compared a word at a time, a changed run only ends at a whole word that is equal again,
+        shorter gaps are cheaper to store inline than as a new token.
+    */
+    constexpr size_t WORD_SIZE = sizeof(uint64_t);
+
+    static uint64_t load_word(std::span<const uint8_t> bytes, size_t position) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + position, WORD_SIZE);
+        return word;
+    }
+
+    void RewindBuffer::set_capacity(size_t bytes) {
+        if (bytes == storage.size()) {
+            return;
+        }
+
+        clear();
+        storage.resize(bytes);
+        storage.shrink_to_fit();
+    }
+
+    void RewindBuffer::clear() {
+        has_latest = false;
+        write_offset = 0;
+        deltas.clear();
+        latest.clear();
+    }
+
+    size_t RewindBuffer::capacity() const { return storage.size(); }
+
+    size_t RewindBuffer::snapshot_count() const { return has_latest ? deltas.size() + 1 : 0; }
+
+    void RewindBuffer::push(std::span<const uint8_t> state) {
+        if (storage.empty()) {
+            return;
+        }
+
+        if (has_latest && latest.size() == state.size()) {
+            encode_delta(latest, state);
+
+            if (auto destination = allocate(encoded.size())) {
+                std::memcpy(destination, encoded.data(), encoded.size());
+            }
+        } else {
+            deltas.clear();
+            write_offset = 0;
+        }
+
+        latest.assign(state.begin(), state.end());
+        has_latest = true;
+    }
+
+    bool RewindBuffer::pop(std::vector<uint8_t> &state) {
+        if (!has_latest) {
+            return false;
+        }
+
+        state = latest;
+
+        if (deltas.empty()) {
+            has_latest = false;
+            return true;
+        }
+
+        const auto &delta = deltas.back();
+
+        apply_delta({storage.data() + delta.offset, delta.size}, latest);
+        write_offset = delta.offset;
+        deltas.pop_back();
+
+        return true;
+    }
+
+    void RewindBuffer::encode_delta(std::span<const uint8_t> from, std::span<const uint8_t> to) {
+        const size_t size = from.size();
+        size_t position = 0;
+
+        encoded.clear();
+
+        while (position < size) {
+            const size_t skip_start = position;
+
+            while (position + WORD_SIZE <= size &&
+                   load_word(from, position) == load_word(to, position)) {
+                position += WORD_SIZE;
+            }
+
+            while (position < size && from[position] == to[position]) {
+                ++position;
+            }
+
+            if (position == size) {
+                break;
+            }
+
+            const size_t run_start = position;
+
+            while (position + WORD_SIZE <= size &&
+                   load_word(from, position) != load_word(to, position)) {
+                position += WORD_SIZE;
+            }
+
+            if (position + WORD_SIZE > size) {
+                position = size;
+            }
+
+            size_t run_end = position;
+
+            while (from[run_end - 1] == to[run_end - 1]) {
+                --run_end;
+            }
+
+            write_varint(run_start - skip_start);
+            write_varint(run_end - run_start);
+
+            const size_t base = encoded.size();
+            encoded.resize(base + (run_end - run_start));
+
+            for (size_t i = run_start; i < run_end; ++i) {
+                encoded[base + i - run_start] = from[i] ^ to[i];
+            }
+
+            position = run_end;
+        }
+    }
+
+    void RewindBuffer::write_varint(size_t value) {
+        while (value >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+
+        encoded.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint8_t *RewindBuffer::allocate(size_t size) {
+        // A delta that does not fit at all breaks the chain, everything older is unreachable.
+        if (size > storage.size()) {
+            deltas.clear();
+            write_offset = 0;
+            return nullptr;
+        }
+
+        /*
+            The deltas following the write offset are always the oldest ones. Wrapping around
+            leaves the tail of the storage unused and drops whatever was still there.
+        */
+        if (write_offset + size > storage.size()) {
+            while (!deltas.empty() && deltas.front().offset >= write_offset) {
+                deltas.pop_front();
+            }
+
+            write_offset = 0;
+        }
+
+        while (!deltas.empty() && deltas.front().offset >= write_offset &&
+               deltas.front().offset < write_offset + size) {
+            deltas.pop_front();
+        }
+
+        deltas.push_back({.offset = write_offset, .size = size});
+        write_offset += size;
+
+        return storage.data() + deltas.back().offset;
+    }
+
+    void RewindBuffer::apply_delta(std::span<const uint8_t> delta, std::span<uint8_t> state) {
+        size_t position = 0;
+        size_t offset = 0;
+
+        while (position < delta.size()) {
+            offset += read_varint(delta, position);
+            size_t length = read_varint(delta, position);
+
+            for (size_t i = 0; i < length; ++i) {
+                state[offset + i] ^= delta[position + i];
+            }
+
+            offset += length;
+            position += length;
+        }
+    }
+
+    size_t RewindBuffer::read_varint(std::span<const uint8_t> delta, size_t &position) {
+        size_t value = 0;
+
+        for (int32_t shift = 0; position < delta.size(); shift += 7) {
+            uint8_t byte = delta[position++];
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+
+        return value;
+    }
+}
@@ -0,0 +1,77 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+#include <deque>
+#include <span>
+#include <vector>
+
+namespace QtFrontend {
+    /*
+        Keeps the newest snapshot in full and every older one as the XOR of itself and the
+        snapshot that followed it, so stepping back only has to decode a single delta. Most of a
+        state does not change between frames, the XOR is mostly zeros and only the runs that did
+        change are stored.
+
+        Deltas live in a fixed ring of bytes, the oldest ones are overwritten once it is full.
+    */
+    class RewindBuffer {
+    public:
+        RewindBuffer() = default;
+        RewindBuffer(const RewindBuffer &) = delete;
+        RewindBuffer(RewindBuffer &&) = delete;
+        RewindBuffer &operator=(const RewindBuffer &) = delete;
+        RewindBuffer &operator=(RewindBuffer &&) = delete;
+
+        // Discards all snapshots when the capacity changes.
+        void set_capacity(size_t bytes);
+        void clear();
+
+        size_t capacity() const;
+        size_t snapshot_count() const;
+
+        void push(std::span<const uint8_t> state);
+
+        // Moves the newest snapshot into state, returns false when there is none left.
+        bool pop(std::vector<uint8_t> &state);
+
+    private:
+        struct Delta {
+            size_t offset = 0;
+            size_t size = 0;
+        };
+
+        void encode_delta(std::span<const uint8_t> from, std::span<const uint8_t> to);
+        void write_varint(size_t value);
+        uint8_t *allocate(size_t size);
+
+        static void apply_delta(std::span<const uint8_t> delta, std::span<uint8_t> state);
+        static size_t read_varint(std::span<const uint8_t> delta, size_t &position);
+
+        bool has_latest = false;
+        size_t write_offset = 0;
+
+        std::vector<uint8_t> storage{};
+        std::deque<Delta> deltas{};
+        std::vector<uint8_t> latest{};
+        std::vector<uint8_t> encoded{};
+    };
+}
@@ -96,6 +96,12 @@ namespace QtFrontend {
 
     QAction *MainWindow::get_stop_action() { return ui->actionStop; }
 
+    QAction *MainWindow::get_record_movie_action() { return ui->actionRecord_Movie; }
+
+    QAction *MainWindow::get_play_movie_action() { return ui->actionPlay_Movie; }
+
+    QAction *MainWindow::get_stop_movie_action() { return ui->actionStop_Movie; }
+
     QLabel *MainWindow::get_fps_counter() { return fps_counter; }
 
     void MainWindow::open_rom_file_browser() {
@@ -115,6 +121,29 @@ namespace QtFrontend {
         emit rom_loaded(filePath);
     }
 
+    void MainWindow::open_movie_record_browser() {
+        QFileDialog dialog;
+        dialog.setAcceptMode(QFileDialog::AcceptSave);
+        dialog.setDefaultSuffix("bcbm");
+        dialog.setNameFilter(tr("Movies (*.bcbm)"));
+
+        if (dialog.exec()) {
+            std::string filePath = dialog.selectedFiles().first().toStdString();
+            emit movie_record(filePath);
+        }
+    }
+
+    void MainWindow::open_movie_play_browser() {
+        QFileDialog dialog;
+        dialog.setFileMode(QFileDialog::FileMode::ExistingFile);
+        dialog.setNameFilter(tr("Movies (*.bcbm)"));
+
+        if (dialog.exec()) {
+            std::string filePath = dialog.selectedFiles().first().toStdString();
+            emit movie_play(filePath);
+        }
+    }
+
     void MainWindow::open_gb_settings() {
         if (!settings) {
             int32_t menu = 0;
@@ -171,6 +200,10 @@ namespace QtFrontend {
         connect(&input_timer, &QTimer::timeout, this, &MainWindow::update_controllers);
         connect(ui->actionLoad, &QAction::triggered, this, &MainWindow::open_rom_file_browser);
         connect(ui->actionExit, &QAction::triggered, this, &MainWindow::close);
+        connect(ui->actionRecord_Movie, &QAction::triggered, this,
+                &MainWindow::open_movie_record_browser);
+        connect(ui->actionPlay_Movie, &QAction::triggered, this,
+                &MainWindow::open_movie_play_browser);
         connect(ui->actionEmulation, &QAction::triggered, this, &MainWindow::open_gb_settings);
         connect(ui->actionVideo, &QAction::triggered, this, &MainWindow::open_gb_settings);
         connect(ui->actionAudio, &QAction::triggered, this, &MainWindow::open_gb_settings);
@@ -57,10 +57,15 @@ namespace QtFrontend {
         QAction *get_reset_action();
         QAction *get_pause_action();
         QAction *get_stop_action();
+        QAction *get_record_movie_action();
+        QAction *get_play_movie_action();
+        QAction *get_stop_movie_action();
         QLabel *get_fps_counter();
 
         Q_SLOT void open_rom_file_browser();
         Q_SLOT void open_rom_from_recents(QAction *action);
+        Q_SLOT void open_movie_record_browser();
+        Q_SLOT void open_movie_play_browser();
         Q_SLOT void open_gb_settings();
         Q_SLOT void open_about();
         Q_SLOT void clear_settings_ptr();
@@ -69,6 +74,8 @@ namespace QtFrontend {
         Q_SLOT void rom_load_fail(const QString &message, int timeout = 0);
 
         Q_SIGNAL void rom_loaded(std::filesystem::path);
+        Q_SIGNAL void movie_record(std::filesystem::path);
+        Q_SIGNAL void movie_play(std::filesystem::path);
         Q_SIGNAL void reload_device_list();
 
     private:
@@ -0,0 +1,93 @@
+/*
+    Big ComBoy
+    Copyright (C) 2023-2024 UltimaOmega474
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <span>
+
+namespace QtFrontend {
+    /*
+        Lock-free ring for exactly one producer and one consumer thread. Each side only writes
+        its own index, the other index is read with acquire ordering so the data it guards is
+        visible before it is used.
+    */
+    template <typename T, size_t Capacity> class RingBuffer {
+        static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+    public:
+        size_t size() const;
+        size_t capacity() const;
+
+        // Both return how many elements were actually transferred.
+        size_t push(std::span<const T> values);
+        size_t pop(std::span<T> values);
+
+        // Only safe while neither side is running.
+        void clear();
+
+    private:
+        std::atomic_size_t read_index = 0;
+        std::atomic_size_t write_index = 0;
+
+        std::array<T, Capacity> buffer{};
+    };
+
+    template <typename T, size_t Capacity> inline size_t RingBuffer<T, Capacity>::size() const {
+        return write_index.load(std::memory_order_acquire) -
+               read_index.load(std::memory_order_acquire);
+    }
+
+    template <typename T, size_t Capacity> inline size_t RingBuffer<T, Capacity>::capacity() const {
+        return Capacity;
+    }
+
+    template <typename T, size_t Capacity>
+    inline size_t RingBuffer<T, Capacity>::push(std::span<const T> values) {
+        size_t write = write_index.load(std::memory_order_relaxed);
+        size_t read = read_index.load(std::memory_order_acquire);
+        size_t count = std::min(values.size(), Capacity - (write - read));
+
+        for (size_t i = 0; i < count; ++i) {
+            buffer[(write + i) & (Capacity - 1)] = values[i];
+        }
+
+        write_index.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    template <typename T, size_t Capacity>
+    inline size_t RingBuffer<T, Capacity>::pop(std::span<T> values) {
+        size_t read = read_index.load(std::memory_order_relaxed);
+        size_t write = write_index.load(std::memory_order_acquire);
+        size_t count = std::min(values.size(), write - read);
+
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = buffer[(read + i) & (Capacity - 1)];
+        }
+
+        read_index.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+    template <typename T, size_t Capacity> inline void RingBuffer<T, Capacity>::clear() {
+        read_index.store(0, std::memory_order_relaxed);
+        write_index.store(0, std::memory_order_relaxed);
+    }
+}
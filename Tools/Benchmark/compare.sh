@@ -0,0 +1,91 @@
+#!/bin/sh
+#
+#   Big ComBoy
+#   Copyright (C) 2023-2024 UltimaOmega474
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# Compares CPU throughput of the headless runner between two revisions.
+#
+#   Tools/Benchmark/compare.sh <before> [after] [-- runner options]
+#
+# Both revisions are checked out into temporary worktrees and built in Release with the frontend
+# off. Each benchmark ROM from make_roms.py runs PASSES times for FRAMES frames and the best pass is
+# reported. Runners older than the Instrs/s output only print Cycles/s. The ROMs are deterministic,
+# so the ratio between the two is the same for either column. Options after -- go to both runners,
+# e.g. -- --cached-interpreter.
+
+set -e
+
+FRAMES=${FRAMES:-600}
+PASSES=${PASSES:-10}
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 <before> [after] [-- runner options]" >&2
+    exit 1
+fi
+
+before=$1
+shift
+after=HEAD
+
+if [ $# -gt 0 ] && [ "$1" != "--" ]; then
+    after=$1
+    shift
+fi
+
+if [ "$1" = "--" ]; then
+    shift
+fi
+
+repo=$(git -C "$(dirname "$0")" rev-parse --show-toplevel)
+work=$(mktemp -d)
+trap 'git -C "$repo" worktree remove --force "$work/before" 2>/dev/null || true;
+      git -C "$repo" worktree remove --force "$work/after" 2>/dev/null || true;
+      rm -rf "$work"' EXIT
+
+python3 "$repo/Tools/Benchmark/make_roms.py" "$work/roms"
+
+build() {
+    git -C "$repo" worktree add --detach "$work/$1" "$2" >/dev/null 2>&1
+    cmake -S "$work/$1" -B "$work/$1/build" -DCMAKE_BUILD_TYPE=Release \
+        -DBCB_BUILD_FRONTEND=OFF >/dev/null
+    cmake --build "$work/$1/build" --target BigComBoyHeadless -j"$(nproc)" >/dev/null
+}
+
+# Prints the best Cycles/s and Instrs/s over all passes.
+measure() {
+    side=$1
+    shift
+    i=0
+    while [ $i -lt "$PASSES" ]; do
+        "$work/$side/bin/BigComBoyHeadless" --frames "$FRAMES" "$@" 2>/dev/null
+        i=$((i + 1))
+    done | awk '/^Cycles\/s:/ { if ($2 > c) c = $2 }
+                /^Instrs\/s:/ { if ($2 > n) n = $2 }
+                END { printf "%14s %14s", c ? c : "-", n ? n : "-" }'
+}
+
+build before "$before"
+build after "$after"
+
+printf "%-12s %-8s %14s %14s\n" "ROM" "Build" "Cycles/s" "Instrs/s"
+
+for rom in "$work"/roms/*.gb; do
+    name=$(basename "$rom" .gb)
+
+    for side in before after; do
+        printf "%-12s %-8s %s\n" "$name" "$side" "$(measure $side "$@" "$rom")"
+    done
+done
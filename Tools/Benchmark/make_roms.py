@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+#
+#   Big ComBoy
+#   Copyright (C) 2023-2024 UltimaOmega474
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""
+Writes the CPU benchmark ROMs used by compare.sh. Both turn the LCD off so the run measures
+the CPU, bus and scheduler rather than the PPU.
+
+    alu.gb       A tight loop of ALU, load, store, stack and branch instructions in bank 0.
+    straight.gb  A long run of straight-line ALU and load code in bank 1 of an MBC1 cartridge.
+"""
+
+import pathlib
+import sys
+
+ROM_SIZE = 0x8000
+
+
+def header(rom, cartridge_type):
+    # nop, jp $0150
+    rom[0x100:0x104] = bytes([0x00, 0xC3, 0x50, 0x01])
+    rom[0x134:0x143] = b"BCBBENCH".ljust(15, b"\0")
+    rom[0x147] = cartridge_type
+    rom[0x148] = 0x00
+    rom[0x149] = 0x00
+
+    checksum = 0
+    for value in rom[0x134:0x14D]:
+        checksum = (checksum - value - 1) & 0xFF
+    rom[0x14D] = checksum
+
+
+def alu_rom():
+    rom = bytearray(ROM_SIZE)
+    rom[0x150:0x150 + 32] = bytes([
+        0xAF,              # xor a
+        0xE0, 0x40,        # ldh [$FF40], a     LCD off
+        0x21, 0x00, 0xC0,  # ld hl, $C000
+        # loop ($0156):
+        0x78,              # ld a, b
+        0x81,              # add a, c
+        0xAA,              # xor d
+        0x1C,              # inc e
+        0x15,              # dec d
+        0x07,              # rlca
+        0xCB, 0x37,        # swap a
+        0x77,              # ld [hl], a
+        0x3C,              # inc a
+        0xB0,              # or b
+        0x7E,              # ld a, [hl]
+        0xC5,              # push bc
+        0xC1,              # pop bc
+        0x23,              # inc hl
+        0xCB, 0x6C,        # bit 5, h
+        0x28, 0x02,        # jr z, +2
+        0x26, 0xC0,        # ld h, $C0
+        0x18, 0xE9,        # jr loop
+        0x00, 0x00, 0x00, 0x00,
+    ])
+    header(rom, 0x00)
+    return rom
+
+
+def straight_rom():
+    rom = bytearray(ROM_SIZE)
+    rom[0x150:0x15B] = bytes([
+        0xAF,              # xor a
+        0xE0, 0x40,        # ldh [$FF40], a     LCD off
+        0x3E, 0x01,        # ld a, 1
+        0xEA, 0x00, 0x20,  # ld [$2000], a      select bank 1
+        0xC3, 0x00, 0x40,  # jp $4000
+    ])
+
+    code = bytearray()
+    for i in range(20):
+        code += bytes([
+            0x3E, i,           # ld a, i
+            0xC6, 0x34,        # add a, $34
+            0x21, 0x00, 0xC0,  # ld hl, $C000
+            0x77,              # ld [hl], a
+            0x06, 0x10,        # ld b, $10
+            0xFE, 0x22,        # cp $22
+            0x11, 0x34, 0xD2,  # ld de, $D234
+            0x12,              # ld [de], a
+        ])
+    code += bytes([0xC3, 0x00, 0x40])  # jp $4000
+
+    rom[0x4000:0x4000 + len(code)] = code
+    header(rom, 0x01)
+    return rom
+
+
+def main():
+    output = pathlib.Path(sys.argv[1] if len(sys.argv) > 1 else ".")
+    output.mkdir(parents=True, exist_ok=True)
+
+    (output / "alu.gb").write_bytes(alu_rom())
+    (output / "straight.gb").write_bytes(straight_rom())
+
+
+if __name__ == "__main__":
+    main()
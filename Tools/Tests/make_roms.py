@@ -0,0 +1,403 @@
+#!/usr/bin/env python3
+#
+#   Big ComBoy
+#   Copyright (C) 2023-2024 UltimaOmega474
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License as published by
+#   the Free Software Foundation, either version 3 of the License, or
+#   (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""
+Writes the ROMs the fast paths of the core are checked against the interpreter with, see
+CMakeLists.txt next to this file.
+
+    random_NN.gb  Random code across every cartridge type, with a bias towards IO registers. The
+                  seed is NN, so the same ROMs are written every time.
+    busy_dmg.gb   Fills VRAM and OAM, then plays audio, scrolls and switches palettes from the
+    busy_cgb.gb   VBlank, STAT and timer interrupts. The CGB version adds HDMA and speed switches.
+    idle_dmg.gb   Waits for VBlank, LY, STAT modes, IF, DIV, HRAM flags and the joypad in the
+    idle_cgb.gb   kinds of loops idle loop skipping looks for, one of them in a switchable bank.
+    idle_cgb2.gb  The CGB versions add HDMA, idle_cgb2.gb runs in double speed from the start.
+"""
+
+import pathlib
+import random
+import struct
+import sys
+
+RANDOM_ROMS = 16
+
+# STOP and the opcodes that lock up the CPU.
+ILLEGAL_OPCODES = {0x10, 0xD3, 0xDB, 0xDD, 0xE3, 0xE4, 0xEB, 0xEC, 0xED, 0xF4, 0xFC, 0xFD}
+
+IO_REGISTERS = [
+    0x00, 0x04, 0x05, 0x06, 0x07, 0x0F, 0x10, 0x11, 0x12, 0x14, 0x17, 0x19,
+    0x1A, 0x1E, 0x21, 0x23, 0x24, 0x25, 0x26, 0x40, 0x41, 0x42, 0x43, 0x44,
+    0x45, 0x47, 0x4A, 0x4B, 0x4F, 0x55, 0x68, 0x69, 0x70, 0xFF,
+]
+
+# CGB flag, cartridge type, ROM size and RAM size codes of the random ROMs, in turn.
+RANDOM_CARTRIDGES = [
+    (0x00, 0x00, 0, 0),
+    (0x80, 0x01, 2, 0),
+    (0x00, 0x03, 3, 3),
+    (0x80, 0x13, 7, 3),
+    (0xC0, 0x1B, 4, 4),
+    (0x00, 0x10, 7, 3),
+    (0x80, 0x06, 2, 0),
+    (0x80, 0x19, 3, 2),
+]
+
+
+def header(rom, cgb, cartridge_type, rom_size, ram_size):
+    # nop, jp $0150
+    rom[0x100:0x104] = bytes([0x00, 0xC3, 0x50, 0x01])
+    rom[0x134:0x143] = b"BCBTEST".ljust(15, b"\0")
+    rom[0x143] = cgb
+    rom[0x147] = cartridge_type
+    rom[0x148] = rom_size
+    rom[0x149] = ram_size
+
+    checksum = 0
+    for value in rom[0x134:0x14D]:
+        checksum = (checksum - value - 1) & 0xFF
+    rom[0x14D] = checksum
+
+
+class Assembler:
+    """Assembles bytes at base, strings are labels for an absolute address."""
+
+    def __init__(self, base):
+        self.code = bytearray()
+        self.base = base
+        self.labels = {}
+        self.fixups = []
+
+    def label(self, name):
+        self.labels[name] = self.base + len(self.code)
+
+    def emit(self, *values):
+        for value in values:
+            if isinstance(value, str):
+                self.fixups.append((len(self.code), value, False))
+                self.code += bytes(2)
+            else:
+                self.code.append(value & 0xFF)
+
+    def jr(self, opcode, name):
+        self.code.append(opcode)
+        self.fixups.append((len(self.code), name, True))
+        self.code.append(0)
+
+    # ld a, value; ldh [$FF00 + register], a
+    def ldh(self, register, value):
+        self.emit(0x3E, value, 0xE0, register)
+
+    def assemble(self):
+        for offset, name, relative in self.fixups:
+            target = self.labels[name]
+
+            if relative:
+                distance = target - (self.base + offset + 1)
+                assert -128 <= distance <= 127, name
+                self.code[offset] = distance & 0xFF
+            else:
+                self.code[offset:offset + 2] = struct.pack("<H", target)
+
+        return self.code
+
+
+def install(rom, assembler, vectors):
+    code = assembler.assemble()
+    rom[assembler.base:assembler.base + len(code)] = code
+
+    for vector, name in vectors:
+        rom[vector:vector + 3] = bytes([0xC3]) + struct.pack("<H", assembler.labels[name])
+
+
+def random_rom(seed):
+    cgb, cartridge_type, rom_size, ram_size = RANDOM_CARTRIDGES[seed % len(RANDOM_CARTRIDGES)]
+    generator = random.Random(seed)
+    size = 0x8000 << rom_size
+
+    rom = bytearray(generator.getrandbits(8) for _ in range(size))
+    for i in range(len(rom)):
+        while rom[i] in ILLEGAL_OPCODES:
+            rom[i] = generator.getrandbits(8)
+
+        # Most HALTs are removed, so the code doesn't spend most of its time waiting.
+        if rom[i] == 0x76 and generator.random() < 0.8:
+            rom[i] = 0x00
+
+    rom[0:0x150] = bytes(0x150)
+    header(rom, cgb, cartridge_type, rom_size, ram_size)
+
+    # RST and interrupt vectors jump somewhere random in bank 0.
+    for vector in range(0, 0x68, 8):
+        target = generator.randrange(0x160, 0x4000)
+        rom[vector:vector + 3] = bytes([0xC3, target & 0xFF, target >> 8])
+
+    # ld sp, $DFFE; enable every interrupt, start the timer; ei
+    start = bytes([0x31, 0xFE, 0xDF, 0x3E, 0x1F, 0xE0, 0xFF, 0x3E, 0x05, 0xE0, 0x07, 0xFB])
+    rom[0x150:0x150 + len(start)] = start
+
+    for _ in range(size // 64):
+        position = generator.randrange(0x160, size - 2)
+        rom[position] = generator.choice([0xE0, 0xF0])
+        rom[position + 1] = generator.choice(IO_REGISTERS)
+
+    return rom
+
+
+def busy_rom(cgb):
+    rom = bytearray(0x8000)
+    header(rom, 0x80 if cgb else 0x00, 0x00, 0, 0)
+
+    a = Assembler(0x150)
+    a.emit(0xF3, 0x31, 0xFE, 0xFF)               # di; ld sp, $FFFE
+    a.label("wait_vblank")
+    a.emit(0xF0, 0x44, 0xFE, 0x90)               # ldh a, [LY]; cp 144
+    a.jr(0x20, "wait_vblank")
+    a.ldh(0x40, 0x00)
+
+    a.emit(0x21, 0x00, 0x80)                     # ld hl, $8000
+    a.label("fill_tiles")
+    a.emit(0x7D, 0xAC, 0x22, 0x7C, 0xFE, 0x98)   # ld a, l; xor h; ld [hl+], a; ld a, h; cp $98
+    a.jr(0x20, "fill_tiles")
+    a.label("fill_map")
+    a.emit(0x7D, 0x22, 0x7C, 0xFE, 0x9C)         # ld a, l; ld [hl+], a; ld a, h; cp $9C
+    a.jr(0x20, "fill_map")
+
+    a.emit(0x21, 0x00, 0xC1, 0x0E, 0xA0)         # ld hl, $C100; ld c, 160
+    a.label("fill_oam")
+    a.emit(0x7D, 0x87, 0xC6, 0x10, 0x22, 0x0D)   # ld a, l; add a; add $10; ld [hl+], a; dec c
+    a.jr(0x20, "fill_oam")
+    a.ldh(0x46, 0xC1)
+
+    if cgb:
+        a.ldh(0x68, 0x80)
+        a.emit(0x06, 0x40)
+        a.label("background_palettes")
+        a.emit(0x78, 0x07, 0x07, 0xE0, 0x69, 0x05)
+        a.jr(0x20, "background_palettes")
+        a.ldh(0x6A, 0x80)
+        a.emit(0x06, 0x40)
+        a.label("object_palettes")
+        a.emit(0x78, 0x2F, 0xE0, 0x6B, 0x05)
+        a.jr(0x20, "object_palettes")
+
+    for register, value in ((0x47, 0xE4), (0x48, 0xD2), (0x49, 0x1B), (0x4A, 0x40), (0x4B, 0x57),
+                            (0x45, 0x30), (0x41, 0x40)):
+        a.ldh(register, value)
+
+    for register, value in ((0x26, 0x80), (0x24, 0x77), (0x25, 0xFF), (0x10, 0x23), (0x11, 0x80),
+                            (0x12, 0xF3), (0x13, 0x40), (0x14, 0x87), (0x16, 0x50), (0x17, 0x7A),
+                            (0x18, 0x20), (0x19, 0xC6)):
+        a.ldh(register, value)
+
+    for i in range(16):
+        a.ldh(0x30 + i, (i * 0x37) & 0xFF)
+
+    for register, value in ((0x1A, 0x80), (0x1B, 0x20), (0x1C, 0x20), (0x1D, 0x80), (0x1E, 0xC5),
+                            (0x20, 0x10), (0x21, 0xA2), (0x22, 0x35), (0x23, 0xC0), (0x06, 0xC0),
+                            (0x07, 0x05), (0xFF, 0x07), (0x0F, 0x00), (0x40, 0xF3)):
+        a.ldh(register, value)
+
+    a.emit(0xFB)                                 # ei
+    a.label("main")
+    a.emit(0x76, 0x00)                           # halt; nop
+    a.emit(0xFA, 0x00, 0xC0, 0xE6, 0x0F)         # ld a, [$C000]; and $0F
+    a.jr(0x20, "main")
+
+    # Every 16 frames: poll LY, read DIV and TIMA, reset DIV and switch the timer clock around.
+    a.label("poll_ly")
+    a.emit(0xF0, 0x44, 0xFE, 0x64)
+    a.jr(0x20, "poll_ly")
+    a.emit(0xF0, 0x04, 0xEA, 0x10, 0xC0, 0xF0, 0x05, 0xEA, 0x11, 0xC0)
+    a.ldh(0x04, 0x00)
+    a.emit(0xFA, 0x00, 0xC0, 0xE6, 0x30, 0xE0, 0x06)
+    a.ldh(0x07, 0x04)
+    a.ldh(0x07, 0x06)
+
+    if cgb:
+        for register, value in ((0x51, 0x02), (0x52, 0x00), (0x53, 0x88), (0x54, 0x00),
+                                (0x55, 0x8F)):
+            a.ldh(register, value)
+
+        # Every 32 frames the speed switches, a general purpose DMA runs in between.
+        a.emit(0xFA, 0x00, 0xC0, 0xE6, 0x10)
+        a.jr(0x28, "no_speed_switch")
+        a.ldh(0x4D, 0x01)
+        a.emit(0x10, 0x00)
+        a.label("no_speed_switch")
+        a.emit(0xFA, 0x00, 0xC0, 0xE6, 0x20)
+        a.jr(0x28, "no_dma")
+        for register, value in ((0x51, 0x03), (0x52, 0x00), (0x53, 0x90), (0x54, 0x00),
+                                (0x55, 0x07)):
+            a.ldh(register, value)
+        a.label("no_dma")
+
+    a.ldh(0x14, 0x87)
+    a.ldh(0x23, 0x80)
+    a.emit(0xC3, "main")
+
+    # Counts frames in $C000, scrolls and moves LYC.
+    a.label("vblank")
+    a.emit(0xF5, 0xFA, 0x00, 0xC0, 0x3C, 0xEA, 0x00, 0xC0)
+    a.emit(0xE0, 0x43, 0xCB, 0x3F, 0xE0, 0x42)
+    a.emit(0xF0, 0x45, 0xC6, 0x07, 0xFE, 0x90)
+    a.jr(0x38, "lyc_in_range")
+    a.emit(0xAF)
+    a.label("lyc_in_range")
+    a.emit(0xE0, 0x45, 0xF1, 0xD9)
+
+    a.label("stat")
+    a.emit(0xF5, 0xF0, 0x47, 0x2F, 0xE0, 0x47, 0xF0, 0x4B, 0xC6, 0x03, 0xE0, 0x4B, 0xF1, 0xD9)
+
+    a.label("timer")
+    a.emit(0xF5, 0xFA, 0x02, 0xC0, 0x3C, 0xEA, 0x02, 0xC0, 0xF1, 0xD9)
+
+    install(rom, a, ((0x40, "vblank"), (0x48, "stat"), (0x50, "timer")))
+    for vector in (0x58, 0x60):
+        rom[vector] = 0xD9
+
+    return rom
+
+
+def idle_rom(cgb, double_speed):
+    rom = bytearray(0x10000)
+    header(rom, 0x80 if cgb else 0x00, 0x01, 1, 0)
+
+    a = Assembler(0x150)
+    a.emit(0xF3, 0x31, 0xFE, 0xFF)
+    for register, value in ((0x06, 0x00), (0x07, 0x05), (0x45, 0x40), (0x41, 0x40), (0xFF, 0x07),
+                            (0x0F, 0x00), (0x40, 0x91)):
+        a.ldh(register, value)
+
+    if double_speed:
+        a.ldh(0x4D, 0x01)
+        a.emit(0x10, 0x00)
+
+    a.emit(0xFB)
+    a.label("main")
+
+    # Wait for the frame counter to change.
+    a.emit(0x21, 0x00, 0xC0, 0x7E, 0x47)
+    a.label("wait_frame")
+    a.emit(0x7E, 0xB8)
+    a.jr(0x28, "wait_frame")
+
+    # Wait for LY to reach frame * 7 & $7F.
+    a.emit(0x78, 0x07, 0x80, 0x87, 0x80, 0xE6, 0x7F, 0x47)
+    a.label("wait_ly")
+    a.emit(0xF0, 0x44, 0xB8)
+    a.jr(0x20, "wait_ly")
+
+    # Wait for mode 3, then mode 0.
+    a.label("wait_mode_3")
+    a.emit(0xF0, 0x41, 0xE6, 0x03, 0xFE, 0x03)
+    a.jr(0x20, "wait_mode_3")
+    a.label("wait_mode_0")
+    a.emit(0xF0, 0x41, 0xE6, 0x03)
+    a.jr(0x20, "wait_mode_0")
+
+    # Call the loop in bank 1 + frame % 3.
+    a.emit(0xFA, 0x00, 0xC0, 0xE6, 0x03, 0x20, 0x01, 0x3C, 0xEA, 0x00, 0x20, 0xCD, 0x00, 0x40)
+
+    # Poll IF for the timer with interrupts disabled.
+    a.emit(0xF3, 0x21, 0x0F, 0xFF)
+    a.label("wait_if")
+    a.emit(0xCB, 0x56)
+    a.jr(0x28, "wait_if")
+    a.emit(0xCB, 0x96, 0xFB)
+
+    # Poll DIV, then an HRAM flag the timer interrupt sets, then the LYC coincidence bit.
+    a.label("wait_div")
+    a.emit(0xF0, 0x04, 0xE6, 0x10)
+    a.jr(0x28, "wait_div")
+    a.emit(0xAF, 0xE0, 0x90)
+    a.label("wait_hram")
+    a.emit(0xFA, 0x90, 0xFF, 0xA7)
+    a.jr(0x28, "wait_hram")
+    a.label("wait_coincidence")
+    a.emit(0xF0, 0x41, 0xCB, 0x57)
+    a.jr(0x28, "wait_coincidence")
+
+    a.ldh(0x00, 0x20)
+    a.emit(0xF0, 0x00, 0xF0, 0x00, 0xE6, 0x0F)
+
+    # Every 16 frames the LCD is off for a few timer interrupts.
+    a.emit(0xFA, 0x00, 0xC0, 0xE6, 0x0F)
+    a.jr(0x20, "lcd_on")
+    a.label("wait_vblank")
+    a.emit(0xF0, 0x44, 0xFE, 0x91)
+    a.jr(0x20, "wait_vblank")
+    a.ldh(0x40, 0x00)
+    a.emit(0x0E, 0x04)
+    a.label("lcd_off")
+    a.emit(0xAF, 0xE0, 0x90)
+    a.label("wait_timer")
+    a.emit(0xF0, 0x90, 0xA7, 0xCA, "wait_timer")
+    a.emit(0x0D)
+    a.jr(0x20, "lcd_off")
+    a.ldh(0x40, 0x91)
+    a.label("lcd_on")
+
+    if cgb:
+        for register, value in ((0x51, 0x02), (0x52, 0x00), (0x53, 0x88), (0x54, 0x00),
+                                (0x55, 0x87)):
+            a.ldh(register, value)
+
+        a.emit(0xFA, 0x00, 0xC0, 0xE6, 0x1F)
+        a.jr(0x20, "no_speed_switch")
+        a.ldh(0x4D, 0x01)
+        a.emit(0x10, 0x00)
+        a.label("no_speed_switch")
+
+    a.emit(0xC3, "main")
+
+    a.label("vblank")
+    a.emit(0xF5, 0xFA, 0x00, 0xC0, 0x3C, 0xEA, 0x00, 0xC0)
+    a.emit(0xF0, 0x45, 0xC6, 0x0B, 0xE6, 0x7F, 0xE0, 0x45, 0xF1, 0xD9)
+    a.label("stat")
+    a.emit(0xF5, 0xF0, 0x47, 0x2F, 0xE0, 0x47, 0xF1, 0xD9)
+    a.label("timer")
+    a.emit(0xF5, 0x3E, 0x01, 0xE0, 0x90, 0xF1, 0xD9)
+
+    install(rom, a, ((0x40, "vblank"), (0x48, "stat"), (0x50, "timer")))
+    for vector in (0x58, 0x60):
+        rom[vector] = 0xD9
+
+    # ld c, $44; .wait: ldh a, [c]; cp 32 * bank; jp nz, .wait; ret
+    for bank in range(1, 4):
+        loop = bytes([0x0E, 0x44, 0xF2, 0xFE, 0x20 * bank, 0xC2, 0x02, 0x40, 0xC9])
+        rom[bank * 0x4000:bank * 0x4000 + len(loop)] = loop
+
+    return rom
+
+
+def main():
+    output = pathlib.Path(sys.argv[1] if len(sys.argv) > 1 else ".")
+    output.mkdir(parents=True, exist_ok=True)
+
+    for seed in range(RANDOM_ROMS):
+        (output / f"random_{seed:02d}.gb").write_bytes(random_rom(seed))
+
+    (output / "busy_dmg.gb").write_bytes(busy_rom(False))
+    (output / "busy_cgb.gb").write_bytes(busy_rom(True))
+    (output / "idle_dmg.gb").write_bytes(idle_rom(False, False))
+    (output / "idle_cgb.gb").write_bytes(idle_rom(True, False))
+    (output / "idle_cgb2.gb").write_bytes(idle_rom(True, True))
+
+
+if __name__ == "__main__":
+    main()